@@ -76,6 +76,8 @@
 #include "ns3/olsr-module.h"
 #include "ns3/dsdv-module.h"
 #include "ns3/sally-helper.h"
+#include "ns3/sally-routing.h"
+#include "ns3/saodv-routing-protocol.h"
 #include "ns3/dsr-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-helper.h"
@@ -117,12 +119,28 @@ private:
   int olsrPacketSizeSent;
   double totalEnergy;
   std::string protocolName;
+  bool adaptiveHello;
+  bool mprRelay;
+  bool sharedNeighbors;
+  bool seedAodvRoutes;
+  bool localRepair;
+  uint32_t deferralQueue;
+  double negativeCacheBackoff;
+  double aggregationWindow;
+  bool compactHello;
+  uint32_t linkFailureThreshold;
+  bool incrementalRoutes;
+  bool bitsetMpr;
+  bool indexedDuplicates;
+  bool indexedLinks;
+  bool coalescedTimers;
+  uint32_t seed;
 };
 
 RoutingExperiment::RoutingExperiment ()
   : nSinks (5), nNodes(20), nPackets(0), nAodvControlPacketsReceived(0), nAodvControlPacketsSent(0),
     nOlsrControlPacketsReceived(0), nOlsrControlPacketsSent(0),
-    aodvPacketSizeReceived(0), aodvPacketSizeSent(0), olsrPacketSizeReceived(0), olsrPacketSizeSent(0), totalEnergy(0), protocolName("SALLY")
+    aodvPacketSizeReceived(0), aodvPacketSizeSent(0), olsrPacketSizeReceived(0), olsrPacketSizeSent(0), totalEnergy(0), protocolName("SALLY"), adaptiveHello(false), mprRelay(false), sharedNeighbors(false), seedAodvRoutes(false), localRepair(false), deferralQueue(0), negativeCacheBackoff(0), aggregationWindow(0), compactHello(false), linkFailureThreshold(0), incrementalRoutes(false), bitsetMpr(false), indexedDuplicates(false), indexedLinks(false), coalescedTimers(false), seed(0)
 {
 }
 
@@ -238,6 +256,22 @@ RoutingExperiment::CommandSetup (int argc, char **argv)
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=SALLY,5=DSR", protocolName);
   cmd.AddValue ("numNodes", "Number of nodes", nNodes);
   cmd.AddValue ("numSinks", "Number of sinks", nSinks);
+  cmd.AddValue ("adaptiveHello", "Adapt the SALLY HELLO interval to link churn", adaptiveHello);
+  cmd.AddValue ("mprRelay", "Only MPRs of the previous hop rebroadcast SALLY RREQs", mprRelay);
+  cmd.AddValue ("sharedNeighbors", "SALLY AODV takes its neighbors from OLSR and sends no HELLOs", sharedNeighbors);
+  cmd.AddValue ("seedAodvRoutes", "Copy OLSR routes into AODV when a SALLY node enters AODV mode", seedAodvRoutes);
+  cmd.AddValue ("localRepair", "Repair broken SALLY AODV routes from the OLSR 2-hop neighborhood", localRepair);
+  cmd.AddValue ("deferralQueue", "Packets a SALLY node buffers while it looks for a route (0 drops them)", deferralQueue);
+  cmd.AddValue ("negativeCacheBackoff", "Seconds a SALLY node waits before looking again for a destination it could not reach (0 disables)", negativeCacheBackoff);
+  cmd.AddValue ("aggregationWindow", "Seconds SALLY holds OLSR and AODV broadcasts to send them in one datagram (0 disables)", aggregationWindow);
+  cmd.AddValue ("compactHello", "SALLY OLSR sends HELLOs as neighbor set deltas between full refreshes", compactHello);
+  cmd.AddValue ("linkFailureThreshold", "Unicast frames lost in a row before SALLY OLSR drops the link (0 waits for the hold time)", linkFailureThreshold);
+  cmd.AddValue ("incrementalRoutes", "SALLY OLSR updates only the routes a topology change affects", incrementalRoutes);
+  cmd.AddValue ("bitsetMpr", "SALLY OLSR selects MPRs on coverage bitsets", bitsetMpr);
+  cmd.AddValue ("indexedDuplicates", "SALLY OLSR hashes its duplicate set and expires it on a timing wheel", indexedDuplicates);
+  cmd.AddValue ("indexedLinks", "SALLY OLSR hashes its link set and runs the link timers from a timing wheel", indexedLinks);
+  cmd.AddValue ("coalescedTimers", "SALLY OLSR sends its periodic messages from one timer per node", coalescedTimers);
+  cmd.AddValue ("seed", "Random seed (0 seeds from the current time)", seed);
   cmd.Parse (argc, argv);
   return protocolName;
 }
@@ -263,7 +297,10 @@ RoutingExperiment::Run (double txp)
   double nodeSpeed = 1.5;
   int nodePause = 10;
 
-  uint32_t seed = (unsigned)time(0);
+  if (seed == 0)
+    {
+      seed = (unsigned)time(0);
+    }
   SeedManager::SetSeed (seed);  // Changes seed from default of 1 to 3
 
   Config::SetDefault  ("ns3::OnOffApplication::PacketSize",StringValue ("64"));
@@ -367,8 +404,22 @@ RoutingExperiment::Run (double txp)
       internet.Install (adhocNodes);
     } else if (protocolName =="SALLY") {
       sally.SetNumberHybridNodes(nNodes);
-      internet.SetRoutingHelper (sally);
-      internet.Install (adhocNodes);
+      sally.SetOlsrAttribute ("AdaptiveHello", BooleanValue (adaptiveHello));
+      sally.SetAodvAttribute ("MprRelay", BooleanValue (mprRelay));
+      sally.SetRoutingAttribute ("SharedNeighborSensing", BooleanValue (sharedNeighbors));
+      sally.SetRoutingAttribute ("SeedAodvRoutes", BooleanValue (seedAodvRoutes));
+      sally.SetRoutingAttribute ("LocalRepair", BooleanValue (localRepair));
+      sally.SetRoutingAttribute ("DeferralQueueSize", UintegerValue (deferralQueue));
+      sally.SetRoutingAttribute ("NegativeCacheBackoff", TimeValue (Seconds (negativeCacheBackoff)));
+      sally.SetRoutingAttribute ("ControlAggregationWindow", TimeValue (Seconds (aggregationWindow)));
+      sally.SetOlsrAttribute ("CompactHello", BooleanValue (compactHello));
+      sally.SetOlsrAttribute ("LinkFailureThreshold", UintegerValue (linkFailureThreshold));
+      sally.SetOlsrAttribute ("IncrementalRoutes", BooleanValue (incrementalRoutes));
+      sally.SetOlsrAttribute ("BitsetMpr", BooleanValue (bitsetMpr));
+      sally.SetOlsrAttribute ("IndexedDuplicates", BooleanValue (indexedDuplicates));
+      sally.SetOlsrAttribute ("IndexedLinks", BooleanValue (indexedLinks));
+      sally.SetOlsrAttribute ("CoalescedTimers", BooleanValue (coalescedTimers));
+      sally.Install (internet, adhocNodes);
     } else {
       NS_FATAL_ERROR ("No such protocol:");
     }
@@ -431,6 +482,86 @@ RoutingExperiment::Run (double txp)
   filename << protocolName << ".flomonitor.5." << nNodes;
   flowmon->SerializeToXmlFile(filename.str().c_str(), false, false);
 
+  uint32_t routeCacheHits = 0;
+  uint32_t routeCacheMisses = 0;
+  uint32_t rreqRelays = 0;
+  uint32_t rreqRelaysSuppressed = 0;
+  uint32_t hellosAvoided = 0;
+  uint32_t routesSeeded = 0;
+  uint32_t discoveries = 0;
+  Time discoveryLatency = Seconds (0);
+  uint32_t localRepairs = 0;
+  uint32_t localRepairFailures = 0;
+  uint32_t deferredPackets = 0;
+  uint32_t deferredReleased = 0;
+  uint32_t deferralDrops = 0;
+  uint32_t rreqsCoalesced = 0;
+  uint32_t discoveryBatches = 0;
+  uint32_t extensionReplies = 0;
+  uint32_t discoveryRetries = 0;
+  uint32_t rreqsSuppressed = 0;
+  uint32_t lateRoutes = 0;
+  uint32_t controlContainers = 0;
+  uint32_t controlMessagesAggregated = 0;
+  uint32_t fullHellos = 0;
+  uint32_t deltaHellos = 0;
+  int64_t helloBytesSaved = 0;
+  uint32_t linkBreaks = 0;
+  Time linkBreakLatency = Seconds (0);
+  Time holdTimeSaved = Seconds (0);
+  uint32_t duplicateTimersSaved = 0;
+  uint32_t linkTimersSaved = 0;
+  uint32_t protocolTicks = 0;
+  for (int i = 0; i < nNodes; i++)
+    {
+      Ptr<SallyRouting> sallyRouting = DynamicCast<SallyRouting> (adhocNodes.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      if (sallyRouting)
+        {
+          routeCacheHits += sallyRouting->GetRouteCacheHits ();
+          routeCacheMisses += sallyRouting->GetRouteCacheMisses ();
+          deferredPackets += sallyRouting->GetDeferredPackets ();
+          deferredReleased += sallyRouting->GetDeferredReleased ();
+          deferralDrops += sallyRouting->GetDeferralDrops ();
+          rreqsCoalesced += sallyRouting->GetRreqsCoalesced ();
+          discoveryBatches += sallyRouting->GetDiscoveryBatches ();
+          discoveryRetries += sallyRouting->GetDiscoveryRetries ();
+          rreqsSuppressed += sallyRouting->GetRreqsSuppressed ();
+          lateRoutes += sallyRouting->GetLateRoutes ();
+          controlContainers += sallyRouting->GetControlContainers ();
+          controlMessagesAggregated += sallyRouting->GetControlMessagesAggregated ();
+        }
+      Ptr<sally::SOlsrRoutingProtocol> solsr = adhocNodes.Get (i)->GetObject<sally::SOlsrRoutingProtocol> ();
+      if (solsr)
+        {
+          fullHellos += solsr->GetFullHellos ();
+          deltaHellos += solsr->GetDeltaHellos ();
+          helloBytesSaved += solsr->GetHelloBytesSaved ();
+          linkBreaks += solsr->GetLinkBreaks ();
+          linkBreakLatency += solsr->GetLinkBreakLatency ();
+          holdTimeSaved += solsr->GetHoldTimeSaved ();
+          duplicateTimersSaved += solsr->GetDuplicateTimersSaved ();
+          linkTimersSaved += solsr->GetLinkTimersSaved ();
+          protocolTicks += solsr->GetProtocolTicks ();
+        }
+      Ptr<sally::SAodvRoutingProtocol> saodv = adhocNodes.Get (i)->GetObject<sally::SAodvRoutingProtocol> ();
+      if (saodv)
+        {
+          rreqRelays += saodv->GetRreqRelays ();
+          rreqRelaysSuppressed += saodv->GetRreqRelaysSuppressed ();
+          hellosAvoided += saodv->GetHellosAvoided ();
+          routesSeeded += saodv->GetRoutesSeeded ();
+          discoveries += saodv->GetDiscoveries ();
+          discoveryLatency += saodv->GetDiscoveryLatency ();
+          localRepairs += saodv->GetLocalRepairs ();
+          localRepairFailures += saodv->GetLocalRepairFailures ();
+          extensionReplies += saodv->GetExtensionReplies ();
+        }
+    }
+
+  // An AODV HELLO is a 20 byte RREP plus UDP, IPv4, LLC and MAC headers,
+  // broadcast behind a long DSSS preamble.
+  double helloAirtime = 192e-6 + (20 + 8 + 20 + 8 + 28) * 8.0 / WifiMode (phyMode).GetDataRate ();
+
   std::ostringstream filename2;
   filename2 << protocolName << ".custom.5." << nNodes;
   std::ofstream os (filename2.str().c_str(), std::ios::out|std::ios::binary);
@@ -445,6 +576,37 @@ RoutingExperiment::Run (double txp)
 		  << "\" olsrPacketSizeReceived=\"" << olsrPacketSizeReceived
 		  << "\" olsrPacketSizeSent=\"" << olsrPacketSizeSent
 		  << "\" totalEnergy=\"" << totalEnergy
+		  << "\" routeCacheHits=\"" << routeCacheHits
+		  << "\" routeCacheMisses=\"" << routeCacheMisses
+		  << "\" rreqRelays=\"" << rreqRelays
+		  << "\" rreqRelaysSuppressed=\"" << rreqRelaysSuppressed
+		  << "\" hellosAvoided=\"" << hellosAvoided
+		  << "\" helloAirtimeSaved=\"" << hellosAvoided * helloAirtime
+		  << "\" routesSeeded=\"" << routesSeeded
+		  << "\" localRepairs=\"" << localRepairs
+		  << "\" localRepairFailures=\"" << localRepairFailures
+		  << "\" routeDiscoveries=\"" << discoveries
+		  << "\" meanDiscoveryLatency=\"" << (discoveries > 0 ? discoveryLatency.GetSeconds () / discoveries : 0)
+		  << "\" deferredPackets=\"" << deferredPackets
+		  << "\" deferredReleased=\"" << deferredReleased
+		  << "\" deferralDrops=\"" << deferralDrops
+		  << "\" rreqsCoalesced=\"" << rreqsCoalesced
+		  << "\" discoveryBatches=\"" << discoveryBatches
+		  << "\" extensionReplies=\"" << extensionReplies
+		  << "\" discoveryRetries=\"" << discoveryRetries
+		  << "\" rreqsSuppressed=\"" << rreqsSuppressed
+		  << "\" lateRoutes=\"" << lateRoutes
+		  << "\" controlContainers=\"" << controlContainers
+		  << "\" controlMessagesAggregated=\"" << controlMessagesAggregated
+		  << "\" fullHellos=\"" << fullHellos
+		  << "\" deltaHellos=\"" << deltaHellos
+		  << "\" helloBytesSaved=\"" << helloBytesSaved
+		  << "\" linkBreaks=\"" << linkBreaks
+		  << "\" meanLinkBreakLatency=\"" << (linkBreaks > 0 ? linkBreakLatency.GetSeconds () / linkBreaks : 0)
+		  << "\" meanHoldTimeSaved=\"" << (linkBreaks > 0 ? holdTimeSaved.GetSeconds () / linkBreaks : 0)
+		  << "\" duplicateTimersSaved=\"" << duplicateTimersSaved
+		  << "\" linkTimersSaved=\"" << linkTimersSaved
+		  << "\" protocolTicks=\"" << protocolTicks
 		  << "\" />\n</CustomStats>";
   os.close();
   Simulator::Destroy ();
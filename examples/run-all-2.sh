@@ -1,41 +0,0 @@
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=5 --numSinks=3";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=5 --numSinks=3";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=5 --numSinks=3";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=5 --numSinks=3";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=10 --numSinks=5";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=10 --numSinks=5";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=10 --numSinks=5";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=10 --numSinks=5";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=15 --numSinks=7";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=15 --numSinks=7";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=15 --numSinks=7";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=15 --numSinks=7";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=20 --numSinks=9";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=20 --numSinks=9";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=20 --numSinks=9";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=20 --numSinks=9";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=25 --numSinks=12";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=25 --numSinks=12";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=25 --numSinks=12";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=25 --numSinks=12";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=30 --numSinks=14";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=30 --numSinks=14";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=30 --numSinks=14";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=30 --numSinks=14";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=35 --numSinks=17";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=35 --numSinks=17";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=35 --numSinks=17";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=35 --numSinks=17";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=40 --numSinks=19";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=40 --numSinks=19";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=40 --numSinks=19";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=40 --numSinks=19";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=45 --numSinks=22";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=45 --numSinks=22";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=45 --numSinks=22";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=45 --numSinks=22";
-./waf --run "scratch/manet-routing-compare --protocol=SALLY --numNodes=50 --numSinks=24";
-./waf --run "scratch/manet-routing-compare --protocol=AODV --numNodes=50 --numSinks=24";
-./waf --run "scratch/manet-routing-compare --protocol=OLSR --numNodes=50 --numSinks=24";
-./waf --run "scratch/manet-routing-compare --protocol=CHAINED --numNodes=50 --numSinks=24";
-
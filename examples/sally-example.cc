@@ -122,7 +122,7 @@ int main (int argc, char *argv[])
   double interval = 1.0; // seconds
   bool verbose = false;
   bool tracing = true;
-  int numHybridNodes = 0;
+  int numHybridNodes = -1;
 
   CommandLine cmd;
 
@@ -136,7 +136,7 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
   cmd.AddValue ("sinkNode", "Receiver node number", sinkNode);
   cmd.AddValue ("sourceNode", "Sender node number", sourceNode);
-  cmd.AddValue("numHybridNodes", "Number of hybrid nodes to use", numHybridNodes);
+  cmd.AddValue("numHybridNodes", "Number of hybrid nodes to use (-1 for all)", numHybridNodes);
   cmd.Parse (argc, argv);
 
   cmd.Parse (argc, argv);
@@ -200,6 +200,7 @@ int main (int argc, char *argv[])
   Ipv4StaticRoutingHelper staticRouting;
 
   sally.Add (staticRouting, 0);
+  sally.AssignRoles (c);
 
   InternetStackHelper internet;
   internet.SetRoutingHelper (sally); // has effect on the next Install ()
@@ -0,0 +1,129 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Measures the cost of installing SALLY with InternetStackHelper.
+//
+// For each node count the program installs the Internet stack with a
+// SallyHelper and prints the wall time of InternetStackHelper::Install
+// and the growth of the resident set size (read from /proc/self/status,
+// so RSS is only reported on Linux).  It also times a batch of copies
+// of a helper with an Add () entry, which used to grow and leak with
+// every copy.
+//
+// ./waf --run "sally-install-benchmark --sizes=100,1000,10000"
+//
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/sally-helper.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("SallyInstallBenchmark");
+
+using namespace ns3;
+
+// \returns the resident set size in kB, or 0 if it cannot be read
+static uint64_t
+GetRssKb (void)
+{
+  std::ifstream status ("/proc/self/status");
+  std::string line;
+  while (std::getline (status, line))
+    {
+      if (line.compare (0, 6, "VmRSS:") == 0)
+        {
+          std::istringstream iss (line.substr (6));
+          uint64_t kb = 0;
+          iss >> kb;
+          return kb;
+        }
+    }
+  return 0;
+}
+
+static void
+RunInstall (uint32_t numNodes)
+{
+  NodeContainer c;
+  c.Create (numNodes);
+
+  SallyHelper sally;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (sally);
+
+  uint64_t rssBefore = GetRssKb ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  internet.Install (c);
+  int64_t elapsed = clock.End ();
+  uint64_t rssAfter = GetRssKb ();
+
+  std::cout << numNodes << " nodes: install " << elapsed << " ms, RSS +"
+            << (rssAfter - rssBefore) << " kB ("
+            << (numNodes > 0 ? (rssAfter - rssBefore) * 1024 / numNodes : 0) << " B/node)" << std::endl;
+
+  Simulator::Destroy ();
+}
+
+static void
+RunCopies (uint32_t copies)
+{
+  SallyHelper sally;
+  Ipv4StaticRoutingHelper staticRouting;
+  sally.Add (staticRouting, 0);
+  uint64_t rssBefore = GetRssKb ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < copies; i++)
+    {
+      SallyHelper *copy = sally.Copy ();
+      delete copy;
+    }
+  int64_t elapsed = clock.End ();
+  std::cout << copies << " helper copies: " << elapsed << " ms, RSS +"
+            << (GetRssKb () - rssBefore) << " kB" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  std::string sizes = "100,1000,10000";
+  uint32_t copies = 100000;
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "comma-separated node counts", sizes);
+  cmd.AddValue ("copies", "number of helper copies to time", copies);
+  cmd.Parse (argc, argv);
+
+  std::istringstream iss (sizes);
+  std::string size;
+  while (std::getline (iss, size, ','))
+    {
+      RunInstall (atoi (size.c_str ()));
+    }
+  RunCopies (copies);
+
+  return 0;
+}
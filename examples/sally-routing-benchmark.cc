@@ -0,0 +1,203 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Benchmark of the SOLSR routing table computation against the node count.
+//
+// Two SOLSR instances on one node are given the same synthetic state: a
+// square grid of the requested size with this node in the corner, its
+// grid neighbors as symmetric neighbors and every other grid link as a
+// topology tuple.  One instance rebuilds the routing table the stock
+// OLSR way, the other keeps the IncrementalRoutes index.  Random topology
+// links are then removed and restored, and the average wall clock time
+// of the recomputation following each change is printed per grid size.
+//
+// ./waf --run "sally-routing-benchmark --sizes=100,200,500,1000,2000 --changes=200"
+//
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/solsr-routing-protocol.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("SallyRoutingBenchmark");
+
+using namespace ns3;
+
+static Ipv4Address
+GridAddress (uint32_t index)
+{
+  return Ipv4Address (Ipv4Address ("10.0.0.1").Get () + index);
+}
+
+// Fills the state of \p protocol with a side x side grid seen from node 0.
+static void
+BuildGrid (Ptr<sally::SOlsrRoutingProtocol> protocol, uint32_t nodes, std::vector<olsr::TopologyTuple> &topology)
+{
+  uint32_t side = std::ceil (std::sqrt (double (nodes)));
+  Time forever = Seconds (1e6);
+  topology.clear ();
+  for (uint32_t i = 0; i < nodes; i++)
+    {
+      uint32_t next[2] = { i % side + 1 < side ? i + 1 : nodes, i + side };
+      for (int n = 0; n < 2; n++)
+        {
+          if (next[n] >= nodes)
+            {
+              continue;
+            }
+          uint32_t ends[2][2] = { { i, next[n] }, { next[n], i } };
+          for (int d = 0; d < 2; d++)
+            {
+              uint32_t from = ends[d][0];
+              uint32_t to = ends[d][1];
+              if (from == 0)
+                {
+                  olsr::LinkTuple link;
+                  link.localIfaceAddr = GridAddress (0);
+                  link.neighborIfaceAddr = GridAddress (to);
+                  link.symTime = forever;
+                  link.asymTime = forever;
+                  link.time = forever;
+                  protocol->m_state.InsertLinkTuple (link);
+                  olsr::NeighborTuple neighbor;
+                  neighbor.neighborMainAddr = GridAddress (to);
+                  neighbor.status = olsr::NeighborTuple::STATUS_SYM;
+                  neighbor.willingness = 3;
+                  protocol->m_state.InsertNeighborTuple (neighbor);
+                }
+              else if (to != 0)
+                {
+                  olsr::TopologyTuple tuple;
+                  tuple.destAddr = GridAddress (to);
+                  tuple.lastAddr = GridAddress (from);
+                  tuple.sequenceNumber = 1;
+                  tuple.expirationTime = forever;
+                  protocol->m_state.InsertTopologyTuple (tuple);
+                  topology.push_back (tuple);
+                }
+            }
+        }
+    }
+  // The neighbors of our neighbors are also 2-hop neighbors.
+  for (std::vector<olsr::TopologyTuple>::const_iterator t = topology.begin (); t != topology.end (); t++)
+    {
+      if (protocol->m_state.FindSymNeighborTuple (t->lastAddr) != NULL)
+        {
+          olsr::TwoHopNeighborTuple twoHop;
+          twoHop.neighborMainAddr = t->lastAddr;
+          twoHop.twoHopNeighborAddr = t->destAddr;
+          twoHop.expirationTime = forever;
+          protocol->m_state.InsertTwoHopNeighborTuple (twoHop);
+        }
+    }
+}
+
+// \returns the average milliseconds per routing table computation over
+// \p changes topology links removed and restored.
+static double
+TimeChanges (Ptr<sally::SOlsrRoutingProtocol> protocol, const std::vector<olsr::TopologyTuple> &topology,
+             const std::vector<uint32_t> &changes)
+{
+  protocol->RoutingTableComputation ();
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (std::vector<uint32_t>::const_iterator i = changes.begin (); i != changes.end (); i++)
+    {
+      protocol->m_state.EraseTopologyTuple (topology[*i]);
+      protocol->RoutingTableComputation ();
+      protocol->m_state.InsertTopologyTuple (topology[*i]);
+      protocol->RoutingTableComputation ();
+    }
+  int64_t elapsed = clock.End ();
+  return double (elapsed) / (2 * changes.size ());
+}
+
+int main (int argc, char *argv[])
+{
+  std::string sizes = "100,200,500,1000,2000";
+  uint32_t changes = 200;
+
+  CommandLine cmd;
+  cmd.AddValue ("sizes", "comma-separated node counts to measure", sizes);
+  cmd.AddValue ("changes", "topology links removed and restored per node count", changes);
+  cmd.Parse (argc, argv);
+
+  Ptr<Node> node = CreateObject<Node> ();
+  InternetStackHelper internet;
+  internet.Install (node);
+  Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  node->AddDevice (device);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.0.0.0");
+  address.Assign (NetDeviceContainer (device));
+  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+
+  std::cout << std::setw (8) << "nodes" << std::setw (14) << "full (ms)"
+            << std::setw (14) << "incr. (ms)" << std::setw (14) << "visited" << std::endl;
+  std::istringstream list (sizes);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      uint32_t nodes = std::atoi (item.c_str ());
+      Ptr<sally::SOlsrRoutingProtocol> full = CreateObject<sally::SOlsrRoutingProtocol> ();
+      Ptr<sally::SOlsrRoutingProtocol> incremental = CreateObject<sally::SOlsrRoutingProtocol> ();
+      incremental->SetAttribute ("IncrementalRoutes", BooleanValue (true));
+      std::vector<olsr::TopologyTuple> topology;
+      Ptr<sally::SOlsrRoutingProtocol> both[2] = { full, incremental };
+      for (int p = 0; p < 2; p++)
+        {
+          both[p]->SetIpv4 (ipv4);
+          both[p]->m_mainAddress = GridAddress (0);
+          BuildGrid (both[p], nodes, topology);
+        }
+      std::vector<uint32_t> picks;
+      for (uint32_t i = 0; i < changes && !topology.empty (); i++)
+        {
+          picks.push_back (random->GetInteger (0, topology.size () - 1));
+        }
+      if (picks.empty ())
+        {
+          continue;
+        }
+
+      double fullMs = TimeChanges (full, topology, picks);
+      incremental->RoutingTableComputation ();
+      uint32_t visitedBefore = incremental->GetRoutesVisited ();
+      double incrementalMs = TimeChanges (incremental, topology, picks);
+      double visited = double (incremental->GetRoutesVisited () - visitedBefore) / (2 * picks.size ());
+      NS_ABORT_MSG_UNLESS (full->GetRoutingTableEntries ().size () == incremental->GetRoutingTableEntries ().size (),
+                           "incremental routing table differs from the full one");
+
+      std::cout << std::setw (8) << nodes << std::setw (14) << fullMs
+                << std::setw (14) << incrementalMs << std::setw (14) << visited << std::endl;
+      full->Dispose ();
+      incremental->Dispose ();
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
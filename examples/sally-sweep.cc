@@ -0,0 +1,371 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Parallel parameter sweep of manet-routing-compare.
+//
+// Every combination of the protocols, network sizes and seeds given on
+// the command line is run as a child process of the already built
+// simulation program, as many at a time as there are job slots (one per
+// core by default).  The network sizes are the nodes:sinks pairs of
+// --pairs, by default those of the old run-all-2.sh script.  Giving
+// --numNodes instead runs every node count with every sink count of
+// --numSinks (half the nodes when empty).  Each run is executed in its own directory
+// <output>/<protocol>-<nodes>-<sinks>-<seed>, which receives the flow
+// monitor and custom statistics files as well as the output of the run
+// in run.log.
+//
+// The runs are sorted by decreasing node count and dealt round robin to
+// a queue per slot.  A slot takes the largest run left in its own queue
+// and, once it is empty, steals the smallest run from the back of the
+// longest queue, so the slots stay busy until the end of the sweep.
+//
+// Run it through waf once so that the children find the ns-3 libraries:
+//
+// ./waf --run "sally-sweep --program=build/scratch/manet-routing-compare
+//              --protocols=SALLY,AODV,OLSR,CHAINED --pairs=5:3,10:5,15:7,20:9,25:12
+//              --seeds=1,2,3,4,5,6,7,8,9,10 --output=sweep"
+//
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("SallySweep");
+
+using namespace ns3;
+
+struct SweepRun
+{
+  std::string protocol;
+  uint32_t nodes;
+  uint32_t sinks;
+  uint32_t seed;
+
+  std::string GetName () const
+  {
+    std::ostringstream name;
+    name << protocol << "-" << nodes << "-" << sinks << "-" << seed;
+    return name.str ();
+  }
+};
+
+static std::vector<std::string>
+SplitList (const std::string &list, char separator)
+{
+  std::vector<std::string> items;
+  std::istringstream stream (list);
+  std::string item;
+  while (std::getline (stream, item, separator))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+static std::vector<uint32_t>
+SplitNumbers (const std::string &list)
+{
+  std::vector<uint32_t> numbers;
+  std::vector<std::string> items = SplitList (list, ',');
+  for (std::vector<std::string>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      numbers.push_back (std::strtoul (i->c_str (), NULL, 10));
+    }
+  return numbers;
+}
+
+// Parses a comma-separated list of nodes:sinks pairs.
+static std::vector<std::pair<uint32_t, uint32_t> >
+SplitPairs (const std::string &list)
+{
+  std::vector<std::pair<uint32_t, uint32_t> > pairs;
+  std::vector<std::string> items = SplitList (list, ',');
+  for (std::vector<std::string>::const_iterator i = items.begin (); i != items.end (); i++)
+    {
+      std::string::size_type colon = i->find (':');
+      if (colon == std::string::npos)
+        {
+          NS_FATAL_ERROR ("expected nodes:sinks instead of " << *i);
+        }
+      uint32_t nodes = std::strtoul (i->substr (0, colon).c_str (), NULL, 10);
+      uint32_t sinks = std::strtoul (i->substr (colon + 1).c_str (), NULL, 10);
+      pairs.push_back (std::make_pair (nodes, sinks));
+    }
+  return pairs;
+}
+
+// Larger networks run longer, so they are started first.
+static bool
+RunsLongerThan (const SweepRun &a, const SweepRun &b)
+{
+  return a.nodes > b.nodes || (a.nodes == b.nodes && a.sinks > b.sinks);
+}
+
+static void
+MakeDirectory (const std::string &path)
+{
+  std::string partial;
+  std::vector<std::string> parts = SplitList (path, '/');
+  if (!path.empty () && path[0] == '/')
+    {
+      partial = "/";
+    }
+  for (std::vector<std::string>::const_iterator i = parts.begin (); i != parts.end (); i++)
+    {
+      partial += *i + "/";
+      if (mkdir (partial.c_str (), 0755) != 0 && errno != EEXIST)
+        {
+          NS_FATAL_ERROR ("cannot create " << partial << ": " << std::strerror (errno));
+        }
+    }
+}
+
+// Starts \p run in \p directory and returns the pid of the child.
+static pid_t
+StartRun (const std::string &program, const std::vector<std::string> &extraArgs,
+          const SweepRun &run, const std::string &directory)
+{
+  std::vector<std::string> args;
+  args.push_back (program);
+  std::ostringstream arg;
+  arg << "--protocol=" << run.protocol;
+  args.push_back (arg.str ());
+  arg.str ("");
+  arg << "--numNodes=" << run.nodes;
+  args.push_back (arg.str ());
+  arg.str ("");
+  arg << "--numSinks=" << run.sinks;
+  args.push_back (arg.str ());
+  arg.str ("");
+  arg << "--seed=" << run.seed;
+  args.push_back (arg.str ());
+  args.insert (args.end (), extraArgs.begin (), extraArgs.end ());
+  std::vector<char *> argv;
+  for (std::vector<std::string>::iterator i = args.begin (); i != args.end (); i++)
+    {
+      argv.push_back (&(*i)[0]);
+    }
+  argv.push_back (NULL);
+  std::string log = directory + "/run.log";
+
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("fork failed: " << std::strerror (errno));
+    }
+  if (pid > 0)
+    {
+      return pid;
+    }
+
+  // Child: only system calls from here on.
+  int fd = open (log.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (chdir (directory.c_str ()) != 0 || fd < 0)
+    {
+      _exit (126);
+    }
+  dup2 (fd, STDOUT_FILENO);
+  dup2 (fd, STDERR_FILENO);
+  close (fd);
+  execv (argv[0], &argv[0]);
+  _exit (127);
+}
+
+int main (int argc, char *argv[])
+{
+  std::string program = "build/scratch/manet-routing-compare";
+  std::string protocols = "SALLY,AODV,OLSR,CHAINED";
+  std::string pairs = "5:3,10:5,15:7,20:9,25:12,30:14,35:17,40:19,45:22,50:24";
+  std::string numNodes = "";
+  std::string numSinks = "";
+  std::string seeds = "1";
+  std::string args = "";
+  std::string output = "sweep";
+  uint32_t jobs = 0;
+
+  CommandLine cmd;
+  cmd.AddValue ("program", "Simulation program run for each configuration", program);
+  cmd.AddValue ("protocols", "Comma-separated protocols", protocols);
+  cmd.AddValue ("pairs", "Comma-separated nodes:sinks pairs", pairs);
+  cmd.AddValue ("numNodes", "Comma-separated node counts, run instead of the pairs", numNodes);
+  cmd.AddValue ("numSinks", "Comma-separated sink counts for numNodes (empty uses half the nodes)", numSinks);
+  cmd.AddValue ("seeds", "Comma-separated random seeds", seeds);
+  cmd.AddValue ("args", "Space-separated arguments added to every run", args);
+  cmd.AddValue ("output", "Directory that receives a directory per run", output);
+  cmd.AddValue ("jobs", "Runs executed at the same time (0 uses every core)", jobs);
+  cmd.Parse (argc, argv);
+
+  char resolved[PATH_MAX];
+  if (realpath (program.c_str (), resolved) == NULL)
+    {
+      NS_FATAL_ERROR ("cannot find the simulation program " << program);
+    }
+  program = resolved;
+  if (jobs == 0)
+    {
+      long cores = sysconf (_SC_NPROCESSORS_ONLN);
+      jobs = cores > 0 ? cores : 1;
+    }
+
+  std::vector<std::string> protocolList = SplitList (protocols, ',');
+  std::vector<uint32_t> seedList = SplitNumbers (seeds);
+  std::vector<std::pair<uint32_t, uint32_t> > sizes;
+  if (numNodes.empty ())
+    {
+      sizes = SplitPairs (pairs);
+    }
+  else
+    {
+      std::vector<uint32_t> nodeList = SplitNumbers (numNodes);
+      std::vector<uint32_t> sinkList = SplitNumbers (numSinks);
+      for (std::vector<uint32_t>::const_iterator n = nodeList.begin (); n != nodeList.end (); n++)
+        {
+          if (sinkList.empty ())
+            {
+              sizes.push_back (std::make_pair (*n, std::max (*n / 2, 1u)));
+            }
+          for (std::vector<uint32_t>::const_iterator k = sinkList.begin (); k != sinkList.end (); k++)
+            {
+              sizes.push_back (std::make_pair (*n, *k));
+            }
+        }
+    }
+
+  std::vector<SweepRun> runs;
+  for (std::vector<std::string>::const_iterator p = protocolList.begin (); p != protocolList.end (); p++)
+    {
+      for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator n = sizes.begin (); n != sizes.end (); n++)
+        {
+          if (n->second > n->first)
+            {
+              continue;
+            }
+          for (std::vector<uint32_t>::const_iterator s = seedList.begin (); s != seedList.end (); s++)
+            {
+              SweepRun run;
+              run.protocol = *p;
+              run.nodes = n->first;
+              run.sinks = n->second;
+              run.seed = *s;
+              runs.push_back (run);
+            }
+        }
+    }
+  std::stable_sort (runs.begin (), runs.end (), RunsLongerThan);
+
+  std::vector<std::deque<SweepRun> > queues (jobs);
+  for (uint32_t i = 0; i < runs.size (); i++)
+    {
+      queues[i % jobs].push_back (runs[i]);
+    }
+
+  std::vector<std::string> extraArgs = SplitList (args, ' ');
+  std::map<pid_t, std::pair<uint32_t, SweepRun> > running;
+  uint32_t finished = 0;
+  uint32_t failed = 0;
+  std::vector<bool> busy (jobs, false);
+  std::cout << "Running " << runs.size () << " configurations on " << jobs << " slots" << std::endl;
+  while (true)
+    {
+      for (uint32_t slot = 0; slot < jobs; slot++)
+        {
+          if (busy[slot])
+            {
+              continue;
+            }
+          SweepRun run;
+          if (!queues[slot].empty ())
+            {
+              run = queues[slot].front ();
+              queues[slot].pop_front ();
+            }
+          else
+            {
+              uint32_t victim = slot;
+              for (uint32_t other = 0; other < jobs; other++)
+                {
+                  if (queues[other].size () > queues[victim].size ())
+                    {
+                      victim = other;
+                    }
+                }
+              if (queues[victim].empty ())
+                {
+                  continue;
+                }
+              run = queues[victim].back ();
+              queues[victim].pop_back ();
+            }
+          std::string directory = output + "/" + run.GetName ();
+          MakeDirectory (directory);
+          pid_t pid = StartRun (program, extraArgs, run, directory);
+          running[pid] = std::make_pair (slot, run);
+          busy[slot] = true;
+        }
+      if (running.empty ())
+        {
+          break;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_FATAL_ERROR ("waitpid failed: " << std::strerror (errno));
+        }
+      std::map<pid_t, std::pair<uint32_t, SweepRun> >::iterator child = running.find (pid);
+      if (child == running.end ())
+        {
+          continue;
+        }
+      busy[child->second.first] = false;
+      finished++;
+      bool ok = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+      if (!ok)
+        {
+          failed++;
+        }
+      std::cout << "[" << finished << "/" << runs.size () << "] " << child->second.second.GetName ()
+                << (ok ? " done" : " FAILED, see run.log") << std::endl;
+      running.erase (child);
+    }
+
+  std::cout << finished - failed << " runs succeeded, " << failed << " failed" << std::endl;
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+//
+// Benchmark of the SOLSR CoalescedTimers attribute.
+//
+// A static grid of 802.11b nodes, set up as in
+// wifi-simple-adhoc-grid-sally, runs SOLSR alone without any data
+// traffic, once with a timer per periodic message and once with the
+// single per-node protocol tick.  The events inserted in the scheduler
+// and the wall clock time of each run are printed.
+//
+// ./waf --run "sally-timer-benchmark --numNodes=1000 --duration=30"
+//
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/wifi-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/sally-helper.h"
+#include "ns3/solsr-routing-protocol.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE ("SallyTimerBenchmark");
+
+using namespace ns3;
+
+// A MapScheduler that counts the events inserted into it.
+class CountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CountingScheduler")
+      .SetParent<MapScheduler> ()
+      .AddConstructor<CountingScheduler> ()
+    ;
+    return tid;
+  }
+  virtual void Insert (const Event &ev)
+  {
+    s_inserted++;
+    MapScheduler::Insert (ev);
+  }
+  static uint64_t s_inserted;
+};
+
+uint64_t CountingScheduler::s_inserted = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+struct RunResult
+{
+  uint64_t events;
+  int64_t wallMs;
+  uint32_t ticks;
+};
+
+static RunResult
+Run (bool coalesced, uint32_t numNodes, double distance, double duration)
+{
+  std::string phyMode ("DsssRate1Mbps");
+  NodeContainer c;
+  c.Create (numNodes);
+
+  WifiHelper wifi;
+  YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
+  wifiPhy.Set ("RxGain", DoubleValue (-10) );
+  YansWifiChannelHelper wifiChannel;
+  wifiChannel.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  wifiChannel.AddPropagationLoss ("ns3::FriisPropagationLossModel");
+  wifiPhy.SetChannel (wifiChannel.Create ());
+  NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211b);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode",StringValue (phyMode),
+                                "ControlMode",StringValue (phyMode));
+  wifiMac.SetType ("ns3::AdhocWifiMac");
+  NetDeviceContainer devices = wifi.Install (wifiPhy, wifiMac, c);
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "MinX", DoubleValue (0.0),
+                                 "MinY", DoubleValue (0.0),
+                                 "DeltaX", DoubleValue (distance),
+                                 "DeltaY", DoubleValue (distance),
+                                 "GridWidth", UintegerValue (std::ceil (std::sqrt (double (numNodes)))),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (c);
+
+  SallyHelper sally;
+  sally.SetNumberHybridNodes (0);
+  sally.SetSingleProtocol (SallyHelper::SOLSR_ONLY);
+  sally.SetOlsrAttribute ("CoalescedTimers", BooleanValue (coalesced));
+  Ipv4StaticRoutingHelper staticRouting;
+  sally.Add (staticRouting, 0);
+  sally.AssignRoles (c);
+
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (sally);
+  internet.Install (c);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.0.0.0", "255.255.0.0");
+  ipv4.Assign (devices);
+
+  CountingScheduler::s_inserted = 0;
+  Simulator::Stop (Seconds (duration));
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+
+  RunResult result;
+  result.wallMs = clock.End ();
+  result.events = CountingScheduler::s_inserted;
+  result.ticks = 0;
+  for (uint32_t n = 0; n < c.GetN (); n++)
+    {
+      Ptr<sally::SOlsrRoutingProtocol> solsr = c.Get (n)->GetObject<sally::SOlsrRoutingProtocol> ();
+      if (solsr != 0)
+        {
+          result.ticks += solsr->GetProtocolTicks ();
+        }
+    }
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+  return result;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t numNodes = 1000;
+  double distance = 500;  // m
+  double duration = 30;  // s
+
+  CommandLine cmd;
+  cmd.AddValue ("numNodes", "number of nodes in the grid", numNodes);
+  cmd.AddValue ("distance", "distance (m) between grid neighbors", distance);
+  cmd.AddValue ("duration", "simulated seconds per run", duration);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SchedulerType", TypeIdValue (CountingScheduler::GetTypeId ()));
+
+  std::cout << std::setw (12) << "timers" << std::setw (14) << "events"
+            << std::setw (12) << "wall (ms)" << std::setw (12) << "ticks" << std::endl;
+  const char *names[2] = { "per-message", "coalesced" };
+  for (int coalesced = 0; coalesced < 2; coalesced++)
+    {
+      RunResult result = Run (coalesced, numNodes, distance, duration);
+      std::cout << std::setw (12) << names[coalesced] << std::setw (14) << result.events
+                << std::setw (12) << result.wallMs << std::setw (12) << result.ticks << std::endl;
+    }
+  return 0;
+}
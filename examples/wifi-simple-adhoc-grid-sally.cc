@@ -68,6 +68,13 @@
 //
 // tcpdump -r wifi-simple-adhoc-grid-0-0.pcap -nn -tt
 //
+// To compare the ETX metric with the hop count at the edge of the radio
+// range, run the same configuration with and without --etx and compare
+// the throughput and jitter printed for each flow:
+//
+// ./waf --run "wifi-simple-adhoc-grid-sally --distance=500 --numPackets=100 --interval=0.1"
+// ./waf --run "wifi-simple-adhoc-grid-sally --distance=500 --numPackets=100 --interval=0.1 --etx=1"
+//
 
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -76,6 +83,7 @@
 #include "ns3/wifi-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/sally-helper.h"
+#include "ns3/solsr-routing-protocol.h"
 
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/ipv4-list-routing-helper.h"
@@ -122,7 +130,12 @@ int main (int argc, char *argv[])
   double interval = 1; // seconds
   bool verbose = false;
   bool tracing = true;
-  int numHybridNodes = 0;
+  int numHybridNodes = -1;
+  uint32_t hybridPlacement = 0;
+  std::string scopedTcRadii = "";
+  std::string scopedTcIntervals = "5,10,20";
+  bool adaptiveHello = false;
+  bool etx = false;
 
   CommandLine cmd;
 
@@ -136,7 +149,12 @@ int main (int argc, char *argv[])
   cmd.AddValue ("numNodes", "number of nodes", numNodes);
   cmd.AddValue ("sinkNode", "Receiver node number", sinkNode);
   cmd.AddValue ("sourceNode", "Sender node number", sourceNode);
-  cmd.AddValue("numHybridNodes", "Number of hybrid nodes to use", numHybridNodes);
+  cmd.AddValue("numHybridNodes", "Number of hybrid nodes to use (-1 for all)", numHybridNodes);
+  cmd.AddValue ("hybridPlacement", "0=first N, 1=degree, 2=grid center, 3=random", hybridPlacement);
+  cmd.AddValue ("scopedTcRadii", "TTL of each scoped TC ring, e.g. 2,4,8 (empty disables TC)", scopedTcRadii);
+  cmd.AddValue ("scopedTcIntervals", "TC interval (seconds) of each ring", scopedTcIntervals);
+  cmd.AddValue ("adaptiveHello", "Adapt the HELLO interval to link churn", adaptiveHello);
+  cmd.AddValue ("etx", "Select MPRs and routes by ETX instead of hop count", etx);
   cmd.Parse (argc, argv);
 
   cmd.Parse (argc, argv);
@@ -196,10 +214,21 @@ int main (int argc, char *argv[])
   // Enable AODV
   SallyHelper sally;
   sally.SetNumberHybridNodes(numHybridNodes);
+  sally.SetHybridPlacement ((SallyHelper::HybridPlacement) hybridPlacement);
+  sally.SetHybridPlacementRange (distance * 1.5);
+  sally.SetOlsrAttribute ("AdaptiveHello", BooleanValue (adaptiveHello));
+  sally.SetOlsrAttribute ("EtxMetric", BooleanValue (etx));
+  if (!scopedTcRadii.empty ())
+    {
+      sally.SetOlsrAttribute ("ScopedTc", BooleanValue (true));
+      sally.SetOlsrAttribute ("ScopedTcRadii", StringValue (scopedTcRadii));
+      sally.SetOlsrAttribute ("ScopedTcIntervals", StringValue (scopedTcIntervals));
+    }
 
   Ipv4StaticRoutingHelper staticRouting;
 
   sally.Add (staticRouting, 0);
+  sally.AssignRoles (c);
 
   InternetStackHelper internet;
   internet.SetRoutingHelper (sally); // has effect on the next Install ()
@@ -245,9 +274,32 @@ int main (int argc, char *argv[])
   Simulator::Run ();
   //throughput(flowMonHelper, flowMon)
   std::ostringstream filename;
-  filename << "sally.flomonitor." << numNodes;
+  filename << "sally.flomonitor." << numNodes << (etx ? ".etx" : "");
   flowMon->SerializeToXmlFile(filename.str().c_str(), true, true);
 
+  // Summary to compare runs with and without --etx.
+  flowMon->CheckForLostPackets ();
+  FlowMonitor::FlowStatsContainer stats = flowMon->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainer::const_iterator f = stats.begin (); f != stats.end (); f++)
+    {
+      double duration = (f->second.timeLastRxPacket - f->second.timeFirstTxPacket).GetSeconds ();
+      double throughput = duration > 0 ? f->second.rxBytes * 8.0 / duration / 1024 : 0;
+      double jitter = f->second.rxPackets > 1 ? f->second.jitterSum.GetSeconds () / (f->second.rxPackets - 1) : 0;
+      NS_LOG_UNCOND ("Flow " << f->first << ": " << f->second.rxPackets << "/" << f->second.txPackets
+                     << " packets, " << throughput << " Kbps, mean jitter " << jitter << " s");
+    }
+
+  uint32_t etxReroutes = 0;
+  for (uint32_t n = 0; n < numNodes; n++)
+    {
+      Ptr<sally::SOlsrRoutingProtocol> solsr = c.Get (n)->GetObject<sally::SOlsrRoutingProtocol> ();
+      if (solsr)
+        {
+          etxReroutes += solsr->GetEtxReroutes ();
+        }
+    }
+  NS_LOG_UNCOND ("Next hops changed by ETX: " << etxReroutes);
+
   Simulator::Destroy ();
 
   return 0;
@@ -22,18 +22,69 @@
 
 #include "ns3/aodv-routing-protocol.h"
 #include "ns3/olsr-routing-protocol.h"
-#include "ns3/aodv-helper.h"
+#include "ns3/saodv-helper.h"
 #include "ns3/olsr-helper.h"
 #include "ns3/solsr-helper.h"
 #include "ns3/sally-routing.h"
 #include "ns3/enum.h"
-#include "ns3/config.h"
+#include "ns3/nstime.h"
+#include "ns3/log.h"
+#include "ns3/mobility-model.h"
+#include "ns3/random-variable-stream.h"
+#include <algorithm>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("SallyHelper");
 
 namespace ns3
 {
 
+SallyHelper::Prototype::Prototype ()
+  : numberHybridNodes (-1),
+    placement (FIRST_N),
+    placementStream (0),
+    placementRange (250.0),
+    singleProtocol (SOLSR_ONLY)
+{
+  olsrHelper.Set ("HelloInterval", TimeValue (Seconds (4)));
+  routingFactory.SetTypeId ("ns3::SallyRouting");
+}
+
+SallyHelper::Prototype::Prototype (const Prototype &o)
+  : SimpleRefCount<Prototype> (o),
+    olsrHelper (o.olsrHelper),
+    aodvHelper (o.aodvHelper),
+    routingFactory (o.routingFactory),
+    numberHybridNodes (o.numberHybridNodes),
+    placement (o.placement),
+    placementStream (o.placementStream),
+    placementRange (o.placementRange),
+    singleProtocol (o.singleProtocol)
+{
+  for (HelperList::const_iterator i = o.list.begin (); i != o.list.end (); ++i)
+    {
+      list.push_back (std::make_pair (const_cast<const Ipv4RoutingHelper *> (i->first->Copy ()), i->second));
+    }
+}
+
+SallyHelper::Prototype::~Prototype ()
+{
+  for (HelperList::iterator i = list.begin (); i != list.end (); ++i)
+    {
+      delete i->first;
+    }
+}
+
+SallyHelper::Statistics::Statistics ()
+  : created (0),
+    hybridCreated (0)
+{
+}
+
 SallyHelper::SallyHelper():
-		Ipv4ListRoutingHelper (), number_of_hybrid_nodes(0)
+		Ipv4ListRoutingHelper (),
+		m_prototype (Create<Prototype> ()),
+		m_statistics (Create<Statistics> ())
 {
 }
 
@@ -41,24 +92,217 @@ SallyHelper::~SallyHelper()
 {
 }
 
+void
+SallyHelper::Add (const Ipv4RoutingHelper &routing, int16_t priority)
+{
+  GetWritablePrototype ()->list.push_back (std::make_pair (const_cast<const Ipv4RoutingHelper *> (routing.Copy ()), priority));
+}
+
+SallyHelper::Prototype *
+SallyHelper::GetWritablePrototype (void)
+{
+  if (m_prototype->GetReferenceCount () > 1)
+    {
+      m_prototype = Create<Prototype> (*m_prototype);
+    }
+  return PeekPointer (m_prototype);
+}
+
 void
 SallyHelper::SetNumberHybridNodes(int num) {
-	number_of_hybrid_nodes = num;
+	GetWritablePrototype ()->numberHybridNodes = num;
+	m_roles = 0;
 }
 
-SallyHelper::SallyHelper (const SallyHelper &o)
+void
+SallyHelper::SetHybridPlacement (enum HybridPlacement placement, int64_t stream)
+{
+  Prototype *prototype = GetWritablePrototype ();
+  prototype->placement = placement;
+  prototype->placementStream = stream;
+  m_roles = 0;
+}
+
+void
+SallyHelper::SetHybridPlacementRange (double range)
+{
+  GetWritablePrototype ()->placementRange = range;
+  m_roles = 0;
+}
+
+void
+SallyHelper::SetSingleProtocol (enum SingleProtocol protocol)
+{
+  GetWritablePrototype ()->singleProtocol = protocol;
+}
+
+void
+SallyHelper::SetOlsrAttribute (std::string name, const AttributeValue &value)
+{
+  GetWritablePrototype ()->olsrHelper.Set (name, value);
+}
+
+void
+SallyHelper::SetAodvAttribute (std::string name, const AttributeValue &value)
+{
+  GetWritablePrototype ()->aodvHelper.Set (name, value);
+}
+
+void
+SallyHelper::SetRoutingAttribute (std::string name, const AttributeValue &value)
+{
+  GetWritablePrototype ()->routingFactory.Set (name, value);
+}
+
+void
+SallyHelper::Install (InternetStackHelper &internet, NodeContainer c) const
+{
+  DoAssignRoles (c);
+  internet.SetRoutingHelper (*this);
+  internet.Install (c);
+}
+
+void
+SallyHelper::AssignRoles (NodeContainer c)
+{
+  DoAssignRoles (c);
+}
+
+static Vector
+GetInitialPosition (Ptr<Node> node)
+{
+  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+  if (mobility == 0)
+    {
+      NS_FATAL_ERROR ("Hybrid node placement needs a mobility model on node " << node->GetId ());
+    }
+  return mobility->GetPosition ();
+}
+
+void
+SallyHelper::DoAssignRoles (NodeContainer c) const
+{
+  // A fresh set: copies sharing the previous one are not affected.
+  Ptr<Roles> roles = Create<Roles> ();
+  m_roles = roles;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      roles->nodes.insert ((*i)->GetId ());
+    }
+  int numberHybridNodes = m_prototype->numberHybridNodes;
+  if (numberHybridNodes < 0 || (uint32_t) numberHybridNodes >= c.GetN ())
+    {
+      for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+        {
+          roles->hybridNodes.insert ((*i)->GetId ());
+        }
+      return;
+    }
+
+  // Rank the candidates, lowest score first, ties broken by node id.
+  std::vector<std::pair<double, uint32_t> > ranking;
+  switch (m_prototype->placement)
+    {
+    case FIRST_N:
+      for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+        {
+          ranking.push_back (std::make_pair (0.0, (*i)->GetId ()));
+        }
+      break;
+    case DEGREE:
+      {
+        std::vector<Vector> positions;
+        for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+          {
+            positions.push_back (GetInitialPosition (*i));
+          }
+        for (uint32_t i = 0; i < c.GetN (); i++)
+          {
+            uint32_t degree = 0;
+            for (uint32_t j = 0; j < c.GetN (); j++)
+              {
+                if (i != j && CalculateDistance (positions[i], positions[j]) <= m_prototype->placementRange)
+                  {
+                    degree++;
+                  }
+              }
+            ranking.push_back (std::make_pair (-(double) degree, c.Get (i)->GetId ()));
+          }
+      }
+      break;
+    case GRID_CENTER:
+      {
+        Vector centroid;
+        for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+          {
+            Vector position = GetInitialPosition (*i);
+            centroid.x += position.x / c.GetN ();
+            centroid.y += position.y / c.GetN ();
+            centroid.z += position.z / c.GetN ();
+          }
+        for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+          {
+            ranking.push_back (std::make_pair (CalculateDistance (GetInitialPosition (*i), centroid), (*i)->GetId ()));
+          }
+      }
+      break;
+    case RANDOM:
+      {
+        Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable> ();
+        rng->SetStream (m_prototype->placementStream);
+        for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+          {
+            ranking.push_back (std::make_pair (rng->GetValue (), (*i)->GetId ()));
+          }
+      }
+      break;
+    }
+  std::sort (ranking.begin (), ranking.end ());
+
+  for (int i = 0; i < numberHybridNodes; i++)
+    {
+      roles->hybridNodes.insert (ranking[i].second);
+      NS_LOG_DEBUG ("Node " << ranking[i].second << " is hybrid");
+    }
+}
+
+bool
+SallyHelper::IsHybrid (Ptr<Node> node) const
 {
-  SOlsrHelper olsr;
-  AodvHelper aodv;
-  std::list<std::pair<const Ipv4RoutingHelper *, int16_t> >::const_iterator i;
-  for (i = o.m_list.begin (); i != o.m_list.end (); ++i)
+  if (m_prototype->numberHybridNodes < 0)
+    {
+      return true;
+    }
+  if (m_roles == 0)
+    {
+      NS_FATAL_ERROR ("SallyHelper: call AssignRoles () or Install () before installing "
+                      << m_prototype->numberHybridNodes << " hybrid nodes");
+    }
+  if (m_roles->nodes.find (node->GetId ()) == m_roles->nodes.end ())
     {
-      m_list.push_back (std::make_pair (const_cast<const Ipv4RoutingHelper *> (i->first->Copy ()), i->second));
+      NS_FATAL_ERROR ("SallyHelper: node " << node->GetId () << " was not among the nodes given to AssignRoles ()");
     }
+  return m_roles->hybridNodes.find (node->GetId ()) != m_roles->hybridNodes.end ();
+}
+
+uint32_t
+SallyHelper::GetNumberCreated (void) const
+{
+  return m_statistics->created;
+}
 
-  m_list.push_back (std::make_pair (const_cast<const ns3::SOlsrHelper *> (olsr.Copy ()), 20));
-  m_list.push_back (std::make_pair (const_cast<const ns3::AodvHelper *> (aodv.Copy ()), 10));
-  number_of_hybrid_nodes = o.number_of_hybrid_nodes;
+uint32_t
+SallyHelper::GetNumberHybridCreated (void) const
+{
+  return m_statistics->hybridCreated;
+}
+
+SallyHelper::SallyHelper (const SallyHelper &o)
+  : Ipv4ListRoutingHelper (),
+    m_prototype (o.m_prototype),
+    m_roles (o.m_roles),
+    m_statistics (o.m_statistics)
+{
 }
 
 SallyHelper*
@@ -70,17 +314,27 @@ SallyHelper::Copy (void) const
 Ptr<Ipv4RoutingProtocol>
 SallyHelper::Create (Ptr<Node> node) const
 {
-  static int num_created = 0;
-  Ptr<SallyRouting> list = CreateObject<SallyRouting> ();
-  Config::SetDefault ("ns3::olsr::RoutingProtocol::HelloInterval", TimeValue (Seconds (4)));
-
-  for (std::list<std::pair<const Ipv4RoutingHelper *, int16_t> >::const_iterator i = m_list.begin ();
-		  i != m_list.end (); ++i)
-  {
-	  Ptr<Ipv4RoutingProtocol> prot = i->first->Create (node);
-	  list->AddRoutingProtocol (prot,i->second);
-  }
-  num_created++;
+  Ptr<SallyRouting> list = m_prototype->routingFactory.Create<SallyRouting> ();
+  for (HelperList::const_iterator i = m_prototype->list.begin (); i != m_prototype->list.end (); ++i)
+    {
+      list->AddRoutingProtocol (i->first->Create (node), i->second);
+    }
+
+  // Single-protocol nodes get either SOLSR or AODV.
+  bool hybrid = IsHybrid (node);
+  if (hybrid || m_prototype->singleProtocol == SOLSR_ONLY)
+    {
+      list->AddRoutingProtocol (m_prototype->olsrHelper.Create (node), 20);
+    }
+  if (hybrid || m_prototype->singleProtocol == AODV_ONLY)
+    {
+      list->AddRoutingProtocol (m_prototype->aodvHelper.Create (node), 10);
+    }
+  m_statistics->created++;
+  if (hybrid)
+    {
+      m_statistics->hybridCreated++;
+    }
   return list;
 
 }
@@ -22,10 +22,27 @@
 #define SALLY_HELPER_H
 
 #include "ns3/ipv4-list-routing-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/node-container.h"
+#include "ns3/saodv-helper.h"
+#include "ns3/solsr-helper.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/object-factory.h"
+#include <list>
+#include <set>
 
 namespace ns3
 {
 
+/**
+ * \brief Helper class that adds SALLY (SOLSR + AODV) routing to nodes.
+ *
+ * SOLSR and AODV are added by role, after the protocols given to Add ().
+ * All settings, the Add () list included, live in a reference-counted
+ * prototype shared between copies, so copying the helper (as
+ * InternetStackHelper does) is O(1); setters and Add () copy the
+ * prototype only when it is shared.
+ */
 class SallyHelper : public Ipv4ListRoutingHelper
 {
 public:
@@ -50,7 +67,97 @@ public:
      */
   SallyHelper* Copy (void) const;
   virtual Ptr<Ipv4RoutingProtocol> Create (Ptr<Node> node) const;
+
+  /**
+   * \param routing a routing helper
+   * \param priority the priority of the associated helper
+   *
+   * Store in the internal list a reference to the input routing helper
+   * and associated priority.  The protocols it creates are installed on
+   * every node next to SOLSR and AODV.
+   */
+  void Add (const Ipv4RoutingHelper &routing, int16_t priority);
+
+  /// How the hybrid (SOLSR + AODV) nodes are chosen.
+  enum HybridPlacement
+  {
+    FIRST_N,     ///< the N nodes with the lowest ids
+    DEGREE,      ///< the N nodes with most neighbors at their initial position
+    GRID_CENTER, ///< the N nodes closest to the centroid of all initial positions
+    RANDOM       ///< N nodes drawn uniformly from a fixed random stream
+  };
+
+  /// Protocol run by the nodes that are not hybrid.
+  enum SingleProtocol
+  {
+    SOLSR_ONLY,
+    AODV_ONLY
+  };
+
+  /**
+   * \param num number of nodes running both SOLSR and AODV; a negative
+   * value (the default) makes every node hybrid
+   */
   void SetNumberHybridNodes(int num);
+  /**
+   * \param placement strategy used to pick the hybrid nodes
+   * \param stream random stream number used by the RANDOM strategy
+   */
+  void SetHybridPlacement (enum HybridPlacement placement, int64_t stream = 0);
+  /// \param range radio range in meters used to count neighbors for DEGREE
+  void SetHybridPlacementRange (double range);
+  /// \param protocol protocol installed on the nodes that are not hybrid
+  void SetSingleProtocol (enum SingleProtocol protocol);
+
+  /**
+   * \param c the nodes among which the hybrid nodes are chosen
+   *
+   * Required before the stack is installed with this helper as routing
+   * helper whenever SetNumberHybridNodes() was given a count of zero or
+   * more; Install() calls it itself.  Later changes to the hybrid
+   * settings discard the roles.
+   */
+  void AssignRoles (NodeContainer c);
+  /// \returns true if \p node was (or will be) given both SOLSR and AODV
+  bool IsHybrid (Ptr<Node> node) const;
+
+  /**
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set.
+   *
+   * Forwarded to the SOLSR instances created by this helper only; the
+   * global attribute defaults are left untouched.
+   */
+  void SetOlsrAttribute (std::string name, const AttributeValue &value);
+  /**
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set.
+   *
+   * Forwarded to the AODV instances created by this helper only.
+   */
+  void SetAodvAttribute (std::string name, const AttributeValue &value);
+  /**
+   * \param name the name of the attribute to set
+   * \param value the value of the attribute to set.
+   *
+   * Forwarded to the SallyRouting instances created by this helper only.
+   */
+  void SetRoutingAttribute (std::string name, const AttributeValue &value);
+
+  /**
+   * \param internet the stack helper used to install the Internet stack
+   * \param c the nodes on which the Internet stack and SALLY are installed
+   *
+   * Bulk installation: roles are assigned once over \p c, then this
+   * helper becomes the routing helper of \p internet, which installs the
+   * stack with the rest of its configuration.
+   */
+  void Install (InternetStackHelper &internet, NodeContainer c) const;
+
+  /// \returns the number of routing protocol instances created by this helper and its copies
+  uint32_t GetNumberCreated (void) const;
+  /// \returns the number of hybrid instances created by this helper and its copies
+  uint32_t GetNumberHybridCreated (void) const;
 private:
   /**
    * \internal
@@ -58,9 +165,52 @@ private:
    * assignment and prevent the compiler from happily inserting its own.
    */
   SallyHelper &operator = (const SallyHelper &o);
-  std::list<std::pair<const Ipv4RoutingHelper *,int16_t> > m_list;
-  int number_of_hybrid_nodes;
+
+  typedef std::list<std::pair<const Ipv4RoutingHelper *, int16_t> > HelperList;
+
+  /// Immutable once shared: the settings of the helper.
+  struct Prototype : public SimpleRefCount<Prototype>
+  {
+    Prototype ();
+    /// Deep-copies the helpers given to Add ().
+    Prototype (const Prototype &o);
+    ~Prototype ();
+    HelperList list;
+    SOlsrHelper olsrHelper;
+    SAodvHelper aodvHelper;
+    ObjectFactory routingFactory;
+    int numberHybridNodes;
+    enum HybridPlacement placement;
+    int64_t placementStream;
+    double placementRange;
+    enum SingleProtocol singleProtocol;
+  private:
+    Prototype &operator = (const Prototype &o);
+  };
+  /// The nodes given roles and the hybrid ones among them, shared between copies as well.
+  struct Roles : public SimpleRefCount<Roles>
+  {
+    std::set<uint32_t> nodes;
+    std::set<uint32_t> hybridNodes;
+  };
+
+  /// What was installed, counted across all copies of a helper.
+  struct Statistics : public SimpleRefCount<Statistics>
+  {
+    Statistics ();
+    uint32_t created;
+    uint32_t hybridCreated;
+  };
+
+  /// \returns the prototype, copied first if another helper shares it
+  Prototype * GetWritablePrototype (void);
+
+  Ptr<Prototype> m_prototype;
+  // Install (), which is const, assigns the roles as well.
+  mutable Ptr<Roles> m_roles;
+  Ptr<Statistics> m_statistics;
+  void DoAssignRoles (NodeContainer c) const;
 };
 }
 
-#endif /* AODV_HELPER_H */
+#endif /* SALLY_HELPER_H */
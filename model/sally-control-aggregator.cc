@@ -0,0 +1,411 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/udp-header.h"
+#include "ns3/udp-socket-factory.h"
+#include "sally-control-aggregator.h"
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE ("SallyControlAggregator");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (SallyContainerEntryHeader);
+
+SallyContainerEntryHeader::SallyContainerEntryHeader ()
+  : m_port (0),
+    m_ttl (0),
+    m_length (0)
+{
+}
+
+void
+SallyContainerEntryHeader::SetDestination (Ipv4Address destination)
+{
+  m_destination = destination;
+}
+
+Ipv4Address
+SallyContainerEntryHeader::GetDestination (void) const
+{
+  return m_destination;
+}
+
+void
+SallyContainerEntryHeader::SetPort (uint16_t port)
+{
+  m_port = port;
+}
+
+uint16_t
+SallyContainerEntryHeader::GetPort (void) const
+{
+  return m_port;
+}
+
+void
+SallyContainerEntryHeader::SetTtl (uint8_t ttl)
+{
+  m_ttl = ttl;
+}
+
+uint8_t
+SallyContainerEntryHeader::GetTtl (void) const
+{
+  return m_ttl;
+}
+
+void
+SallyContainerEntryHeader::SetLength (uint16_t length)
+{
+  m_length = length;
+}
+
+uint16_t
+SallyContainerEntryHeader::GetLength (void) const
+{
+  return m_length;
+}
+
+TypeId
+SallyContainerEntryHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SallyContainerEntryHeader")
+    .SetParent<Header> ()
+    .AddConstructor<SallyContainerEntryHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+SallyContainerEntryHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+SallyContainerEntryHeader::Print (std::ostream &os) const
+{
+  os << "destination " << m_destination << " port " << m_port
+     << " ttl " << (uint32_t) m_ttl << " length " << m_length;
+}
+
+uint32_t
+SallyContainerEntryHeader::GetSerializedSize (void) const
+{
+  return 9;
+}
+
+void
+SallyContainerEntryHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU32 (m_destination.Get ());
+  start.WriteHtonU16 (m_port);
+  start.WriteU8 (m_ttl);
+  start.WriteHtonU16 (m_length);
+}
+
+uint32_t
+SallyContainerEntryHeader::Deserialize (Buffer::Iterator start)
+{
+  m_destination.Set (start.ReadNtohU32 ());
+  m_port = start.ReadNtohU16 ();
+  m_ttl = start.ReadU8 ();
+  m_length = start.ReadNtohU16 ();
+  return GetSerializedSize ();
+}
+
+SallyControlAggregator::SallyControlAggregator ()
+  : m_window (Seconds (0)),
+    m_containersSent (0),
+    m_messagesAggregated (0)
+{
+}
+
+void
+SallyControlAggregator::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  CloseSockets ();
+  m_ipv4 = ipv4;
+}
+
+void
+SallyControlAggregator::SetWindow (Time window)
+{
+  m_window = window;
+  if (!IsEnabled ())
+    {
+      Flush ();
+      CloseSockets ();
+      return;
+    }
+  if (m_ipv4 == 0)
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      if (m_ipv4->IsUp (i))
+        {
+          NotifyInterfaceUp (i);
+        }
+    }
+}
+
+Time
+SallyControlAggregator::GetWindow (void) const
+{
+  return m_window;
+}
+
+bool
+SallyControlAggregator::IsEnabled (void) const
+{
+  return m_window.IsStrictlyPositive ();
+}
+
+void
+SallyControlAggregator::NotifyInterfaceUp (uint32_t interface)
+{
+  if (!IsEnabled () || m_ipv4 == 0 || FindSocket (interface) != 0)
+    {
+      return;
+    }
+  if (m_ipv4->GetNAddresses (interface) == 0
+      || m_ipv4->GetAddress (interface, 0).GetLocal () == Ipv4Address::GetLoopback ())
+    {
+      return;
+    }
+  Ptr<Socket> socket = Socket::CreateSocket (m_ipv4->GetObject<Node> (), UdpSocketFactory::GetTypeId ());
+  NS_ASSERT (socket != 0);
+  socket->SetRecvCallback (MakeCallback (&SallyControlAggregator::Receive, this));
+  socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), PORT));
+  socket->BindToNetDevice (m_ipv4->GetNetDevice (interface));
+  socket->SetAllowBroadcast (true);
+  m_sockets.insert (std::make_pair (socket, interface));
+}
+
+void
+SallyControlAggregator::NotifyInterfaceDown (uint32_t interface)
+{
+  PendingMap::iterator pending = m_pending.find (interface);
+  if (pending != m_pending.end ())
+    {
+      pending->second.flush.Cancel ();
+      m_pending.erase (pending);
+    }
+  for (SocketMap::iterator i = m_sockets.begin (); i != m_sockets.end (); ++i)
+    {
+      if (i->second == interface)
+        {
+          i->first->Close ();
+          m_sockets.erase (i);
+          return;
+        }
+    }
+}
+
+bool
+SallyControlAggregator::Queue (Ptr<const Packet> packet, Ipv4Address local, Ipv4Address destination, uint16_t port)
+{
+  if (!IsEnabled () || m_ipv4 == 0)
+    {
+      return false;
+    }
+  int32_t interface = m_ipv4->GetInterfaceForAddress (local);
+  if (interface < 0 || FindSocket (interface) == 0)
+    {
+      return false;
+    }
+  SallyContainerEntryHeader entry;
+  entry.SetDestination (destination);
+  entry.SetPort (port);
+  // Control messages without a TTL of their own are one hop broadcasts.
+  SocketIpTtlTag ttl;
+  entry.SetTtl (packet->PeekPacketTag (ttl) ? ttl.GetTtl () : 1);
+  entry.SetLength (packet->GetSize ());
+  // Room left by the IPv4 and UDP headers of the container.
+  uint32_t room = m_ipv4->GetMtu (interface) - 28;
+  uint32_t size = entry.GetSerializedSize () + packet->GetSize ();
+  if (size > room)
+    {
+      return false;
+    }
+
+  Pending &pending = m_pending[interface];
+  if (pending.container != 0 && pending.container->GetSize () + size > room)
+    {
+      Send (interface);
+    }
+  if (pending.container == 0)
+    {
+      pending.container = Create<Packet> ();
+      pending.count = 0;
+      pending.flush = Simulator::Schedule (m_window, &SallyControlAggregator::Send, this, (uint32_t) interface);
+    }
+  Ptr<Packet> message = packet->Copy ();
+  message->AddHeader (entry);
+  pending.container->AddAtEnd (message);
+  pending.count++;
+  NS_LOG_LOGIC ("Queued " << packet->GetSize () << " bytes for port " << port << " on interface " << interface
+                << ", " << pending.count << " messages waiting");
+  return true;
+}
+
+void
+SallyControlAggregator::Flush (void)
+{
+  std::vector<uint32_t> interfaces;
+  for (PendingMap::const_iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      interfaces.push_back (i->first);
+    }
+  for (std::vector<uint32_t>::const_iterator i = interfaces.begin (); i != interfaces.end (); ++i)
+    {
+      Send (*i);
+    }
+}
+
+void
+SallyControlAggregator::Send (uint32_t interface)
+{
+  PendingMap::iterator i = m_pending.find (interface);
+  if (i == m_pending.end () || i->second.container == 0)
+    {
+      return;
+    }
+  Ptr<Packet> container = i->second.container;
+  uint32_t count = i->second.count;
+  i->second.container = 0;
+  i->second.count = 0;
+  i->second.flush.Cancel ();
+  Ptr<Socket> socket = FindSocket (interface);
+  if (socket == 0)
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Sending " << count << " control messages in one datagram on interface " << interface);
+  socket->SendTo (container, 0, InetSocketAddress (Ipv4Address::GetBroadcast (), PORT));
+  m_containersSent++;
+  m_messagesAggregated += count;
+}
+
+void
+SallyControlAggregator::Receive (Ptr<Socket> socket)
+{
+  Address from;
+  Ptr<Packet> container = socket->RecvFrom (from);
+  SocketMap::const_iterator s = m_sockets.find (socket);
+  Ptr<Ipv4L3Protocol> l3 = m_ipv4 == 0 ? 0 : m_ipv4->GetObject<Ipv4L3Protocol> ();
+  Ptr<UdpL4Protocol> udp = m_ipv4 == 0 ? 0 : m_ipv4->GetObject<UdpL4Protocol> ();
+  if (s == m_sockets.end () || l3 == 0 || udp == 0)
+    {
+      return;
+    }
+  Ipv4Address sender = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
+  Ptr<Ipv4Interface> iface = l3->GetInterface (s->second);
+
+  // Hand every message to UDP with the headers it would have had on its
+  // own, so it reaches the socket of its protocol.
+  SallyContainerEntryHeader entry;
+  while (container->GetSize () >= entry.GetSerializedSize ())
+    {
+      container->RemoveHeader (entry);
+      if (entry.GetLength () > container->GetSize ())
+        {
+          NS_LOG_WARN ("Truncated container from " << sender);
+          return;
+        }
+      Ptr<Packet> message = container->CreateFragment (0, entry.GetLength ());
+      container->RemoveAtStart (entry.GetLength ());
+
+      UdpHeader udpHeader;
+      udpHeader.SetSourcePort (entry.GetPort ());
+      udpHeader.SetDestinationPort (entry.GetPort ());
+      if (Node::ChecksumEnabled ())
+        {
+          udpHeader.EnableChecksums ();
+          udpHeader.InitializeChecksum (sender, entry.GetDestination (), UdpL4Protocol::PROT_NUMBER);
+        }
+      message->AddHeader (udpHeader);
+
+      Ipv4Header header;
+      header.SetSource (sender);
+      header.SetDestination (entry.GetDestination ());
+      header.SetProtocol (UdpL4Protocol::PROT_NUMBER);
+      header.SetTtl (entry.GetTtl ());
+      header.SetPayloadSize (message->GetSize ());
+      udp->Receive (message, header, iface);
+    }
+}
+
+Ptr<Socket>
+SallyControlAggregator::FindSocket (uint32_t interface) const
+{
+  for (SocketMap::const_iterator i = m_sockets.begin (); i != m_sockets.end (); ++i)
+    {
+      if (i->second == interface)
+        {
+          return i->first;
+        }
+    }
+  return 0;
+}
+
+void
+SallyControlAggregator::CloseSockets (void)
+{
+  for (PendingMap::iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      i->second.flush.Cancel ();
+    }
+  m_pending.clear ();
+  for (SocketMap::const_iterator i = m_sockets.begin (); i != m_sockets.end (); ++i)
+    {
+      i->first->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      i->first->Close ();
+    }
+  m_sockets.clear ();
+}
+
+void
+SallyControlAggregator::Dispose (void)
+{
+  CloseSockets ();
+  m_ipv4 = 0;
+}
+
+uint32_t
+SallyControlAggregator::GetContainersSent (void) const
+{
+  return m_containersSent;
+}
+
+uint32_t
+SallyControlAggregator::GetMessagesAggregated (void) const
+{
+  return m_messagesAggregated;
+}
+
+} // namespace ns3
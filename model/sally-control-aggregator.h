@@ -0,0 +1,148 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_CONTROL_AGGREGATOR_H
+#define SALLY_CONTROL_AGGREGATOR_H
+
+#include <map>
+#include "ns3/header.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/packet.h"
+#include "ns3/socket.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Describes one control message inside a SALLY container datagram.
+ *
+ * The message keeps the destination address, UDP port and TTL it would
+ * have been sent with on its own.
+ */
+class SallyContainerEntryHeader : public Header
+{
+public:
+  SallyContainerEntryHeader ();
+
+  void SetDestination (Ipv4Address destination);
+  Ipv4Address GetDestination (void) const;
+  /// Both the source and the destination port of the message.
+  void SetPort (uint16_t port);
+  uint16_t GetPort (void) const;
+  void SetTtl (uint8_t ttl);
+  uint8_t GetTtl (void) const;
+  /// Size of the message that follows.
+  void SetLength (uint16_t length);
+  uint16_t GetLength (void) const;
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  Ipv4Address m_destination;
+  uint16_t m_port;
+  uint8_t m_ttl;
+  uint16_t m_length;
+};
+
+/**
+ * \ingroup sally
+ *
+ * \brief Packs the broadcast control messages of a SALLY node into one
+ * datagram per interface.
+ *
+ * SOLSR packets and AODV broadcasts that become ready within the
+ * aggregation window leave together in a container datagram sent to
+ * the SALLY control port, and pay the 802.11 channel access and PLCP
+ * overhead once.  On reception the container is split again and every
+ * message is handed to UDP as if it had arrived on its own, so SOLSR
+ * and AODV receive them on their usual sockets.  Every node of the
+ * network must aggregate: others ignore the containers.
+ */
+class SallyControlAggregator
+{
+public:
+  /// UDP port the containers are sent to.
+  static const uint16_t PORT = 699;
+
+  SallyControlAggregator ();
+
+  void SetIpv4 (Ptr<Ipv4> ipv4);
+  /// A window of 0 disables aggregation and closes the sockets.
+  void SetWindow (Time window);
+  Time GetWindow (void) const;
+  bool IsEnabled (void) const;
+
+  /// Opens the container socket of \p interface.
+  void NotifyInterfaceUp (uint32_t interface);
+  void NotifyInterfaceDown (uint32_t interface);
+
+  /**
+   * Holds a control message until the window of its interface closes.
+   *
+   * \param packet the UDP payload, whose SocketIpTtlTag gives its TTL (1 without one)
+   * \param local the address of the interface to send it on
+   * \param destination the destination it would have been sent to
+   * \param port its UDP port
+   * \returns false if the message must be sent on its own
+   */
+  bool Queue (Ptr<const Packet> packet, Ipv4Address local, Ipv4Address destination, uint16_t port);
+  /// Sends every pending container now.
+  void Flush (void);
+  /// Closes the sockets and forgets the pending messages.
+  void Dispose (void);
+
+  /// \returns the number of container datagrams sent
+  uint32_t GetContainersSent (void) const;
+  /// \returns the number of control messages sent inside containers
+  uint32_t GetMessagesAggregated (void) const;
+
+private:
+  /// Messages waiting for the window of one interface to close.
+  struct Pending
+  {
+    Ptr<Packet> container;
+    uint32_t count;
+    EventId flush;
+  };
+  typedef std::map<uint32_t, Pending> PendingMap;
+  typedef std::map<Ptr<Socket>, uint32_t> SocketMap;
+
+  void Send (uint32_t interface);
+  void Receive (Ptr<Socket> socket);
+  Ptr<Socket> FindSocket (uint32_t interface) const;
+  void CloseSockets (void);
+
+  Ptr<Ipv4> m_ipv4;
+  Time m_window;
+  /// Container socket -> interface index.
+  SocketMap m_sockets;
+  PendingMap m_pending;
+  uint32_t m_containersSent;
+  uint32_t m_messagesAggregated;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_CONTROL_AGGREGATOR_H */
@@ -0,0 +1,327 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "sally-deferral-queue.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("SallyDeferralQueue");
+
+namespace ns3 {
+
+SallyDeferralQueue::SallyDeferralQueue ()
+  : m_freeHead (NONE),
+    m_size (0),
+    m_nChains (0),
+    m_perDestinationLimit (8),
+    m_timeout (Seconds (3)),
+    m_enqueued (0),
+    m_released (0),
+    m_dropsFull (0),
+    m_dropsLimit (0),
+    m_dropsTimeout (0)
+{
+}
+
+void
+SallyDeferralQueue::SetCapacity (uint32_t capacity)
+{
+  Clear ();
+  m_slots.clear ();
+  m_slots.resize (capacity);
+  for (uint32_t i = 0; i < capacity; i++)
+    {
+      m_slots[i].next = i + 1 < capacity ? i + 1 : NONE;
+    }
+  m_freeHead = capacity > 0 ? 0 : NONE;
+  // There cannot be more destinations than packets.
+  m_chains.clear ();
+  m_chains.resize (capacity);
+}
+
+uint32_t
+SallyDeferralQueue::GetCapacity (void) const
+{
+  return m_slots.size ();
+}
+
+void
+SallyDeferralQueue::SetPerDestinationLimit (uint32_t limit)
+{
+  m_perDestinationLimit = limit;
+}
+
+uint32_t
+SallyDeferralQueue::GetPerDestinationLimit (void) const
+{
+  return m_perDestinationLimit;
+}
+
+void
+SallyDeferralQueue::SetTimeout (Time timeout)
+{
+  m_timeout = timeout;
+}
+
+Time
+SallyDeferralQueue::GetTimeout (void) const
+{
+  return m_timeout;
+}
+
+uint32_t
+SallyDeferralQueue::FindChain (Ipv4Address dst) const
+{
+  // Few destinations wait at the same time; a scan beats hashing here.
+  for (uint32_t i = 0; i < m_nChains; i++)
+    {
+      if (m_chains[i].dst == dst)
+        {
+          return i;
+        }
+    }
+  return NONE;
+}
+
+void
+SallyDeferralQueue::RemoveChain (uint32_t index)
+{
+  m_nChains--;
+  m_chains[index] = m_chains[m_nChains];
+}
+
+bool
+SallyDeferralQueue::Enqueue (Ptr<const Packet> p, const Ipv4Header &header,
+                             UnicastForwardCallback ucb, ErrorCallback ecb)
+{
+  Ipv4Address dst = header.GetDestination ();
+  uint32_t chain = FindChain (dst);
+  if (chain != NONE && m_chains[chain].count >= m_perDestinationLimit)
+    {
+      NS_LOG_LOGIC ("Per-destination limit reached for " << dst);
+      m_dropsLimit++;
+      return false;
+    }
+  if (m_freeHead == NONE)
+    {
+      NS_LOG_LOGIC ("Deferral queue full, dropping packet to " << dst);
+      m_dropsFull++;
+      return false;
+    }
+
+  uint32_t index = m_freeHead;
+  Slot &slot = m_slots[index];
+  m_freeHead = slot.next;
+  slot.packet = p;
+  slot.header = header;
+  slot.ucb = ucb;
+  slot.ecb = ecb;
+  slot.expire = Simulator::Now () + m_timeout;
+  slot.next = NONE;
+
+  if (chain == NONE)
+    {
+      Chain &c = m_chains[m_nChains++];
+      c.dst = dst;
+      c.head = index;
+      c.tail = index;
+      c.count = 1;
+    }
+  else
+    {
+      Chain &c = m_chains[chain];
+      m_slots[c.tail].next = index;
+      c.tail = index;
+      c.count++;
+    }
+  m_size++;
+  m_enqueued++;
+  return true;
+}
+
+void
+SallyDeferralQueue::FreeSlot (uint32_t index)
+{
+  Slot &slot = m_slots[index];
+  // Release the references now rather than when the slot is reused.
+  slot.packet = 0;
+  slot.ucb = UnicastForwardCallback ();
+  slot.ecb = ErrorCallback ();
+  slot.next = m_freeHead;
+  m_freeHead = index;
+  m_size--;
+}
+
+uint32_t
+SallyDeferralQueue::Release (Ipv4Address dst, Ptr<Ipv4Route> route)
+{
+  uint32_t chain = FindChain (dst);
+  if (chain == NONE)
+    {
+      return 0;
+    }
+  // Detach the chain first: a callback may queue new packets.
+  uint32_t index = m_chains[chain].head;
+  RemoveChain (chain);
+  uint32_t sent = 0;
+  while (index != NONE)
+    {
+      Slot &slot = m_slots[index];
+      uint32_t next = slot.next;
+      Ptr<const Packet> p = slot.packet;
+      Ipv4Header header = slot.header;
+      UnicastForwardCallback ucb = slot.ucb;
+      FreeSlot (index);
+      ucb (route, p, header);
+      sent++;
+      index = next;
+    }
+  m_released += sent;
+  NS_LOG_LOGIC ("Released " << sent << " packets to " << dst << " via " << route->GetGateway ());
+  return sent;
+}
+
+uint32_t
+SallyDeferralQueue::DropExpired (Time now)
+{
+  // Packets of a destination expire in arrival order, so only chain heads
+  // need to be looked at.
+  uint32_t dropped = 0;
+  uint32_t chain = 0;
+  while (chain < m_nChains)
+    {
+      Chain &c = m_chains[chain];
+      while (c.head != NONE && m_slots[c.head].expire <= now)
+        {
+          uint32_t index = c.head;
+          Slot &slot = m_slots[index];
+          c.head = slot.next;
+          c.count--;
+          Ptr<const Packet> p = slot.packet;
+          Ipv4Header header = slot.header;
+          ErrorCallback ecb = slot.ecb;
+          FreeSlot (index);
+          dropped++;
+          NS_LOG_LOGIC ("No route to " << header.GetDestination () << " in time, dropping packet");
+          if (!ecb.IsNull ())
+            {
+              ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+            }
+        }
+      if (c.head == NONE)
+        {
+          RemoveChain (chain);
+        }
+      else
+        {
+          chain++;
+        }
+    }
+  m_dropsTimeout += dropped;
+  return dropped;
+}
+
+Time
+SallyDeferralQueue::GetNextExpiry (void) const
+{
+  Time next = Simulator::GetMaximumSimulationTime ();
+  for (uint32_t i = 0; i < m_nChains; i++)
+    {
+      next = std::min (next, m_slots[m_chains[i].head].expire);
+    }
+  return next;
+}
+
+std::vector<Ipv4Address>
+SallyDeferralQueue::GetDestinations (void) const
+{
+  std::vector<Ipv4Address> destinations;
+  destinations.reserve (m_nChains);
+  for (uint32_t i = 0; i < m_nChains; i++)
+    {
+      destinations.push_back (m_chains[i].dst);
+    }
+  return destinations;
+}
+
+uint32_t
+SallyDeferralQueue::GetSize (void) const
+{
+  return m_size;
+}
+
+uint32_t
+SallyDeferralQueue::GetSize (Ipv4Address dst) const
+{
+  uint32_t chain = FindChain (dst);
+  return chain == NONE ? 0 : m_chains[chain].count;
+}
+
+bool
+SallyDeferralQueue::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+void
+SallyDeferralQueue::Clear (void)
+{
+  for (uint32_t i = 0; i < m_nChains; i++)
+    {
+      uint32_t index = m_chains[i].head;
+      while (index != NONE)
+        {
+          uint32_t next = m_slots[index].next;
+          FreeSlot (index);
+          index = next;
+        }
+    }
+  m_nChains = 0;
+}
+
+uint32_t
+SallyDeferralQueue::GetEnqueued (void) const
+{
+  return m_enqueued;
+}
+
+uint32_t
+SallyDeferralQueue::GetReleased (void) const
+{
+  return m_released;
+}
+
+uint32_t
+SallyDeferralQueue::GetDropsFull (void) const
+{
+  return m_dropsFull;
+}
+
+uint32_t
+SallyDeferralQueue::GetDropsLimit (void) const
+{
+  return m_dropsLimit;
+}
+
+uint32_t
+SallyDeferralQueue::GetDropsTimeout (void) const
+{
+  return m_dropsTimeout;
+}
+
+} // namespace ns3
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_DEFERRAL_QUEUE_H
+#define SALLY_DEFERRAL_QUEUE_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Bounded buffer for packets that wait for a route.
+ *
+ * All entries live in a pool allocated once by SetCapacity; free slots
+ * and the packets queued for one destination are chained through slot
+ * indices, and the per-destination chains sit in a table of the same
+ * size, so queueing a packet allocates nothing.  Each destination
+ * may hold at most a fixed number of packets, and packets still queued
+ * when their timeout expires are handed to their error callback.
+ */
+class SallyDeferralQueue
+{
+public:
+  typedef Ipv4RoutingProtocol::UnicastForwardCallback UnicastForwardCallback;
+  typedef Ipv4RoutingProtocol::ErrorCallback ErrorCallback;
+
+  SallyDeferralQueue ();
+
+  /// Drop all entries and use a pool of \p capacity slots (0 disables the queue).
+  void SetCapacity (uint32_t capacity);
+  uint32_t GetCapacity (void) const;
+  void SetPerDestinationLimit (uint32_t limit);
+  uint32_t GetPerDestinationLimit (void) const;
+  void SetTimeout (Time timeout);
+  Time GetTimeout (void) const;
+
+  /**
+   * \returns false, counting the drop, if the pool or the share of the
+   * packet's destination is exhausted
+   */
+  bool Enqueue (Ptr<const Packet> p, const Ipv4Header &header,
+                UnicastForwardCallback ucb, ErrorCallback ecb);
+  /// Send every packet queued for \p dst along \p route, oldest first.
+  /// \returns the number of packets sent
+  uint32_t Release (Ipv4Address dst, Ptr<Ipv4Route> route);
+  /// Hand the packets whose timeout expired by \p now to their error callback.
+  /// \returns the number of packets dropped
+  uint32_t DropExpired (Time now);
+  /// \returns the expiry time of the oldest queued packet
+  Time GetNextExpiry (void) const;
+  /// \returns the destinations that have packets queued
+  std::vector<Ipv4Address> GetDestinations (void) const;
+  uint32_t GetSize (void) const;
+  uint32_t GetSize (Ipv4Address dst) const;
+  bool IsEmpty (void) const;
+  /// Forget all queued packets without calling any callback.
+  void Clear (void);
+
+  uint32_t GetEnqueued (void) const;
+  uint32_t GetReleased (void) const;
+  /// \returns the number of packets refused because the pool was full
+  uint32_t GetDropsFull (void) const;
+  /// \returns the number of packets refused by the per-destination limit
+  uint32_t GetDropsLimit (void) const;
+  /// \returns the number of packets that timed out in the queue
+  uint32_t GetDropsTimeout (void) const;
+
+private:
+  static const uint32_t NONE = 0xffffffff;
+
+  struct Slot
+  {
+    Ptr<const Packet> packet;
+    Ipv4Header header;
+    UnicastForwardCallback ucb;
+    ErrorCallback ecb;
+    Time expire;
+    /// Next slot of the same destination, or of the free list.
+    uint32_t next;
+  };
+
+  /// Packets of one destination, in arrival order.
+  struct Chain
+  {
+    Ipv4Address dst;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t count;
+  };
+
+  void FreeSlot (uint32_t index);
+  /// \returns the index of the chain of \p dst, or NONE
+  uint32_t FindChain (Ipv4Address dst) const;
+  void RemoveChain (uint32_t index);
+
+  std::vector<Slot> m_slots;
+  uint32_t m_freeHead;
+  uint32_t m_size;
+  /// The first m_nChains entries are in use.
+  std::vector<Chain> m_chains;
+  uint32_t m_nChains;
+  uint32_t m_perDestinationLimit;
+  Time m_timeout;
+  uint32_t m_enqueued;
+  uint32_t m_released;
+  uint32_t m_dropsFull;
+  uint32_t m_dropsLimit;
+  uint32_t m_dropsTimeout;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_DEFERRAL_QUEUE_H */
@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-duplicate-set.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyDuplicateSet");
+
+namespace ns3 {
+
+SallyDuplicateSet::SallyDuplicateSet ()
+  : m_size (0),
+    m_inserted (0)
+{
+  SetHoldTime (Seconds (30), Seconds (1));
+}
+
+void
+SallyDuplicateSet::SetHoldTime (Time hold, Time resolution)
+{
+  m_hold = hold;
+  m_wheel.SetSpan (hold, resolution);
+  Clear ();
+}
+
+Time
+SallyDuplicateSet::GetHoldTime (void) const
+{
+  return m_hold;
+}
+
+uint32_t
+SallyDuplicateSet::BucketOf (Ipv4Address originator, uint16_t sequenceNumber) const
+{
+  uint32_t hash = (originator.Get () * 2654435761u) ^ (sequenceNumber * 40503u);
+  return (hash ^ (hash >> 16)) & (m_buckets.size () - 1);
+}
+
+SallyDuplicateSet::Bucket::iterator
+SallyDuplicateSet::Locate (Ipv4Address originator, uint16_t sequenceNumber, Bucket *&bucket)
+{
+  bucket = &m_buckets[BucketOf (originator, sequenceNumber)];
+  for (Bucket::iterator i = bucket->begin (); i != bucket->end (); ++i)
+    {
+      if (i->address == originator && i->sequenceNumber == sequenceNumber)
+        {
+          return i;
+        }
+    }
+  return bucket->end ();
+}
+
+void
+SallyDuplicateSet::Rehash (uint32_t buckets)
+{
+  std::vector<Bucket> old;
+  old.swap (m_buckets);
+  m_buckets.resize (buckets);
+  for (std::vector<Bucket>::const_iterator b = old.begin (); b != old.end (); ++b)
+    {
+      for (Bucket::const_iterator i = b->begin (); i != b->end (); ++i)
+        {
+          m_buckets[BucketOf (i->address, i->sequenceNumber)].push_back (*i);
+        }
+    }
+}
+
+void
+SallyDuplicateSet::Schedule (const Tuple &tuple)
+{
+  SallyTimingWheel::Key key;
+  key.address = tuple.address;
+  key.sequenceNumber = tuple.sequenceNumber;
+  m_wheel.Schedule (key, tuple.expirationTime);
+}
+
+void
+SallyDuplicateSet::Advance (Time now)
+{
+  std::vector<SallyTimingWheel::Key> due;
+  m_wheel.Advance (now, due);
+  for (std::vector<SallyTimingWheel::Key>::const_iterator k = due.begin (); k != due.end (); ++k)
+    {
+      Bucket *bucket;
+      Bucket::iterator i = Locate (k->address, k->sequenceNumber, bucket);
+      if (i == bucket->end () || i->expirationTime >= now)
+        {
+          // Gone, or refreshed into a later slot.
+          continue;
+        }
+      *i = bucket->back ();
+      bucket->pop_back ();
+      m_size--;
+    }
+}
+
+SallyDuplicateSet::Tuple *
+SallyDuplicateSet::Find (Ipv4Address originator, uint16_t sequenceNumber, Time now)
+{
+  Advance (now);
+  Bucket *bucket;
+  Bucket::iterator i = Locate (originator, sequenceNumber, bucket);
+  if (i == bucket->end () || i->expirationTime < now)
+    {
+      return 0;
+    }
+  return &*i;
+}
+
+SallyDuplicateSet::Tuple &
+SallyDuplicateSet::Insert (Ipv4Address originator, uint16_t sequenceNumber, Time now)
+{
+  Advance (now);
+  if (m_size >= 2 * m_buckets.size ())
+    {
+      Rehash (2 * m_buckets.size ());
+    }
+  Bucket *bucket;
+  Bucket::iterator i = Locate (originator, sequenceNumber, bucket);
+  if (i == bucket->end ())
+    {
+      bucket->push_back (Tuple ());
+      i = bucket->end () - 1;
+      i->address = originator;
+      i->sequenceNumber = sequenceNumber;
+      m_size++;
+    }
+  // An expired tuple not yet reclaimed is reused.
+  i->retransmitted = false;
+  i->ifaceList.clear ();
+  i->expirationTime = now + m_hold;
+  Schedule (*i);
+  m_inserted++;
+  return *i;
+}
+
+void
+SallyDuplicateSet::Refresh (Tuple &tuple, Time now)
+{
+  tuple.expirationTime = now + m_hold;
+  Schedule (tuple);
+}
+
+void
+SallyDuplicateSet::Clear (void)
+{
+  m_buckets.assign (64, Bucket ());
+  m_wheel.Clear ();
+  m_size = 0;
+}
+
+uint32_t
+SallyDuplicateSet::GetSize (void) const
+{
+  return m_size;
+}
+
+uint32_t
+SallyDuplicateSet::GetInserted (void) const
+{
+  return m_inserted;
+}
+
+} // namespace ns3
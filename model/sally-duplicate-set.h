@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_DUPLICATE_SET_H
+#define SALLY_DUPLICATE_SET_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "sally-timing-wheel.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief OLSR duplicate set hashed by (originator, sequence number).
+ *
+ * Holds what the OLSR duplicate tuples hold, but a lookup is one hash
+ * bucket instead of a scan of every message seen in the hold time, and
+ * expiry needs no simulator event: tuples are filed in a SallyTimingWheel
+ * of hold time / resolution slots, which every lookup or insertion first
+ * advances to the current time.  Like a stock tuple, whose timer fires at
+ * its expiration time, a tuple is found up to and including that time and
+ * not after, whatever the resolution; the resolution only bounds how long
+ * its memory is kept.
+ */
+class SallyDuplicateSet
+{
+public:
+  /// Same fields as olsr::DuplicateTuple.
+  struct Tuple
+  {
+    Ipv4Address address;
+    uint16_t sequenceNumber;
+    bool retransmitted;
+    std::vector<Ipv4Address> ifaceList;
+    Time expirationTime;
+  };
+
+  /// Holds tuples for the 30 s duplicate hold time of OLSR, in 1 s slots.
+  SallyDuplicateSet ();
+
+  /// Sets how long tuples are held and the width of a wheel slot; clears the set.
+  void SetHoldTime (Time hold, Time resolution);
+  Time GetHoldTime (void) const;
+
+  /**
+   * \returns the live tuple of the message, or 0; the pointer is valid
+   * until the next Find or Insert
+   */
+  Tuple *Find (Ipv4Address originator, uint16_t sequenceNumber, Time now);
+  /// Adds the tuple of a new message, held until \p now plus the hold time.
+  Tuple &Insert (Ipv4Address originator, uint16_t sequenceNumber, Time now);
+  /// Holds \p tuple for another hold time from \p now.
+  void Refresh (Tuple &tuple, Time now);
+  void Clear (void);
+
+  /// \returns the number of tuples stored, including expired ones not yet reclaimed
+  uint32_t GetSize (void) const;
+  /// \returns the number of tuples inserted, each a timer the stock set would schedule
+  uint32_t GetInserted (void) const;
+
+private:
+  typedef std::vector<Tuple> Bucket;
+
+  uint32_t BucketOf (Ipv4Address originator, uint16_t sequenceNumber) const;
+  Bucket::iterator Locate (Ipv4Address originator, uint16_t sequenceNumber, Bucket *&bucket);
+  void Rehash (uint32_t buckets);
+  /// Files \p tuple in the wheel slot of its expiration time.
+  void Schedule (const Tuple &tuple);
+  /// Reclaims the tuples of every slot that ended by \p now.
+  void Advance (Time now);
+
+  Time m_hold;
+  std::vector<Bucket> m_buckets;
+  uint32_t m_size;
+  SallyTimingWheel m_wheel;
+  uint32_t m_inserted;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_DUPLICATE_SET_H */
@@ -0,0 +1,263 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-hello-codec.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyHelloCodec");
+
+namespace ns3 {
+
+typedef olsr::MessageHeader::Hello::LinkMessage LinkMessage;
+
+SallyHelloCodec::SallyHelloCodec ()
+  : m_refresh (4),
+    m_version (0),
+    m_fullVersion (0),
+    m_hellosSinceFull (0),
+    m_started (false),
+    m_fullHellos (0),
+    m_deltaHellos (0),
+    m_bytesSaved (0),
+    m_versionGaps (0)
+{
+}
+
+void
+SallyHelloCodec::SetRefreshInterval (uint32_t refresh)
+{
+  m_refresh = refresh;
+}
+
+uint32_t
+SallyHelloCodec::GetRefreshInterval (void) const
+{
+  return m_refresh;
+}
+
+bool
+SallyHelloCodec::IsTag (uint8_t linkCode)
+{
+  return ((linkCode >> 2) & 0x03) == 0x03;
+}
+
+void
+SallyHelloCodec::AddTag (olsr::MessageHeader::Hello &hello, uint8_t tag, const std::vector<Ipv4Address> &values)
+{
+  LinkMessage message;
+  message.linkCode = tag;
+  message.neighborInterfaceAddresses = values;
+  hello.linkMessages.push_back (message);
+}
+
+void
+SallyHelloCodec::SetLinks (olsr::MessageHeader::Hello &hello, const LinkMap &links)
+{
+  std::map<uint8_t, std::vector<Ipv4Address> > byCode;
+  for (LinkMap::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      byCode[i->second].push_back (i->first);
+    }
+  hello.linkMessages.clear ();
+  for (std::map<uint8_t, std::vector<Ipv4Address> >::const_iterator i = byCode.begin (); i != byCode.end (); ++i)
+    {
+      LinkMessage message;
+      message.linkCode = i->first;
+      message.neighborInterfaceAddresses = i->second;
+      hello.linkMessages.push_back (message);
+    }
+}
+
+olsr::MessageHeader
+SallyHelloCodec::Encode (const olsr::MessageHeader &hello)
+{
+  LinkMap current;
+  const std::vector<LinkMessage> &links = hello.GetHello ().linkMessages;
+  for (std::vector<LinkMessage>::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      for (std::vector<Ipv4Address>::const_iterator a = i->neighborInterfaceAddresses.begin ();
+           a != i->neighborInterfaceAddresses.end (); ++a)
+        {
+          current[*a] = i->linkCode;
+        }
+    }
+
+  olsr::MessageHeader out = hello;
+  olsr::MessageHeader::Hello &outHello = out.GetHello ();
+  if (!m_started || current != m_advertised)
+    {
+      m_version++;
+    }
+
+  if (!m_started || m_hellosSinceFull + 1 >= m_refresh)
+    {
+      SetLinks (outHello, current);
+      AddTag (outHello, FULL_TAG, std::vector<Ipv4Address> (1, Ipv4Address (m_version)));
+      m_lastFull = current;
+      m_fullVersion = m_version;
+      m_hellosSinceFull = 0;
+      m_fullHellos++;
+    }
+  else
+    {
+      LinkMap changed;
+      std::vector<Ipv4Address> removed;
+      for (LinkMap::const_iterator i = current.begin (); i != current.end (); ++i)
+        {
+          LinkMap::const_iterator old = m_lastFull.find (i->first);
+          if (old == m_lastFull.end () || old->second != i->second)
+            {
+              changed.insert (*i);
+            }
+        }
+      for (LinkMap::const_iterator i = m_lastFull.begin (); i != m_lastFull.end (); ++i)
+        {
+          if (current.find (i->first) == current.end ())
+            {
+              removed.push_back (i->first);
+            }
+        }
+      SetLinks (outHello, changed);
+      std::vector<Ipv4Address> versions;
+      versions.push_back (Ipv4Address (m_fullVersion));
+      versions.push_back (Ipv4Address (m_version));
+      AddTag (outHello, DELTA_TAG, versions);
+      if (!removed.empty ())
+        {
+          AddTag (outHello, REMOVED_TAG, removed);
+        }
+      m_hellosSinceFull++;
+      m_deltaHellos++;
+    }
+  m_started = true;
+  m_advertised = current;
+  m_bytesSaved += (int64_t) hello.GetSerializedSize () - (int64_t) out.GetSerializedSize ();
+  return out;
+}
+
+SallyHelloCodec::DecodeResult
+SallyHelloCodec::Decode (olsr::MessageHeader &hello)
+{
+  olsr::MessageHeader::Hello &body = hello.GetHello ();
+  const LinkMessage *full = 0;
+  const LinkMessage *delta = 0;
+  const LinkMessage *removed = 0;
+  LinkMap links;
+  for (std::vector<LinkMessage>::const_iterator i = body.linkMessages.begin (); i != body.linkMessages.end (); ++i)
+    {
+      switch (i->linkCode)
+        {
+        case FULL_TAG:
+          full = &*i;
+          break;
+        case DELTA_TAG:
+          delta = &*i;
+          break;
+        case REMOVED_TAG:
+          removed = &*i;
+          break;
+        default:
+          if (!IsTag (i->linkCode))
+            {
+              for (std::vector<Ipv4Address>::const_iterator a = i->neighborInterfaceAddresses.begin ();
+                   a != i->neighborInterfaceAddresses.end (); ++a)
+                {
+                  links[*a] = i->linkCode;
+                }
+            }
+        }
+    }
+
+  if (full != 0 && full->neighborInterfaceAddresses.size () == 1)
+    {
+      Snapshot &snapshot = m_received[hello.GetOriginatorAddress ()];
+      snapshot.version = full->neighborInterfaceAddresses[0].Get ();
+      snapshot.links = links;
+      SetLinks (body, links);
+      return EXPANDED;
+    }
+  if (delta == 0 || delta->neighborInterfaceAddresses.size () != 2)
+    {
+      return PLAIN;
+    }
+
+  uint32_t base = delta->neighborInterfaceAddresses[0].Get ();
+  std::map<Ipv4Address, Snapshot>::iterator known = m_received.find (hello.GetOriginatorAddress ());
+  if (known == m_received.end () || known->second.version != base)
+    {
+      // Patching an older set would advertise links the originator no
+      // longer has; wait for its next full HELLO instead.
+      NS_LOG_LOGIC ("HELLO delta from " << hello.GetOriginatorAddress () << " against unknown version " << base);
+      if (known != m_received.end ())
+        {
+          m_received.erase (known);
+        }
+      m_versionGaps++;
+      return STALE;
+    }
+  LinkMap expanded = known->second.links;
+  if (removed != 0)
+    {
+      for (std::vector<Ipv4Address>::const_iterator a = removed->neighborInterfaceAddresses.begin ();
+           a != removed->neighborInterfaceAddresses.end (); ++a)
+        {
+          expanded.erase (*a);
+        }
+    }
+  for (LinkMap::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      expanded[i->first] = i->second;
+    }
+  SetLinks (body, expanded);
+  return EXPANDED;
+}
+
+void
+SallyHelloCodec::Clear (void)
+{
+  m_advertised.clear ();
+  m_lastFull.clear ();
+  m_started = false;
+  m_hellosSinceFull = 0;
+  m_received.clear ();
+}
+
+uint32_t
+SallyHelloCodec::GetFullHellos (void) const
+{
+  return m_fullHellos;
+}
+
+uint32_t
+SallyHelloCodec::GetDeltaHellos (void) const
+{
+  return m_deltaHellos;
+}
+
+int64_t
+SallyHelloCodec::GetBytesSaved (void) const
+{
+  return m_bytesSaved;
+}
+
+uint32_t
+SallyHelloCodec::GetVersionGaps (void) const
+{
+  return m_versionGaps;
+}
+
+} // namespace ns3
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_HELLO_CODEC_H
+#define SALLY_HELLO_CODEC_H
+
+#include <map>
+#include "ns3/ipv4-address.h"
+#include "ns3/olsr-header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Compact HELLO encoding with versioned neighbor-set deltas.
+ *
+ * The sender numbers every change of its advertised neighbor set.  A
+ * full HELLO, tagged with the current version, goes out every refresh
+ * interval; in between a HELLO only carries the neighbors added, changed
+ * or removed since the last full one, so a lost delta costs nothing.
+ * The receiver keeps the last full set of every originator, applies the
+ * delta and hands a complete HELLO to OLSR.  A delta against a full
+ * HELLO the receiver missed is dropped, together with the older full
+ * set, until the next full HELLO of its originator.
+ *
+ * The tags are link messages with neighbor type 3, which plain OLSR
+ * skips as invalid; a plain OLSR node would however miss the neighbors
+ * a delta leaves out, so every node of the network must use the codec.
+ */
+class SallyHelloCodec
+{
+public:
+  SallyHelloCodec ();
+
+  /// Every \p refresh-th HELLO is sent in full (1 sends them all in full).
+  void SetRefreshInterval (uint32_t refresh);
+  uint32_t GetRefreshInterval (void) const;
+
+  /// What Decode made of a HELLO.
+  enum DecodeResult
+  {
+    PLAIN,     ///< not compact, left untouched
+    EXPANDED,  ///< now carries the full neighbor set of its originator
+    STALE      ///< a delta against a full HELLO we missed, to be dropped
+  };
+
+  /// \returns the HELLO to send in place of the full \p hello
+  olsr::MessageHeader Encode (const olsr::MessageHeader &hello);
+  /// Expands a compact HELLO into the full neighbor set of its originator.
+  DecodeResult Decode (olsr::MessageHeader &hello);
+  /// Forget what was advertised and received.
+  void Clear (void);
+
+  /// \returns the number of HELLOs sent with the full neighbor set
+  uint32_t GetFullHellos (void) const;
+  /// \returns the number of HELLOs sent as deltas
+  uint32_t GetDeltaHellos (void) const;
+  /// \returns the bytes the deltas saved over full HELLOs, less the tags
+  int64_t GetBytesSaved (void) const;
+  /// \returns the number of deltas dropped because we missed their full HELLO
+  uint32_t GetVersionGaps (void) const;
+
+private:
+  /// Neighbor interface address -> link code.
+  typedef std::map<Ipv4Address, uint8_t> LinkMap;
+  /// Last full neighbor set received from an originator.
+  struct Snapshot
+  {
+    uint32_t version;
+    LinkMap links;
+  };
+
+  static const uint8_t FULL_TAG = 0x0c;
+  static const uint8_t DELTA_TAG = 0x0d;
+  static const uint8_t REMOVED_TAG = 0x0e;
+
+  static bool IsTag (uint8_t linkCode);
+  static void AddTag (olsr::MessageHeader::Hello &hello, uint8_t tag, const std::vector<Ipv4Address> &values);
+  /// Replaces the link messages of \p hello by one per link code of \p links.
+  static void SetLinks (olsr::MessageHeader::Hello &hello, const LinkMap &links);
+
+  uint32_t m_refresh;
+  /// Neighbor set of our last HELLO and of our last full HELLO.
+  LinkMap m_advertised;
+  LinkMap m_lastFull;
+  uint32_t m_version;
+  uint32_t m_fullVersion;
+  uint32_t m_hellosSinceFull;
+  bool m_started;
+  std::map<Ipv4Address, Snapshot> m_received;
+  uint32_t m_fullHellos;
+  uint32_t m_deltaHellos;
+  int64_t m_bytesSaved;
+  uint32_t m_versionGaps;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_HELLO_CODEC_H */
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-link-break-detector.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyLinkBreakDetector");
+
+namespace ns3 {
+
+SallyLinkBreakDetector::SallyLinkBreakDetector ()
+  : m_threshold (0),
+    m_window (Seconds (1)),
+    m_breaks (0),
+    m_latency (Seconds (0))
+{
+}
+
+void
+SallyLinkBreakDetector::SetThreshold (uint32_t threshold)
+{
+  m_threshold = threshold;
+  if (m_threshold == 0)
+    {
+      m_runs.clear ();
+    }
+}
+
+uint32_t
+SallyLinkBreakDetector::GetThreshold (void) const
+{
+  return m_threshold;
+}
+
+void
+SallyLinkBreakDetector::SetWindow (Time window)
+{
+  m_window = window;
+}
+
+Time
+SallyLinkBreakDetector::GetWindow (void) const
+{
+  return m_window;
+}
+
+bool
+SallyLinkBreakDetector::IsEnabled (void) const
+{
+  return m_threshold > 0;
+}
+
+bool
+SallyLinkBreakDetector::TxFailed (Ipv4Address neighbor, Time now)
+{
+  if (!IsEnabled ())
+    {
+      return false;
+    }
+  std::map<Ipv4Address, Run>::iterator i = m_runs.find (neighbor);
+  if (i == m_runs.end () || now - i->second.last > m_window)
+    {
+      Run run;
+      run.failures = 0;
+      run.first = now;
+      m_runs[neighbor] = run;
+      i = m_runs.find (neighbor);
+    }
+  i->second.failures++;
+  i->second.last = now;
+  if (i->second.failures < m_threshold)
+    {
+      return false;
+    }
+  NS_LOG_LOGIC ("Link to " << neighbor << " broken after " << i->second.failures << " failures");
+  m_breaks++;
+  m_latency += now - i->second.first;
+  m_runs.erase (i);
+  return true;
+}
+
+void
+SallyLinkBreakDetector::Heard (Ipv4Address neighbor)
+{
+  m_runs.erase (neighbor);
+}
+
+void
+SallyLinkBreakDetector::Clear (void)
+{
+  m_runs.clear ();
+}
+
+uint32_t
+SallyLinkBreakDetector::GetBreaks (void) const
+{
+  return m_breaks;
+}
+
+Time
+SallyLinkBreakDetector::GetLatency (void) const
+{
+  return m_latency;
+}
+
+} // namespace ns3
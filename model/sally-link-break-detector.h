@@ -0,0 +1,82 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_LINK_BREAK_DETECTOR_H
+#define SALLY_LINK_BREAK_DETECTOR_H
+
+#include <map>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Declares a link broken after repeated transmit failures.
+ *
+ * Counts the unicast frames to a neighbor that the MAC gave up on.  A
+ * run of failures that reaches the threshold within the window breaks
+ * the link; anything heard from the neighbor ends the run.
+ */
+class SallyLinkBreakDetector
+{
+public:
+  SallyLinkBreakDetector ();
+
+  /// Failures that break a link; 0 disables the detector.
+  void SetThreshold (uint32_t threshold);
+  uint32_t GetThreshold (void) const;
+  /// Failures further apart than \p window start a new run.
+  void SetWindow (Time window);
+  Time GetWindow (void) const;
+  bool IsEnabled (void) const;
+
+  /**
+   * Records a frame to \p neighbor the MAC gave up on.
+   *
+   * \returns true if this failure breaks the link; the latency from the
+   * first failure of the run is then added to GetLatency
+   */
+  bool TxFailed (Ipv4Address neighbor, Time now);
+  /// \p neighbor was heard from, so the link works.
+  void Heard (Ipv4Address neighbor);
+  void Clear (void);
+
+  /// \returns the number of links declared broken
+  uint32_t GetBreaks (void) const;
+  /// \returns the summed time from the first failure to the break
+  Time GetLatency (void) const;
+
+private:
+  /// Failures to one neighbor since it was last heard from.
+  struct Run
+  {
+    uint32_t failures;
+    Time first;
+    Time last;
+  };
+
+  uint32_t m_threshold;
+  Time m_window;
+  std::map<Ipv4Address, Run> m_runs;
+  uint32_t m_breaks;
+  Time m_latency;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_LINK_BREAK_DETECTOR_H */
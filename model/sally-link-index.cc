@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "sally-link-index.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyLinkIndex");
+
+namespace ns3 {
+
+SallyLinkIndex::SallyLinkIndex ()
+  : m_indexed (false),
+    m_timersScheduled (0)
+{
+  SetTimerSpan (Seconds (6), MilliSeconds (500));
+}
+
+void
+SallyLinkIndex::SetTimerSpan (Time span, Time resolution)
+{
+  m_wheel.SetSpan (span, resolution);
+  m_timers.clear ();
+}
+
+uint32_t
+SallyLinkIndex::BucketOf (Ipv4Address address) const
+{
+  uint32_t hash = address.Get () * 2654435761u;
+  return (hash ^ (hash >> 16)) & (m_buckets.size () - 1);
+}
+
+void
+SallyLinkIndex::Rebuild (const olsr::LinkSet &links)
+{
+  uint32_t buckets = 16;
+  while (buckets < 2 * links.size ())
+    {
+      buckets *= 2;
+    }
+  m_buckets.assign (buckets, Bucket ());
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      Entry entry;
+      entry.address = links[i].neighborIfaceAddr;
+      entry.position = i;
+      m_buckets[BucketOf (entry.address)].push_back (entry);
+    }
+  m_indexed = true;
+  NS_LOG_LOGIC ("Indexed " << links.size () << " links");
+}
+
+olsr::LinkTuple *
+SallyLinkIndex::Find (olsr::LinkSet &links, Ipv4Address neighborIface)
+{
+  if (!m_indexed)
+    {
+      Rebuild (links);
+    }
+  const Bucket &bucket = m_buckets[BucketOf (neighborIface)];
+  for (Bucket::const_iterator i = bucket.begin (); i != bucket.end (); ++i)
+    {
+      if (i->address == neighborIface)
+        {
+          // Like the stock lookup, the first tuple of the address wins.
+          NS_ASSERT (links[i->position].neighborIfaceAddr == neighborIface);
+          return &links[i->position];
+        }
+    }
+  return 0;
+}
+
+void
+SallyLinkIndex::LinkSetChanged (const olsr::LinkSet &links, bool inserted)
+{
+  // Rebuild keeps the buckets at least twice the number of links.
+  if (!m_indexed || !inserted || 2 * links.size () > m_buckets.size ())
+    {
+      m_indexed = false;
+      return;
+    }
+  Entry entry;
+  entry.address = links.back ().neighborIfaceAddr;
+  entry.position = links.size () - 1;
+  m_buckets[BucketOf (entry.address)].push_back (entry);
+}
+
+void
+SallyLinkIndex::ScheduleTimer (Ipv4Address neighborIface, Time deadline)
+{
+  m_timers[neighborIface] = deadline;
+  SallyTimingWheel::Key key;
+  key.address = neighborIface;
+  key.sequenceNumber = 0;
+  m_wheel.Schedule (key, deadline);
+  m_timersScheduled++;
+}
+
+void
+SallyLinkIndex::ExpireTimers (Time now, std::vector<Ipv4Address> &due)
+{
+  std::vector<SallyTimingWheel::Key> keys;
+  m_wheel.Advance (now, keys);
+  for (std::vector<SallyTimingWheel::Key>::const_iterator k = keys.begin (); k != keys.end (); ++k)
+    {
+      std::map<Ipv4Address, Time>::iterator timer = m_timers.find (k->address);
+      if (timer == m_timers.end ())
+        {
+          // Already fired through another key.
+          continue;
+        }
+      if (timer->second >= now)
+        {
+          // Filed before the wheel covered its deadline.
+          m_wheel.Schedule (*k, timer->second);
+          continue;
+        }
+      due.push_back (k->address);
+      m_timers.erase (timer);
+    }
+}
+
+bool
+SallyLinkIndex::GetNextTimerSlot (Time &end) const
+{
+  return m_wheel.GetNextSlotEnd (end);
+}
+
+void
+SallyLinkIndex::Clear (void)
+{
+  m_buckets.clear ();
+  m_indexed = false;
+  m_timers.clear ();
+  m_wheel.Clear ();
+}
+
+uint32_t
+SallyLinkIndex::GetTimersScheduled (void) const
+{
+  return m_timersScheduled;
+}
+
+} // namespace ns3
@@ -0,0 +1,99 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SALLY_LINK_INDEX_H
+#define SALLY_LINK_INDEX_H
+
+#include <map>
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/olsr-repositories.h"
+#include "sally-timing-wheel.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief OLSR link set lookups hashed by neighbor interface address, and
+ * link timers on a SallyTimingWheel.
+ *
+ * The tuples stay in the OLSR state; the index maps an address to the
+ * position of its tuple.  The OLSR state reports every insertion into
+ * and removal from the link set: an insertion is appended to the index,
+ * while a removal shifts the positions after it, so the index is rebuilt
+ * on the next lookup.
+ *
+ * A link timer fires once the slot of its deadline ended, so at most one
+ * wheel resolution after the stock timer would have.
+ */
+class SallyLinkIndex
+{
+public:
+  /// Link timers cover 6 s in slots of 0.5 s.
+  SallyLinkIndex ();
+
+  /// Sizes the timer wheel for deadlines up to \p span ahead in slots of \p resolution; forgets every timer.
+  void SetTimerSpan (Time span, Time resolution);
+
+  /**
+   * \param links the OLSR link set
+   * \param neighborIface the neighbor interface address of the link
+   * \returns the tuple of the link in \p links, or 0
+   */
+  olsr::LinkTuple *Find (olsr::LinkSet &links, Ipv4Address neighborIface);
+  /// Told by the OLSR state that the last tuple of \p links was inserted (\p inserted true) or that one was erased.
+  void LinkSetChanged (const olsr::LinkSet &links, bool inserted);
+
+  /// Sets the timer of the link to \p neighborIface to fire after \p deadline.
+  void ScheduleTimer (Ipv4Address neighborIface, Time deadline);
+  /// Appends to \p due the links whose timer fires by \p now, and forgets those timers.
+  void ExpireTimers (Time now, std::vector<Ipv4Address> &due);
+  /**
+   * \param end set to the end of the earliest wheel slot holding a timer
+   * \returns false if no timer is set
+   */
+  bool GetNextTimerSlot (Time &end) const;
+  void Clear (void);
+
+  /// \returns the number of link timers set, each a simulator event the stock code would schedule
+  uint32_t GetTimersScheduled (void) const;
+
+private:
+  struct Entry
+  {
+    Ipv4Address address;
+    uint32_t position;
+  };
+  typedef std::vector<Entry> Bucket;
+
+  uint32_t BucketOf (Ipv4Address address) const;
+  void Rebuild (const olsr::LinkSet &links);
+
+  std::vector<Bucket> m_buckets;
+  /// Whether the buckets describe the link set.
+  bool m_indexed;
+  /// Link timer deadlines; the wheel only says when to look at them.
+  std::map<Ipv4Address, Time> m_timers;
+  SallyTimingWheel m_wheel;
+  uint32_t m_timersScheduled;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_LINK_INDEX_H */
@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-link-quality.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE ("SallyLinkQuality");
+
+namespace ns3 {
+
+const double SallyLinkQuality::MAX_ETX = 100;
+
+SallyLinkQuality::SallyLinkQuality ()
+  : m_window (Seconds (20))
+{
+}
+
+void
+SallyLinkQuality::SetWindow (Time window)
+{
+  m_window = window;
+}
+
+Time
+SallyLinkQuality::GetWindow (void) const
+{
+  return m_window;
+}
+
+void
+SallyLinkQuality::HelloReceived (Ipv4Address neighborIface, Time helloInterval, Time now)
+{
+  std::map<Ipv4Address, History>::iterator i = m_history.find (neighborIface);
+  if (i == m_history.end ())
+    {
+      i = m_history.insert (std::make_pair (neighborIface, History ())).first;
+      i->second.first = now;
+    }
+  History &history = i->second;
+  history.received.push_back (now);
+  history.interval = helloInterval;
+  while (!history.received.empty () && history.received.front () <= now - m_window)
+    {
+      history.received.pop_front ();
+    }
+}
+
+void
+SallyLinkQuality::SetReport (Ipv4Address neighborMain, const std::map<Ipv4Address, double> &ratios, Time now)
+{
+  Report &report = m_reports[neighborMain];
+  report.received = now;
+  report.ratios = ratios;
+}
+
+double
+SallyLinkQuality::GetReverseRatio (Ipv4Address neighborIface, Time now) const
+{
+  std::map<Ipv4Address, History>::const_iterator i = m_history.find (neighborIface);
+  if (i == m_history.end () || i->second.interval.IsZero ())
+    {
+      return 0;
+    }
+  const History &history = i->second;
+  uint32_t received = 0;
+  for (std::deque<Time>::const_reverse_iterator t = history.received.rbegin ();
+       t != history.received.rend () && *t > now - m_window; ++t)
+    {
+      received++;
+    }
+  // A neighbor heard for less than a window has not sent a full window yet.
+  Time span = std::min (m_window, now - history.first + history.interval);
+  double expected = std::max (1.0, std::floor (span.GetSeconds () / history.interval.GetSeconds ()));
+  return std::min (1.0, received / expected);
+}
+
+std::map<Ipv4Address, double>
+SallyLinkQuality::GetReverseRatios (Time now) const
+{
+  std::map<Ipv4Address, double> ratios;
+  for (std::map<Ipv4Address, History>::const_iterator i = m_history.begin (); i != m_history.end (); ++i)
+    {
+      double ratio = GetReverseRatio (i->first, now);
+      if (ratio > 0)
+        {
+          ratios[i->first] = ratio;
+        }
+    }
+  return ratios;
+}
+
+double
+SallyLinkQuality::GetReportedRatio (Ipv4Address neighborMain, Ipv4Address addr) const
+{
+  std::map<Ipv4Address, Report>::const_iterator report = m_reports.find (neighborMain);
+  if (report == m_reports.end ())
+    {
+      return -1;
+    }
+  std::map<Ipv4Address, double>::const_iterator i = report->second.ratios.find (addr);
+  return i == report->second.ratios.end () ? -1 : i->second;
+}
+
+double
+SallyLinkQuality::GetLinkEtx (Ipv4Address localIface, Ipv4Address neighborIface, Ipv4Address neighborMain, Time now) const
+{
+  double reverse = GetReverseRatio (neighborIface, now);
+  double forward = GetReportedRatio (neighborMain, localIface);
+  if (forward < 0)
+    {
+      forward = reverse;
+    }
+  return Etx (forward, reverse);
+}
+
+double
+SallyLinkQuality::GetTwoHopEtx (Ipv4Address neighborMain, Ipv4Address twoHop) const
+{
+  double ratio = GetReportedRatio (neighborMain, twoHop);
+  if (ratio < 0)
+    {
+      return 1;
+    }
+  return Etx (ratio, ratio);
+}
+
+double
+SallyLinkQuality::Etx (double forward, double reverse)
+{
+  double product = forward * reverse;
+  if (product <= 1 / MAX_ETX)
+    {
+      return MAX_ETX;
+    }
+  return std::max (1.0, 1 / product);
+}
+
+void
+SallyLinkQuality::WriteReport (olsr::MessageHeader &hello, const std::map<Ipv4Address, double> &ratios)
+{
+  // Address / ratio pairs, the ratio scaled to 16 bits.
+  olsr::MessageHeader::Hello::LinkMessage report;
+  report.linkCode = REPORT_TAG;
+  for (std::map<Ipv4Address, double>::const_iterator i = ratios.begin (); i != ratios.end (); ++i)
+    {
+      double ratio = std::max (0.0, std::min (1.0, i->second));
+      report.neighborInterfaceAddresses.push_back (i->first);
+      report.neighborInterfaceAddresses.push_back (Ipv4Address ((uint32_t) (ratio * 65535 + 0.5)));
+    }
+  hello.GetHello ().linkMessages.push_back (report);
+}
+
+bool
+SallyLinkQuality::ReadReport (const olsr::MessageHeader &hello, std::map<Ipv4Address, double> &ratios)
+{
+  const std::vector<olsr::MessageHeader::Hello::LinkMessage> &links = hello.GetHello ().linkMessages;
+  for (std::vector<olsr::MessageHeader::Hello::LinkMessage>::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      if (i->linkCode != REPORT_TAG)
+        {
+          continue;
+        }
+      ratios.clear ();
+      for (uint32_t a = 0; a + 1 < i->neighborInterfaceAddresses.size (); a += 2)
+        {
+          ratios[i->neighborInterfaceAddresses[a]] = std::min (1.0, i->neighborInterfaceAddresses[a + 1].Get () / 65535.0);
+        }
+      return true;
+    }
+  return false;
+}
+
+void
+SallyLinkQuality::Purge (Time now)
+{
+  for (std::map<Ipv4Address, History>::iterator i = m_history.begin (); i != m_history.end ();)
+    {
+      if (i->second.received.empty () || i->second.received.back () <= now - m_window)
+        {
+          NS_LOG_LOGIC ("No HELLO from " << i->first << " within the window");
+          m_history.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  for (std::map<Ipv4Address, Report>::iterator i = m_reports.begin (); i != m_reports.end ();)
+    {
+      if (i->second.received <= now - m_window)
+        {
+          m_reports.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+void
+SallyLinkQuality::Clear (void)
+{
+  m_history.clear ();
+  m_reports.clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_LINK_QUALITY_H
+#define SALLY_LINK_QUALITY_H
+
+#include <deque>
+#include <map>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/olsr-header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief ETX link metric from HELLO delivery ratios.
+ *
+ * The reverse delivery ratio of a link is the share of the HELLOs the
+ * neighbor sent over the last window that arrived here.  Each node
+ * advertises its reverse ratios in its HELLOs, which gives the neighbor
+ * its forward ratio; the ETX of the link is then 1 / (forward * reverse).
+ *
+ * The ratios a neighbor advertises for its own neighbors also give the
+ * 2-hop links a cost; for those the forward ratio is unknown and the
+ * link is assumed symmetric.
+ */
+class SallyLinkQuality
+{
+public:
+  /// Ceiling of the ETX, which also stands for a link that delivers nothing.
+  static const double MAX_ETX;
+
+  SallyLinkQuality ();
+
+  /// Delivery ratios are measured over the last \p window.
+  void SetWindow (Time window);
+  Time GetWindow (void) const;
+
+  /**
+   * Records a HELLO received from \p neighborIface.
+   *
+   * \param neighborIface the interface the HELLO was sent from
+   * \param helloInterval the emission interval the HELLO announces
+   * \param now the current time
+   */
+  void HelloReceived (Ipv4Address neighborIface, Time helloInterval, Time now);
+  /**
+   * Replaces the reverse ratios \p neighborMain advertised for its neighbors.
+   *
+   * \param neighborMain the main address of the advertising neighbor
+   * \param ratios neighbor interface address -> reverse delivery ratio
+   * \param now the current time
+   */
+  void SetReport (Ipv4Address neighborMain, const std::map<Ipv4Address, double> &ratios, Time now);
+
+  /// \returns the share of the HELLOs of \p neighborIface that arrived here
+  double GetReverseRatio (Ipv4Address neighborIface, Time now) const;
+  /// \returns the reverse ratios of all the neighbors heard within the window
+  std::map<Ipv4Address, double> GetReverseRatios (Time now) const;
+  /// \returns the ratio \p neighborMain advertised for \p addr, or a negative value
+  double GetReportedRatio (Ipv4Address neighborMain, Ipv4Address addr) const;
+
+  /**
+   * \returns the ETX of the link from \p localIface to \p neighborIface;
+   * until the neighbor reports on us the link counts as symmetric
+   */
+  double GetLinkEtx (Ipv4Address localIface, Ipv4Address neighborIface, Ipv4Address neighborMain, Time now) const;
+  /// \returns the ETX of the link from neighbor \p neighborMain to \p twoHop, 1 if unknown
+  double GetTwoHopEtx (Ipv4Address neighborMain, Ipv4Address twoHop) const;
+
+  /// \returns the ETX of the given delivery ratios, at most MAX_ETX
+  static double Etx (double forward, double reverse);
+  /// Appends \p ratios to \p hello as a link message plain OLSR ignores.
+  static void WriteReport (olsr::MessageHeader &hello, const std::map<Ipv4Address, double> &ratios);
+  /// \returns false if \p hello carries no ratios
+  static bool ReadReport (const olsr::MessageHeader &hello, std::map<Ipv4Address, double> &ratios);
+
+  /// Forgets the neighbors and reports not heard from within the window.
+  void Purge (Time now);
+  void Clear (void);
+
+private:
+  /// Link code of the report: neighbor type 3, which OLSR skips.
+  static const uint8_t REPORT_TAG = 0x0f;
+
+  /// HELLOs heard from one neighbor interface.
+  struct History
+  {
+    std::deque<Time> received;
+    Time interval;
+    Time first;
+  };
+  /// Ratios one neighbor advertised.
+  struct Report
+  {
+    Time received;
+    std::map<Ipv4Address, double> ratios;
+  };
+
+  Time m_window;
+  std::map<Ipv4Address, History> m_history;
+  std::map<Ipv4Address, Report> m_reports;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_LINK_QUALITY_H */
@@ -0,0 +1,217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "sally-mpr-selector.h"
+#include <map>
+
+NS_LOG_COMPONENT_DEFINE ("SallyMprSelector");
+
+/********** Willingness **********/
+
+/// Willingness for forwarding packets from other nodes: never.
+#define OLSR_WILL_NEVER         0
+/// Willingness for forwarding packets from other nodes: always.
+#define OLSR_WILL_ALWAYS        7
+
+namespace ns3 {
+
+SallyMprSelector::SallyMprSelector ()
+  : m_twoHopCount (0)
+{
+}
+
+uint32_t
+SallyMprSelector::PopCount (uint64_t word)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll (word);
+#else
+  uint32_t count = 0;
+  for (; word != 0; word &= word - 1)
+    {
+      count++;
+    }
+  return count;
+#endif
+}
+
+uint32_t
+SallyMprSelector::CountAnd (const Bitset &a, const Bitset &b)
+{
+  uint32_t count = 0;
+  for (uint32_t w = 0; w < a.size (); w++)
+    {
+      count += PopCount (a[w] & b[w]);
+    }
+  return count;
+}
+
+void
+SallyMprSelector::ClearAll (Bitset &a, const Bitset &b)
+{
+  for (uint32_t w = 0; w < a.size (); w++)
+    {
+      a[w] &= ~b[w];
+    }
+}
+
+bool
+SallyMprSelector::Any (const Bitset &a)
+{
+  for (uint32_t w = 0; w < a.size (); w++)
+    {
+      if (a[w] != 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+olsr::MprSet
+SallyMprSelector::Compute (const olsr::NeighborSet &neighbors,
+                           const olsr::TwoHopNeighborSet &twoHops,
+                           Ipv4Address mainAddress)
+{
+  // N, the symmetric neighbors, in neighbor set order: the stock
+  // heuristic keeps the first of equally good candidates.
+  std::vector<const olsr::NeighborTuple *> n;
+  std::map<Ipv4Address, uint32_t> neighborIndex;
+  for (olsr::NeighborSet::const_iterator i = neighbors.begin (); i != neighbors.end (); i++)
+    {
+      if (i->status == olsr::NeighborTuple::STATUS_SYM && neighborIndex.find (i->neighborMainAddr) == neighborIndex.end ())
+        {
+          neighborIndex[i->neighborMainAddr] = n.size ();
+          n.push_back (&*i);
+        }
+    }
+
+  // N2, the 2-hop neighbors reached through a willing member of N that
+  // are neither this node nor in N.
+  std::map<Ipv4Address, uint32_t> twoHopIndex;
+  std::vector<std::pair<uint32_t, uint32_t> > links;
+  for (olsr::TwoHopNeighborSet::const_iterator t = twoHops.begin (); t != twoHops.end (); t++)
+    {
+      std::map<Ipv4Address, uint32_t>::const_iterator via = neighborIndex.find (t->neighborMainAddr);
+      if (t->twoHopNeighborAddr == mainAddress || via == neighborIndex.end ()
+          || n[via->second]->willingness == OLSR_WILL_NEVER
+          || neighborIndex.find (t->twoHopNeighborAddr) != neighborIndex.end ())
+        {
+          continue;
+        }
+      std::map<Ipv4Address, uint32_t>::iterator x = twoHopIndex.find (t->twoHopNeighborAddr);
+      if (x == twoHopIndex.end ())
+        {
+          x = twoHopIndex.insert (std::make_pair (t->twoHopNeighborAddr, twoHopIndex.size ())).first;
+        }
+      links.push_back (std::make_pair (via->second, x->second));
+    }
+  m_twoHopCount = twoHopIndex.size ();
+
+  uint32_t words = (m_twoHopCount + 63) / 64;
+  m_coverage.resize (n.size ());
+  for (uint32_t y = 0; y < n.size (); y++)
+    {
+      m_coverage[y].assign (words, 0);
+    }
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator l = links.begin (); l != links.end (); l++)
+    {
+      m_coverage[l->first][l->second / 64] |= uint64_t (1) << (l->second % 64);
+    }
+  Bitset uncovered (words, ~uint64_t (0));
+  if (m_twoHopCount % 64 != 0)
+    {
+      uncovered[words - 1] = (uint64_t (1) << (m_twoHopCount % 64)) - 1;
+    }
+
+  // 1. Every neighbor willing to always forward.
+  olsr::MprSet mprSet;
+  for (uint32_t y = 0; y < n.size (); y++)
+    {
+      if (n[y]->willingness == OLSR_WILL_ALWAYS)
+        {
+          mprSet.insert (n[y]->neighborMainAddr);
+          ClearAll (uncovered, m_coverage[y]);
+        }
+    }
+
+  // 3. The only neighbor reaching an uncovered 2-hop neighbor.
+  std::vector<uint32_t> providers (m_twoHopCount, 0);
+  std::vector<uint32_t> provider (m_twoHopCount, 0);
+  for (uint32_t y = 0; y < n.size (); y++)
+    {
+      for (uint32_t x = 0; x < m_twoHopCount; x++)
+        {
+          if ((m_coverage[y][x / 64] >> (x % 64)) & 1)
+            {
+              providers[x]++;
+              provider[x] = y;
+            }
+        }
+    }
+  Bitset covered (words, 0);
+  for (uint32_t x = 0; x < m_twoHopCount; x++)
+    {
+      if (providers[x] == 1 && ((uncovered[x / 64] >> (x % 64)) & 1))
+        {
+          mprSet.insert (n[provider[x]]->neighborMainAddr);
+          for (uint32_t w = 0; w < words; w++)
+            {
+              covered[w] |= m_coverage[provider[x]][w];
+            }
+        }
+    }
+  ClearAll (uncovered, covered);
+
+  // 4. Greedily the neighbor of highest willingness, then reachability.
+  // The stock D(y) tie break counts 2-hop tuples of y that are not
+  // neighbors of y's own tuple, which is always 0, so it never decides.
+  while (Any (uncovered))
+    {
+      int32_t best = -1;
+      uint32_t bestReach = 0;
+      for (uint32_t y = 0; y < n.size (); y++)
+        {
+          uint32_t reach = CountAnd (m_coverage[y], uncovered);
+          if (reach == 0)
+            {
+              continue;
+            }
+          if (best < 0 || n[y]->willingness > n[best]->willingness
+              || (n[y]->willingness == n[best]->willingness && reach > bestReach))
+            {
+              best = y;
+              bestReach = reach;
+            }
+        }
+      NS_ASSERT (best >= 0);
+      mprSet.insert (n[best]->neighborMainAddr);
+      ClearAll (uncovered, m_coverage[best]);
+      NS_LOG_LOGIC ("Selected " << n[best]->neighborMainAddr << " covering " << bestReach << " 2-hop neighbors");
+    }
+  return mprSet;
+}
+
+uint32_t
+SallyMprSelector::GetTwoHopCount (void) const
+{
+  return m_twoHopCount;
+}
+
+} // namespace ns3
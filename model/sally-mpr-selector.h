@@ -0,0 +1,73 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_MPR_SELECTOR_H
+#define SALLY_MPR_SELECTOR_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/olsr-repositories.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief MPR selection on coverage bitsets.
+ *
+ * Runs the greedy heuristic of the stock OLSR MprComputation (RFC 3626,
+ * section 8.3.1) with the same tie breaking, so both pick the same MPR
+ * set.  The symmetric neighbors and the strict 2-hop neighbors are
+ * numbered once; each neighbor then covers a bitset of 2-hop neighbors,
+ * so the reachability of a neighbor is the popcount of its coverage AND
+ * the uncovered set instead of a scan of the 2-hop neighbor set.
+ */
+class SallyMprSelector
+{
+public:
+  SallyMprSelector ();
+
+  /**
+   * \param neighbors the neighbor set
+   * \param twoHops the 2-hop neighbor set
+   * \param mainAddress the main address of the computing node
+   * \returns the MPR set
+   */
+  olsr::MprSet Compute (const olsr::NeighborSet &neighbors,
+                        const olsr::TwoHopNeighborSet &twoHops,
+                        Ipv4Address mainAddress);
+
+  /// \returns the number of 2-hop neighbors the last computation had to cover
+  uint32_t GetTwoHopCount (void) const;
+
+private:
+  typedef std::vector<uint64_t> Bitset;
+
+  static uint32_t PopCount (uint64_t word);
+  /// \returns the number of bits set in both \p a and \p b
+  static uint32_t CountAnd (const Bitset &a, const Bitset &b);
+  /// Clears in \p a the bits set in \p b.
+  static void ClearAll (Bitset &a, const Bitset &b);
+  static bool Any (const Bitset &a);
+
+  uint32_t m_twoHopCount;
+  /// Kept across computations to reuse their storage.
+  std::vector<Bitset> m_coverage;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_MPR_SELECTOR_H */
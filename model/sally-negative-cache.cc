@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-negative-cache.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("SallyNegativeCache");
+
+namespace ns3 {
+
+SallyNegativeCache::SallyNegativeCache ()
+  : m_initialBackoff (Seconds (0)),
+    m_maxBackoff (Seconds (0))
+{
+}
+
+void
+SallyNegativeCache::SetBackoff (Time initial, Time maximum)
+{
+  m_initialBackoff = initial;
+  m_maxBackoff = std::max (initial, maximum);
+  if (!IsEnabled ())
+    {
+      m_entries.clear ();
+    }
+}
+
+Time
+SallyNegativeCache::GetInitialBackoff (void) const
+{
+  return m_initialBackoff;
+}
+
+Time
+SallyNegativeCache::GetMaxBackoff (void) const
+{
+  return m_maxBackoff;
+}
+
+bool
+SallyNegativeCache::IsEnabled (void) const
+{
+  return m_initialBackoff.IsStrictlyPositive ();
+}
+
+Time
+SallyNegativeCache::DiscoveryFailed (Ipv4Address dst, Time now)
+{
+  if (!IsEnabled ())
+    {
+      return Seconds (0);
+    }
+  EntryMap::iterator i = m_entries.find (dst);
+  if (i == m_entries.end ())
+    {
+      i = m_entries.insert (std::make_pair (dst, Entry ())).first;
+      i->second.backoff = m_initialBackoff;
+    }
+  else if (now > i->second.until + i->second.backoff)
+    {
+      i->second.backoff = m_initialBackoff;
+    }
+  else if (now >= i->second.until)
+    {
+      i->second.backoff = std::min (i->second.backoff + i->second.backoff, m_maxBackoff);
+    }
+  // A failure reported while still suppressed keeps the back-off.
+  i->second.until = now + i->second.backoff;
+  NS_LOG_LOGIC ("Discovery for " << dst << " failed, suppressed for " << i->second.backoff.GetSeconds () << "s");
+  return i->second.backoff;
+}
+
+bool
+SallyNegativeCache::IsSuppressed (Ipv4Address dst, Time now) const
+{
+  EntryMap::const_iterator i = m_entries.find (dst);
+  return i != m_entries.end () && now < i->second.until;
+}
+
+bool
+SallyNegativeCache::Remove (Ipv4Address dst)
+{
+  return m_entries.erase (dst) > 0;
+}
+
+void
+SallyNegativeCache::Purge (Time now)
+{
+  for (EntryMap::iterator i = m_entries.begin (); i != m_entries.end (); )
+    {
+      if (now > i->second.until + i->second.backoff)
+        {
+          m_entries.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+std::vector<Ipv4Address>
+SallyNegativeCache::GetDestinations (void) const
+{
+  std::vector<Ipv4Address> destinations;
+  destinations.reserve (m_entries.size ());
+  for (EntryMap::const_iterator i = m_entries.begin (); i != m_entries.end (); ++i)
+    {
+      destinations.push_back (i->first);
+    }
+  return destinations;
+}
+
+uint32_t
+SallyNegativeCache::GetSize (void) const
+{
+  return m_entries.size ();
+}
+
+bool
+SallyNegativeCache::IsEmpty (void) const
+{
+  return m_entries.empty ();
+}
+
+void
+SallyNegativeCache::Clear (void)
+{
+  m_entries.clear ();
+}
+
+} // namespace ns3
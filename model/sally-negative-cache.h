@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_NEGATIVE_CACHE_H
+#define SALLY_NEGATIVE_CACHE_H
+
+#include <map>
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Destinations whose route discovery recently failed.
+ *
+ * A failed destination is suppressed for a back-off period that starts
+ * at the initial back-off and doubles, up to the maximum, every time a
+ * discovery fails again soon after the previous suppression ended.  A
+ * destination that stayed quiet for a whole back-off period after its
+ * suppression starts again from the initial value.
+ */
+class SallyNegativeCache
+{
+public:
+  SallyNegativeCache ();
+
+  /// An initial back-off of 0 disables the cache.
+  void SetBackoff (Time initial, Time maximum);
+  Time GetInitialBackoff (void) const;
+  Time GetMaxBackoff (void) const;
+  bool IsEnabled (void) const;
+
+  /// Record that the discovery for \p dst failed at \p now.
+  /// \returns the back-off now in force for \p dst
+  Time DiscoveryFailed (Ipv4Address dst, Time now);
+  /// \returns true if no discovery for \p dst may be started at \p now
+  bool IsSuppressed (Ipv4Address dst, Time now) const;
+  /// Forget \p dst, typically because a route to it appeared.
+  /// \returns true if \p dst was in the cache
+  bool Remove (Ipv4Address dst);
+  /// Forget the destinations that would start again from the initial back-off.
+  void Purge (Time now);
+  /// \returns the destinations in the cache
+  std::vector<Ipv4Address> GetDestinations (void) const;
+  uint32_t GetSize (void) const;
+  bool IsEmpty (void) const;
+  void Clear (void);
+
+private:
+  struct Entry
+  {
+    /// End of the suppression.
+    Time until;
+    Time backoff;
+  };
+  typedef std::map<Ipv4Address, Entry> EntryMap;
+
+  Time m_initialBackoff;
+  Time m_maxBackoff;
+  EntryMap m_entries;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_NEGATIVE_CACHE_H */
@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "sally-neighbor-sensing.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyNeighborSensing");
+
+namespace ns3 {
+
+SallyNeighborSensing::SallyNeighborSensing ()
+  : m_events (0)
+{
+}
+
+void
+SallyNeighborSensing::SetNeighborUpCallback (NeighborCallback cb)
+{
+  m_neighborUp = cb;
+}
+
+void
+SallyNeighborSensing::SetNeighborDownCallback (NeighborCallback cb)
+{
+  m_neighborDown = cb;
+}
+
+void
+SallyNeighborSensing::NotifyNeighborUp (Ipv4Address neighbor, Ipv4Address local)
+{
+  NS_LOG_DEBUG ("Neighbor " << neighbor << " up on " << local);
+  m_neighbors[neighbor] = local;
+  m_events++;
+  if (!m_neighborUp.IsNull ())
+    {
+      m_neighborUp (neighbor, local);
+    }
+}
+
+void
+SallyNeighborSensing::NotifyNeighborDown (Ipv4Address neighbor, Ipv4Address local)
+{
+  NS_LOG_DEBUG ("Neighbor " << neighbor << " down on " << local);
+  if (m_neighbors.erase (neighbor) == 0)
+    {
+      return;
+    }
+  m_events++;
+  if (!m_neighborDown.IsNull ())
+    {
+      m_neighborDown (neighbor, local);
+    }
+}
+
+bool
+SallyNeighborSensing::IsNeighbor (Ipv4Address neighbor) const
+{
+  return m_neighbors.find (neighbor) != m_neighbors.end ();
+}
+
+uint32_t
+SallyNeighborSensing::GetNNeighbors (void) const
+{
+  return m_neighbors.size ();
+}
+
+uint32_t
+SallyNeighborSensing::GetNEvents (void) const
+{
+  return m_events;
+}
+
+void
+SallyNeighborSensing::Clear (void)
+{
+  m_neighbors.clear ();
+  m_neighborUp = NeighborCallback ();
+  m_neighborDown = NeighborCallback ();
+}
+
+} // namespace ns3
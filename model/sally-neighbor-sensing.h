@@ -0,0 +1,68 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_NEIGHBOR_SENSING_H
+#define SALLY_NEIGHBOR_SENSING_H
+
+#include <map>
+#include "ns3/ipv4-address.h"
+#include "ns3/callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * Neighbor table shared by the protocols of a SALLY node.
+ *
+ * SOLSR feeds it from its link set; every symmetric link that appears
+ * or disappears is passed on to the registered consumers, so they need
+ * no neighbor discovery of their own.
+ */
+class SallyNeighborSensing
+{
+public:
+  /// Called with the neighbor interface address and the local one.
+  typedef Callback<void, Ipv4Address, Ipv4Address> NeighborCallback;
+
+  SallyNeighborSensing ();
+
+  void SetNeighborUpCallback (NeighborCallback cb);
+  void SetNeighborDownCallback (NeighborCallback cb);
+
+  /// Records a symmetric link to \p neighbor heard on \p local.
+  void NotifyNeighborUp (Ipv4Address neighbor, Ipv4Address local);
+  /// Records the loss of the link to \p neighbor.
+  void NotifyNeighborDown (Ipv4Address neighbor, Ipv4Address local);
+
+  bool IsNeighbor (Ipv4Address neighbor) const;
+  uint32_t GetNNeighbors (void) const;
+  /// \returns the number of up and down events passed on so far
+  uint32_t GetNEvents (void) const;
+  /// Forgets all neighbors and consumers.
+  void Clear (void);
+
+private:
+  /// Neighbor interface address -> local interface address.
+  std::map<Ipv4Address, Ipv4Address> m_neighbors;
+  NeighborCallback m_neighborUp;
+  NeighborCallback m_neighborDown;
+  uint32_t m_events;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_NEIGHBOR_SENSING_H */
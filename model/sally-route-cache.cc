@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-route-cache.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyRouteCache");
+
+namespace ns3 {
+
+SallyRouteCache::SallyRouteCache ()
+  : m_mask (0),
+    m_generation (1),
+    m_hits (0),
+    m_misses (0)
+{
+}
+
+void
+SallyRouteCache::Resize (uint32_t capacity)
+{
+  uint32_t size = 1;
+  while (size < capacity)
+    {
+      size <<= 1;
+    }
+  m_slots.clear ();
+  m_slots.resize (capacity > 0 ? size : 0);
+  for (std::vector<Slot>::iterator i = m_slots.begin (); i != m_slots.end (); i++)
+    {
+      i->generation = 0;
+    }
+  m_mask = m_slots.empty () ? 0 : size - 1;
+}
+
+uint32_t
+SallyRouteCache::GetCapacity (void) const
+{
+  return m_slots.size ();
+}
+
+void
+SallyRouteCache::Invalidate (void)
+{
+  m_generation++;
+  if (m_generation == 0)
+    {
+      // Generation 0 marks never-used slots, so on wrap-around the
+      // remaining entries have to be cleared for real.
+      Resize (m_slots.size ());
+      m_generation = 1;
+    }
+}
+
+uint32_t
+SallyRouteCache::GetGeneration (void) const
+{
+  return m_generation;
+}
+
+uint32_t
+SallyRouteCache::Hash (Ipv4Address dst, Ptr<const NetDevice> oif) const
+{
+  uint32_t h = dst.Get () * 2654435761u;
+  if (oif != 0)
+    {
+      h ^= (oif->GetIfIndex () + 1) * 40503u;
+    }
+  return (h ^ (h >> 16)) & m_mask;
+}
+
+bool
+SallyRouteCache::IsLive (const Slot &slot) const
+{
+  return slot.generation == m_generation;
+}
+
+Ptr<Ipv4Route>
+SallyRouteCache::Lookup (Ipv4Address dst, Ptr<const NetDevice> oif)
+{
+  uint8_t owner;
+  return Lookup (dst, oif, owner);
+}
+
+Ptr<Ipv4Route>
+SallyRouteCache::Lookup (Ipv4Address dst, Ptr<const NetDevice> oif, uint8_t &owner)
+{
+  if (m_slots.empty ())
+    {
+      return 0;
+    }
+  uint32_t index = Hash (dst, oif);
+  for (uint32_t probe = 0; probe < MAX_PROBES; probe++)
+    {
+      const Slot &slot = m_slots[(index + probe) & m_mask];
+      if (!IsLive (slot))
+        {
+          break;
+        }
+      if (slot.dst == dst && slot.oif == oif)
+        {
+          m_hits++;
+          owner = slot.owner;
+          return slot.route;
+        }
+    }
+  m_misses++;
+  return 0;
+}
+
+void
+SallyRouteCache::Insert (Ipv4Address dst, Ptr<const NetDevice> oif, Ptr<Ipv4Route> route, uint8_t owner)
+{
+  if (m_slots.empty ())
+    {
+      return;
+    }
+  uint32_t index = Hash (dst, oif);
+  uint32_t victim = index;
+  for (uint32_t probe = 0; probe < MAX_PROBES; probe++)
+    {
+      uint32_t i = (index + probe) & m_mask;
+      Slot &slot = m_slots[i];
+      if (!IsLive (slot) || (slot.dst == dst && slot.oif == oif))
+        {
+          victim = i;
+          break;
+        }
+    }
+  // With every probed slot taken, the home slot is overwritten.
+  Slot &slot = m_slots[victim];
+  slot.dst = dst;
+  slot.oif = oif;
+  slot.generation = m_generation;
+  slot.owner = owner;
+  slot.route = route;
+  NS_LOG_LOGIC ("Cached route to " << dst << " via " << route->GetGateway ());
+}
+
+uint32_t
+SallyRouteCache::GetHits (void) const
+{
+  return m_hits;
+}
+
+uint32_t
+SallyRouteCache::GetMisses (void) const
+{
+  return m_misses;
+}
+
+} // namespace ns3
@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SALLY_ROUTE_CACHE_H
+#define SALLY_ROUTE_CACHE_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/net-device.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Small open-addressing cache of resolved routes.
+ *
+ * Entries are keyed by (destination, output device) and tagged with the
+ * generation that was current when they were stored.  Bumping the
+ * generation invalidates every entry at once; stale slots are simply
+ * reused by later insertions.  Each entry also keeps a small owner tag,
+ * which the cache does not interpret, telling the caller where the
+ * route came from.
+ */
+class SallyRouteCache
+{
+public:
+  SallyRouteCache ();
+
+  /// Drop all entries and use \p capacity slots (rounded up to a power of two).
+  void Resize (uint32_t capacity);
+  uint32_t GetCapacity (void) const;
+
+  /// Invalidate every entry currently stored.
+  void Invalidate (void);
+  uint32_t GetGeneration (void) const;
+
+  /// \returns the cached route, or 0 on a miss
+  Ptr<Ipv4Route> Lookup (Ipv4Address dst, Ptr<const NetDevice> oif);
+  /// \returns the cached route, or 0 on a miss; on a hit \p owner is set to the tag it was stored with
+  Ptr<Ipv4Route> Lookup (Ipv4Address dst, Ptr<const NetDevice> oif, uint8_t &owner);
+  void Insert (Ipv4Address dst, Ptr<const NetDevice> oif, Ptr<Ipv4Route> route, uint8_t owner = 0);
+
+  uint32_t GetHits (void) const;
+  uint32_t GetMisses (void) const;
+
+private:
+  struct Slot
+  {
+    Ipv4Address dst;
+    Ptr<const NetDevice> oif;
+    uint32_t generation;
+    uint8_t owner;
+    Ptr<Ipv4Route> route;
+  };
+
+  /// Maximum number of slots probed before giving up.
+  static const uint32_t MAX_PROBES = 4;
+
+  uint32_t Hash (Ipv4Address dst, Ptr<const NetDevice> oif) const;
+  bool IsLive (const Slot &slot) const;
+
+  std::vector<Slot> m_slots;
+  uint32_t m_mask;
+  uint32_t m_generation;
+  uint32_t m_hits;
+  uint32_t m_misses;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_ROUTE_CACHE_H */
@@ -0,0 +1,337 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "sally-route-index.h"
+
+NS_LOG_COMPONENT_DEFINE ("SallyRouteIndex");
+
+namespace ns3 {
+
+SallyRouteIndex::SallyRouteIndex ()
+  : m_visited (0)
+{
+}
+
+bool
+SallyRouteIndex::SameRoute (const Route &a, const Route &b)
+{
+  return a.nextAddr == b.nextAddr && a.interface == b.interface && a.distance == b.distance;
+}
+
+void
+SallyRouteIndex::Touch (Ipv4Address dst)
+{
+  if (m_before.find (dst) != m_before.end ())
+    {
+      return;
+    }
+  std::map<Ipv4Address, Node>::const_iterator i = m_nodes.find (dst);
+  m_before[dst] = i == m_nodes.end () ? std::make_pair (false, Route ()) : std::make_pair (true, i->second.route);
+  m_visited++;
+}
+
+void
+SallyRouteIndex::Detach (Ipv4Address root, std::vector<Ipv4Address> &detached)
+{
+  std::vector<Ipv4Address> stack (1, root);
+  while (!stack.empty ())
+    {
+      Ipv4Address node = stack.back ();
+      stack.pop_back ();
+      if (m_nodes.find (node) == m_nodes.end ())
+        {
+          continue;
+        }
+      Touch (node);
+      m_nodes.erase (node);
+      detached.push_back (node);
+      Adjacency::const_iterator out = m_out.find (node);
+      if (out == m_out.end ())
+        {
+          continue;
+        }
+      for (std::set<Ipv4Address>::const_iterator w = out->second.begin (); w != out->second.end (); ++w)
+        {
+          std::map<Ipv4Address, Node>::const_iterator child = m_nodes.find (*w);
+          if (child != m_nodes.end () && !child->second.direct && child->second.parent == node)
+            {
+              stack.push_back (*w);
+            }
+        }
+    }
+}
+
+void
+SallyRouteIndex::Relax (Ipv4Address from, Ipv4Address to, Queue &queue)
+{
+  std::map<Ipv4Address, Node>::const_iterator source = m_nodes.find (from);
+  if (source == m_nodes.end ())
+    {
+      return;
+    }
+  Route route = source->second.route;
+  route.distance++;
+  std::map<Ipv4Address, Node>::iterator target = m_nodes.find (to);
+  if (target != m_nodes.end ())
+    {
+      if (target->second.direct)
+        {
+          return;
+        }
+      bool shorter = route.distance < target->second.route.distance;
+      bool inherited = target->second.parent == from && !SameRoute (route, target->second.route);
+      if (!shorter && !inherited)
+        {
+          return;
+        }
+      queue.erase (std::make_pair (target->second.route.distance, to));
+    }
+  Touch (to);
+  Node &node = m_nodes[to];
+  node.route = route;
+  node.parent = from;
+  node.direct = false;
+  queue.insert (std::make_pair (route.distance, to));
+}
+
+void
+SallyRouteIndex::EdgeAppeared (const Edge &edge)
+{
+  if (m_removed.erase (edge) == 0)
+    {
+      m_added.insert (edge);
+    }
+}
+
+void
+SallyRouteIndex::EdgeDisappeared (const Edge &edge)
+{
+  if (m_added.erase (edge) == 0)
+    {
+      m_removed.insert (edge);
+    }
+}
+
+void
+SallyRouteIndex::AddEdge (Ipv4Address from, Ipv4Address to)
+{
+  Edge edge (from, to);
+  if (m_edges[edge]++ == 0)
+    {
+      EdgeAppeared (edge);
+    }
+}
+
+void
+SallyRouteIndex::RemoveEdge (Ipv4Address from, Ipv4Address to)
+{
+  std::map<Edge, uint32_t>::iterator i = m_edges.find (Edge (from, to));
+  if (i == m_edges.end ())
+    {
+      return;
+    }
+  if (--i->second == 0)
+    {
+      EdgeDisappeared (i->first);
+      m_edges.erase (i);
+    }
+}
+
+void
+SallyRouteIndex::Update (const std::map<Ipv4Address, Route> &direct, const std::set<Edge> &edges)
+{
+  for (std::map<Edge, uint32_t>::iterator i = m_edges.begin (); i != m_edges.end (); )
+    {
+      if (edges.find (i->first) == edges.end ())
+        {
+          EdgeDisappeared (i->first);
+          m_edges.erase (i++);
+        }
+      else
+        {
+          i->second = 1;
+          ++i;
+        }
+    }
+  for (std::set<Edge>::const_iterator e = edges.begin (); e != edges.end (); ++e)
+    {
+      if (m_edges.insert (std::make_pair (*e, 1)).second)
+        {
+          EdgeAppeared (*e);
+        }
+    }
+  Update (direct);
+}
+
+void
+SallyRouteIndex::Update (const std::map<Ipv4Address, Route> &direct)
+{
+  m_before.clear ();
+  m_changed.clear ();
+  m_visited = 0;
+
+  std::vector<Edge> removed (m_removed.begin (), m_removed.end ());
+  std::vector<Edge> added (m_added.begin (), m_added.end ());
+  m_removed.clear ();
+  m_added.clear ();
+  for (std::vector<Edge>::const_iterator e = added.begin (); e != added.end (); ++e)
+    {
+      m_out[e->first].insert (e->second);
+      m_in[e->second].insert (e->first);
+    }
+
+  // Detach what lost its path: changed or lost direct neighbors, and
+  // the subtrees below removed tree edges.
+  std::vector<Ipv4Address> detached;
+  for (std::map<Ipv4Address, Route>::const_iterator d = m_direct.begin (); d != m_direct.end (); ++d)
+    {
+      std::map<Ipv4Address, Route>::const_iterator now = direct.find (d->first);
+      if (now == direct.end () || !SameRoute (now->second, d->second))
+        {
+          Detach (d->first, detached);
+        }
+    }
+  for (std::vector<Edge>::const_iterator e = removed.begin (); e != removed.end (); ++e)
+    {
+      std::map<Ipv4Address, Node>::const_iterator node = m_nodes.find (e->second);
+      if (node != m_nodes.end () && !node->second.direct && node->second.parent == e->first)
+        {
+          Detach (e->second, detached);
+        }
+    }
+  for (std::vector<Edge>::const_iterator e = removed.begin (); e != removed.end (); ++e)
+    {
+      m_out[e->first].erase (e->second);
+      m_in[e->second].erase (e->first);
+    }
+
+  Queue queue;
+  for (std::map<Ipv4Address, Route>::const_iterator d = direct.begin (); d != direct.end (); ++d)
+    {
+      std::map<Ipv4Address, Node>::iterator node = m_nodes.find (d->first);
+      if (node != m_nodes.end () && node->second.direct)
+        {
+          continue;
+        }
+      if (node != m_nodes.end ())
+        {
+          // A node reached over the graph that became a direct neighbor.
+          queue.erase (std::make_pair (node->second.route.distance, d->first));
+        }
+      Touch (d->first);
+      Node &entry = m_nodes[d->first];
+      entry.route = d->second;
+      entry.route.distance = 1;
+      entry.direct = true;
+      queue.insert (std::make_pair (1, d->first));
+    }
+  m_direct = direct;
+
+  // Reattach the detached nodes from their remaining in-edges and let the
+  // new edges shorten what they can.
+  for (std::vector<Ipv4Address>::const_iterator x = detached.begin (); x != detached.end (); ++x)
+    {
+      Adjacency::const_iterator in = m_in.find (*x);
+      if (in == m_in.end ())
+        {
+          continue;
+        }
+      for (std::set<Ipv4Address>::const_iterator p = in->second.begin (); p != in->second.end (); ++p)
+        {
+          Relax (*p, *x, queue);
+        }
+    }
+  for (std::vector<Edge>::const_iterator e = added.begin (); e != added.end (); ++e)
+    {
+      Relax (e->first, e->second, queue);
+    }
+
+  while (!queue.empty ())
+    {
+      Ipv4Address node = queue.begin ()->second;
+      queue.erase (queue.begin ());
+      Adjacency::const_iterator out = m_out.find (node);
+      if (out == m_out.end ())
+        {
+          continue;
+        }
+      for (std::set<Ipv4Address>::const_iterator w = out->second.begin (); w != out->second.end (); ++w)
+        {
+          Relax (node, *w, queue);
+        }
+    }
+
+  for (std::map<Ipv4Address, std::pair<bool, Route> >::const_iterator b = m_before.begin (); b != m_before.end (); ++b)
+    {
+      std::map<Ipv4Address, Node>::const_iterator node = m_nodes.find (b->first);
+      bool reachable = node != m_nodes.end ();
+      if (reachable != b->second.first || (reachable && !SameRoute (node->second.route, b->second.second)))
+        {
+          m_changed.push_back (b->first);
+        }
+    }
+  NS_LOG_LOGIC (added.size () << " edges added, " << removed.size () << " removed, "
+                << m_visited << " destinations visited, " << m_changed.size () << " changed");
+}
+
+bool
+SallyRouteIndex::Lookup (Ipv4Address dst, Route &route) const
+{
+  std::map<Ipv4Address, Node>::const_iterator i = m_nodes.find (dst);
+  if (i == m_nodes.end ())
+    {
+      return false;
+    }
+  route = i->second.route;
+  return true;
+}
+
+const std::vector<Ipv4Address> &
+SallyRouteIndex::GetChanged (void) const
+{
+  return m_changed;
+}
+
+uint32_t
+SallyRouteIndex::GetVisited (void) const
+{
+  return m_visited;
+}
+
+uint32_t
+SallyRouteIndex::GetSize (void) const
+{
+  return m_nodes.size ();
+}
+
+void
+SallyRouteIndex::Clear (void)
+{
+  m_direct.clear ();
+  m_edges.clear ();
+  m_added.clear ();
+  m_removed.clear ();
+  m_out.clear ();
+  m_in.clear ();
+  m_nodes.clear ();
+  m_before.clear ();
+  m_changed.clear ();
+  m_visited = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,124 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SALLY_ROUTE_INDEX_H
+#define SALLY_ROUTE_INDEX_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Incrementally maintained shortest-hop routes over an indexed graph.
+ *
+ * The graph is given as the routes to the direct neighbors, one hop
+ * each, and the edges known beyond them, either whole or as edges added
+ * and removed since the last update.  An edge may be added by several
+ * sources and stays until each removed it.  Update keeps the BFS tree
+ * across the changes: a removed tree edge only
+ * detaches the subtree below it, which is reattached from its remaining
+ * in-edges, and an added edge only propagates as far as it shortens or
+ * redirects paths.  Everything else keeps its route untouched.
+ */
+class SallyRouteIndex
+{
+public:
+  /// The first hop and length of the path to a destination.
+  struct Route
+  {
+    Ipv4Address nextAddr;
+    uint32_t interface;
+    uint32_t distance;
+  };
+  typedef std::pair<Ipv4Address, Ipv4Address> Edge;
+
+  SallyRouteIndex ();
+
+  /// Adds a reference to the edge \p from -> \p to, taken into account
+  /// at the next Update.
+  void AddEdge (Ipv4Address from, Ipv4Address to);
+  /// Drops a reference to the edge \p from -> \p to.
+  void RemoveEdge (Ipv4Address from, Ipv4Address to);
+  /**
+   * Brings the routes in line with the edges added and removed since the
+   * last update.
+   *
+   * \param direct the routes to the direct neighbors, whose distance is 1
+   */
+  void Update (const std::map<Ipv4Address, Route> &direct);
+  /**
+   * Brings the routes in line with a new graph.
+   *
+   * \param direct the routes to the direct neighbors, whose distance is 1
+   * \param edges the (from, to) edges beyond the direct neighbors
+   */
+  void Update (const std::map<Ipv4Address, Route> &direct, const std::set<Edge> &edges);
+  /// \returns false if \p dst is unreachable
+  bool Lookup (Ipv4Address dst, Route &route) const;
+  /// \returns the destinations whose route changed, appeared or disappeared at the last Update
+  const std::vector<Ipv4Address> &GetChanged (void) const;
+  /// \returns the number of destinations the last Update had to recompute
+  uint32_t GetVisited (void) const;
+  uint32_t GetSize (void) const;
+  void Clear (void);
+
+private:
+  struct Node
+  {
+    Route route;
+    /// Predecessor on the BFS tree; unused for direct neighbors.
+    Ipv4Address parent;
+    bool direct;
+  };
+  typedef std::map<Ipv4Address, std::set<Ipv4Address> > Adjacency;
+  /// Pending nodes ordered by distance.
+  typedef std::set<std::pair<uint32_t, Ipv4Address> > Queue;
+
+  /// Remembers the route of \p dst before this update first touches it.
+  void Touch (Ipv4Address dst);
+  /// Removes \p root and the BFS subtree below it, appending them to \p detached.
+  void Detach (Ipv4Address root, std::vector<Ipv4Address> &detached);
+  /// Reaches \p to from \p from if that is shorter, or if \p from is
+  /// already its parent and changed.
+  void Relax (Ipv4Address from, Ipv4Address to, Queue &queue);
+  static bool SameRoute (const Route &a, const Route &b);
+  /// Records that \p edge appeared in, or left, the graph.
+  void EdgeAppeared (const Edge &edge);
+  void EdgeDisappeared (const Edge &edge);
+
+  std::map<Ipv4Address, Route> m_direct;
+  /// References to each edge of the graph.
+  std::map<Edge, uint32_t> m_edges;
+  /// Edges that appeared or disappeared since the last update.
+  std::set<Edge> m_added;
+  std::set<Edge> m_removed;
+  Adjacency m_out;
+  Adjacency m_in;
+  std::map<Ipv4Address, Node> m_nodes;
+  /// Route of each touched destination before the update; absent if it had none.
+  std::map<Ipv4Address, std::pair<bool, Route> > m_before;
+  std::vector<Ipv4Address> m_changed;
+  uint32_t m_visited;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_ROUTE_INDEX_H */
@@ -18,12 +18,21 @@
  */
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/node.h"
 #include "ns3/ipv4-static-routing.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/nstime.h"
+#include "ns3/tag.h"
+#include "ns3/aodv-routing-protocol.h"
 #include "sally-routing.h"
 #include "ns3/solsr-routing-protocol.h"
+#include "ns3/saodv-routing-protocol.h"
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("SallyRouting");
 
@@ -31,46 +40,1134 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (SallyRouting);
 
+/// Marks local packets routed to the loopback device to wait for a route.
+class SallyDeferredTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::SallyDeferredTag")
+      .SetParent<Tag> ()
+      .AddConstructor<SallyDeferredTag> ()
+    ;
+    return tid;
+  }
+  TypeId GetInstanceTypeId () const
+  {
+    return GetTypeId ();
+  }
+  uint32_t GetSerializedSize () const
+  {
+    return 0;
+  }
+  void Serialize (TagBuffer i) const
+  {
+  }
+  void Deserialize (TagBuffer i)
+  {
+  }
+  void Print (std::ostream &os) const
+  {
+    os << "SallyDeferredTag";
+  }
+};
+
+NS_OBJECT_ENSURE_REGISTERED (SallyDeferredTag);
+
 TypeId
 SallyRouting::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::SallyRouting")
     .SetParent<Ipv4ListRouting> ()
     .AddConstructor<SallyRouting> ()
+    .AddAttribute ("RouteCacheSize", "Number of slots of the per-destination forwarding cache (0 disables it).",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&SallyRouting::SetRouteCacheSize,
+                                         &SallyRouting::GetRouteCacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RouteCacheHits", "Number of lookups answered by the forwarding cache.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetRouteCacheHits),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RouteCacheMisses", "Number of lookups that missed the forwarding cache.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetRouteCacheMisses),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ModeEnterThreshold", "Number of MPR selectors at or above which AODV mode is entered.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&SallyRouting::m_modeEnterThreshold),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("ModeExitThreshold", "Number of MPR selectors at or below which AODV mode is left.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::m_modeExitThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ModeMinDwell", "Minimum time spent in a mode before switching again.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&SallyRouting::m_modeMinDwell),
+                   MakeTimeChecker ())
+    .AddAttribute ("ModeMaxDwell", "Upper bound of the dwell time reached by back-off.",
+                   TimeValue (Seconds (32)),
+                   MakeTimeAccessor (&SallyRouting::m_modeMaxDwell),
+                   MakeTimeChecker ())
+    .AddAttribute ("ModeBackoffWindow", "Transitions closer than this to the end of the previous dwell double the dwell time, "
+                   "which starts from this window when it was zero.",
+                   TimeValue (Seconds (4)),
+                   MakeTimeAccessor (&SallyRouting::m_modeBackoffWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("SharedNeighborSensing", "AODV takes neighbor up/down events from the SOLSR link set and sends no HELLOs.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SallyRouting::m_sharedNeighborSensing),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SeedAodvRoutes", "Copy the SOLSR routes into AODV when entering AODV mode.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SallyRouting::m_seedAodvRoutes),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LocalRepair", "Repair broken AODV routes from the SOLSR 2-hop neighborhood before sending an RERR.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SallyRouting::m_localRepair),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DeferralQueueSize", "Number of packets without a route that may wait for one (0 drops them at once).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::SetDeferralQueueSize,
+                                         &SallyRouting::GetDeferralQueueSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DeferralPerDestination", "Number of packets that may wait for a route to the same destination.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&SallyRouting::SetDeferralPerDestination,
+                                         &SallyRouting::GetDeferralPerDestination),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("DeferralTimeout", "Time a packet may wait for a route before it is dropped.",
+                   TimeValue (Seconds (3)),
+                   MakeTimeAccessor (&SallyRouting::SetDeferralTimeout,
+                                     &SallyRouting::GetDeferralTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("DeferredPackets", "Number of packets that had to wait for a route.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetDeferredPackets),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DeferredReleased", "Number of deferred packets sent once a route appeared.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetDeferredReleased),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DeferralDrops", "Number of packets refused by the deferral queue or timed out in it.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetDeferralDrops),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DiscoveryBatchWindow", "Route discoveries needed within this window share one RREQ (0 starts each at once).",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&SallyRouting::m_discoveryBatchWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("DiscoveryBatches", "Number of RREQs that looked for several destinations.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetDiscoveryBatches),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RreqsCoalesced", "Number of deferred packets that joined a route discovery already under way.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetRreqsCoalesced),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DiscoveryRetries", "Number of route discoveries started again for packets still queued after one failed.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetDiscoveryRetries),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("NegativeCacheBackoff", "Time a destination whose discovery failed gets no new discovery (0 disables the negative cache).",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&SallyRouting::SetNegativeCacheBackoff,
+                                     &SallyRouting::GetNegativeCacheBackoff),
+                   MakeTimeChecker ())
+    .AddAttribute ("NegativeCacheMaxBackoff", "Upper bound of the negative cache back-off.",
+                   TimeValue (Seconds (32)),
+                   MakeTimeAccessor (&SallyRouting::SetNegativeCacheMaxBackoff,
+                                     &SallyRouting::GetNegativeCacheMaxBackoff),
+                   MakeTimeChecker ())
+    .AddAttribute ("RreqsSuppressed", "Number of route discoveries not started because their destination was recently unreachable.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetRreqsSuppressed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LateRoutes", "Number of routes that appeared to destinations after their discovery failed.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetLateRoutes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ControlAggregationWindow", "SOLSR and AODV broadcasts ready within this window share one datagram (0 disables aggregation).",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&SallyRouting::SetControlAggregationWindow,
+                                     &SallyRouting::GetControlAggregationWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("ControlContainers", "Number of datagrams that carried aggregated control messages.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetControlContainers),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ControlMessagesAggregated", "Number of control messages sent inside aggregated datagrams.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SallyRouting::GetControlMessagesAggregated),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ("ModeChange", "The node switched between OLSR-only and OLSR+AODV routing.",
+                     MakeTraceSourceAccessor (&SallyRouting::m_modeChangeTrace))
+    .AddTraceSource ("ModeTransitionCost", "A mode was left: the mode, the RREQs originated while in it and its duration.",
+                     MakeTraceSourceAccessor (&SallyRouting::m_modeTransitionCostTrace))
   ;
   return tid;
 }
 
+SallyRouting::SallyRouting ()
+  : m_useAodv (true),
+    m_mprSelectorCount (0),
+    m_modeTransitions (0),
+    m_lastModeTransition (Seconds (0)),
+    m_modeDwell (Seconds (0)),
+    m_modeDwellTimer (Timer::CANCEL_ON_DESTROY),
+    m_rreqsSinceTransition (0),
+    m_sharedNeighborSensing (false),
+    m_seedAodvRoutes (false),
+    m_localRepair (false),
+    m_deferralTimer (Timer::CANCEL_ON_DESTROY),
+    m_discoveryBatchWindow (MilliSeconds (10)),
+    m_discoveryBatches (0),
+    m_rreqsCoalesced (0),
+    m_discoveryRetries (0),
+    m_rreqsSuppressed (0),
+    m_lateRoutes (0)
+{
+  m_modeDwellTimer.SetFunction (&SallyRouting::EvaluateMode, this);
+  m_deferralTimer.SetFunction (&SallyRouting::DeferralTimerExpire, this);
+}
+
+void
+SallyRouting::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_protocolTable.clear ();
+  AttachSolsr (0);
+  AttachAodv (0);
+  m_modeDwellTimer.Cancel ();
+  m_routeCache.Resize (0);
+  m_neighborSensing.Clear ();
+  m_deferral.Clear ();
+  m_deferralTimer.Cancel ();
+  m_releaseEvent.Cancel ();
+  m_discoveryBatchEvent.Cancel ();
+  m_discoveryBatch.clear ();
+  m_negativeCache.Clear ();
+  m_aggregator.Dispose ();
+  Ipv4ListRouting::DoDispose ();
+}
+
+void
+SallyRouting::DoInitialize (void)
+{
+  // Without a gap between the thresholds every selector change would
+  // switch the mode.
+  NS_ABORT_MSG_UNLESS (m_modeEnterThreshold > m_modeExitThreshold,
+                       "ModeEnterThreshold (" << m_modeEnterThreshold << ") must be above ModeExitThreshold ("
+                       << m_modeExitThreshold << ")");
+  Ipv4ListRouting::DoInitialize ();
+}
+
+SallyRouting::ProtocolKind
+SallyRouting::Classify (Ptr<Ipv4RoutingProtocol> protocol)
+{
+  if (DynamicCast<sally::SOlsrRoutingProtocol> (protocol))
+    {
+      return SOLSR;
+    }
+  if (DynamicCast<aodv::RoutingProtocol> (protocol))
+    {
+      return AODV;
+    }
+  if (DynamicCast<Ipv4StaticRouting> (protocol))
+    {
+      return STATIC;
+    }
+  return OTHER;
+}
+
+void
+SallyRouting::AddRoutingProtocol (Ptr<Ipv4RoutingProtocol> routingProtocol, int16_t priority)
+{
+  NS_LOG_FUNCTION (this << routingProtocol->GetInstanceTypeId () << priority);
+  Ipv4ListRouting::AddRoutingProtocol (routingProtocol, priority);
+  RebuildProtocolTable ();
+}
+
+void
+SallyRouting::RebuildProtocolTable (void)
+{
+  // m_routingProtocols is kept sorted by priority by Ipv4ListRouting, so
+  // the table inherits the same consultation order.
+  m_protocolTable.clear ();
+  m_protocolTable.reserve (m_routingProtocols.size ());
+  Ptr<sally::SOlsrRoutingProtocol> solsr = 0;
+  Ptr<aodv::RoutingProtocol> aodv = 0;
+  for (Ipv4RoutingProtocolList::const_iterator i = m_routingProtocols.begin ();
+       i != m_routingProtocols.end (); i++)
+    {
+      ProtocolSlot slot;
+      slot.protocol = (*i).second;
+      slot.priority = (*i).first;
+      slot.kind = Classify ((*i).second);
+      if (slot.kind == SOLSR && solsr == 0)
+        {
+          solsr = DynamicCast<sally::SOlsrRoutingProtocol> ((*i).second);
+        }
+      else if (slot.kind == AODV && aodv == 0)
+        {
+          aodv = DynamicCast<aodv::RoutingProtocol> ((*i).second);
+        }
+      m_protocolTable.push_back (slot);
+    }
+
+  AttachSolsr (solsr);
+  AttachAodv (aodv);
+  ConnectAodvToSolsr ();
+  ConnectAggregator ();
+  m_routeCache.Invalidate ();
+}
+
+void
+SallyRouting::AttachSolsr (Ptr<sally::SOlsrRoutingProtocol> solsr)
+{
+  if (solsr == m_solsr)
+    {
+      return;
+    }
+  if (m_solsr != 0)
+    {
+      m_solsr->TraceDisconnectWithoutContext ("MprSelectorsChanged", MakeCallback (&SallyRouting::MprSelectorsChanged, this));
+      m_solsr->TraceDisconnectWithoutContext ("RoutingTableChanged", MakeCallback (&SallyRouting::SolsrRoutingTableChanged, this));
+      m_solsr->TraceDisconnectWithoutContext ("NeighborChanged", MakeCallback (&SallyRouting::SolsrNeighborChanged, this));
+      m_solsr->TraceDisconnectWithoutContext ("LinkBreakDetected", MakeCallback (&SallyRouting::SolsrLinkBroken, this));
+      m_solsr->SetDivertCallback (sally::SOlsrRoutingProtocol::DivertCallback ());
+    }
+  m_solsr = solsr;
+  // Without SOLSR there are no MPR selectors to decide on, and AODV is
+  // the only protocol left to route with.
+  m_useAodv = true;
+  m_mprSelectorCount = 0;
+  if (m_solsr != 0)
+    {
+      m_solsr->TraceConnectWithoutContext ("MprSelectorsChanged", MakeCallback (&SallyRouting::MprSelectorsChanged, this));
+      m_solsr->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&SallyRouting::SolsrRoutingTableChanged, this));
+      m_solsr->TraceConnectWithoutContext ("NeighborChanged", MakeCallback (&SallyRouting::SolsrNeighborChanged, this));
+      m_solsr->TraceConnectWithoutContext ("LinkBreakDetected", MakeCallback (&SallyRouting::SolsrLinkBroken, this));
+      m_mprSelectorCount = m_solsr->m_state.GetMprSelectors ().size ();
+      m_useAodv = m_mprSelectorCount >= m_modeEnterThreshold;
+    }
+}
+
+void
+SallyRouting::AttachAodv (Ptr<aodv::RoutingProtocol> aodv)
+{
+  if (aodv == m_aodv)
+    {
+      return;
+    }
+  if (m_aodv != 0)
+    {
+      Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+      if (saodv != 0)
+        {
+          saodv->SetRelayFilter (MakeNullCallback<bool, Ipv4Address> ());
+          saodv->SetRepairCallback (sally::SAodvRoutingProtocol::RepairCallback ());
+          saodv->SetDivertCallback (sally::SAodvRoutingProtocol::DivertCallback ());
+          saodv->SetLinkCostCallback (sally::SAodvRoutingProtocol::LinkCostCallback ());
+          m_neighborSensing.SetNeighborUpCallback (SallyNeighborSensing::NeighborCallback ());
+          m_neighborSensing.SetNeighborDownCallback (SallyNeighborSensing::NeighborCallback ());
+          saodv->SetRouteChangeCallback (Callback<void> ());
+        }
+      m_aodv->TraceDisconnectWithoutContext ("RreqTx", MakeCallback (&SallyRouting::AodvRreqSent, this));
+      m_aodv->TraceDisconnectWithoutContext ("Rx", MakeCallback (&SallyRouting::AodvControlReceived, this));
+    }
+  m_aodv = aodv;
+  m_saodv = DynamicCast<sally::SAodvRoutingProtocol> (aodv);
+  if (m_aodv != 0)
+    {
+      m_aodv->TraceConnectWithoutContext ("RreqTx", MakeCallback (&SallyRouting::AodvRreqSent, this));
+      m_aodv->TraceConnectWithoutContext ("Rx", MakeCallback (&SallyRouting::AodvControlReceived, this));
+    }
+  if (m_saodv != 0)
+    {
+      m_saodv->SetRouteChangeCallback (MakeCallback (&SallyRouting::AodvRoutingTableChanged, this));
+    }
+}
+
+void
+SallyRouting::ConnectAodvToSolsr (void)
+{
+  m_neighborSensing.SetNeighborUpCallback (SallyNeighborSensing::NeighborCallback ());
+  m_neighborSensing.SetNeighborDownCallback (SallyNeighborSensing::NeighborCallback ());
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv == 0)
+    {
+      return;
+    }
+  if (m_solsr == 0)
+    {
+      saodv->SetRelayFilter (MakeNullCallback<bool, Ipv4Address> ());
+      saodv->SetRepairCallback (sally::SAodvRoutingProtocol::RepairCallback ());
+      saodv->SetLinkCostCallback (sally::SAodvRoutingProtocol::LinkCostCallback ());
+      saodv->SetSharedNeighborSensing (false);
+      return;
+    }
+  saodv->SetRelayFilter (MakeCallback (&sally::SOlsrRoutingProtocol::RelaysFor, m_solsr));
+  saodv->SetLinkCostCallback (m_solsr->IsEtxEnabled ()
+                              ? MakeCallback (&sally::SOlsrRoutingProtocol::GetLinkCost, m_solsr)
+                              : sally::SAodvRoutingProtocol::LinkCostCallback ());
+  saodv->SetRepairCallback (m_localRepair ? MakeCallback (&sally::SOlsrRoutingProtocol::RepairRoutes, m_solsr)
+                                          : sally::SAodvRoutingProtocol::RepairCallback ());
+  if (m_sharedNeighborSensing)
+    {
+      m_neighborSensing.SetNeighborUpCallback (MakeCallback (&sally::SAodvRoutingProtocol::NeighborUp, saodv));
+      m_neighborSensing.SetNeighborDownCallback (MakeCallback (&sally::SAodvRoutingProtocol::NeighborDown, saodv));
+      saodv->SetSharedNeighborSensing (true);
+    }
+}
+
+void
+SallyRouting::ConnectAggregator (void)
+{
+  sally::SOlsrRoutingProtocol::DivertCallback divert;
+  if (m_aggregator.IsEnabled ())
+    {
+      divert = MakeCallback (&SallyControlAggregator::Queue, &m_aggregator);
+    }
+  if (m_solsr != 0)
+    {
+      m_solsr->SetDivertCallback (divert);
+    }
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv != 0)
+    {
+      saodv->SetDivertCallback (divert);
+    }
+}
+
+void
+SallyRouting::SolsrNeighborChanged (Ipv4Address neighbor, Ipv4Address local, bool up)
+{
+  if (up)
+    {
+      m_neighborSensing.NotifyNeighborUp (neighbor, local);
+    }
+  else
+    {
+      m_neighborSensing.NotifyNeighborDown (neighbor, local);
+    }
+}
+
+void
+SallyRouting::SolsrLinkBroken (Ipv4Address neighbor, Ipv4Address local, Time latency)
+{
+  // With shared neighbor sensing AODV already hears of the link through
+  // NeighborChanged.
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv != 0 && !m_sharedNeighborSensing)
+    {
+      saodv->NeighborDown (neighbor, local);
+    }
+}
+
+void
+SallyRouting::SolsrRoutingTableChanged (uint32_t size)
+{
+  m_routeCache.Invalidate ();
+  ScheduleRelease ();
+}
+
+void
+SallyRouting::AodvRoutingTableChanged (void)
+{
+  m_routeCache.Invalidate ();
+}
+
+void
+SallyRouting::AodvRreqSent (Ipv4Address dst)
+{
+  m_rreqsSinceTransition++;
+}
+
+void
+SallyRouting::AodvControlReceived (uint32_t size)
+{
+  // The Rx trace fires before AODV handles the message; an RREP has
+  // installed its route by the time the release runs.
+  ScheduleRelease ();
+}
+
+void
+SallyRouting::MprSelectorsChanged (uint32_t count)
+{
+  m_mprSelectorCount = count;
+  EvaluateMode ();
+}
+
+void
+SallyRouting::EvaluateMode (void)
+{
+  bool useAodv = m_useAodv ? m_mprSelectorCount > m_modeExitThreshold
+                           : m_mprSelectorCount >= m_modeEnterThreshold;
+  if (useAodv == m_useAodv)
+    {
+      return;
+    }
+  Time dwellEnd = m_lastModeTransition + m_modeDwell;
+  if (m_modeTransitions > 0 && Simulator::Now () < dwellEnd)
+    {
+      // Too early to switch back; look again once the dwell time is over.
+      if (!m_modeDwellTimer.IsRunning ())
+        {
+          m_modeDwellTimer.Schedule (dwellEnd - Simulator::Now ());
+        }
+      return;
+    }
+  SwitchMode (useAodv);
+}
+
+void
+SallyRouting::SwitchMode (bool useAodv)
+{
+  Time now = Simulator::Now ();
+  Time spent = now - m_lastModeTransition;
+  NS_LOG_DEBUG ((useAodv ? "Entering" : "Leaving") << " AODV mode, " << m_mprSelectorCount
+                << " MPR selectors, " << m_rreqsSinceTransition << " RREQs in the previous mode");
+
+  // Exponential back-off: a node that keeps flapping has to stay longer
+  // in each mode, one that settled down starts again from the minimum.
+  // Doubling a zero dwell, the default minimum, would never engage it.
+  if (m_modeTransitions > 0 && spent < m_modeDwell + m_modeBackoffWindow)
+    {
+      Time doubled = m_modeDwell.IsZero () ? m_modeBackoffWindow : m_modeDwell + m_modeDwell;
+      m_modeDwell = std::min (std::max (doubled, m_modeMinDwell), m_modeMaxDwell);
+    }
+  else
+    {
+      m_modeDwell = m_modeMinDwell;
+    }
+
+  m_modeTransitionCostTrace (m_useAodv, m_rreqsSinceTransition, spent);
+  m_rreqsSinceTransition = 0;
+  m_modeDwellTimer.Cancel ();
+
+  m_useAodv = useAodv;
+  // Cached routes were resolved with the other set of protocols.
+  m_routeCache.Invalidate ();
+  m_modeTransitions++;
+  m_lastModeTransition = now;
+  if (useAodv)
+    {
+      SeedAodvRoutes ();
+    }
+  ScheduleRelease ();
+  m_modeChangeTrace (useAodv);
+}
+
+void
+SallyRouting::SeedAodvRoutes (void)
+{
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (!m_seedAodvRoutes || saodv == 0 || m_solsr == 0)
+    {
+      return;
+    }
+  std::vector<olsr::RoutingTableEntry> entries = m_solsr->GetRoutingTableEntries ();
+  for (std::vector<olsr::RoutingTableEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      saodv->SeedRoute (i->destAddr, i->nextAddr, i->interface, i->distance);
+    }
+}
+
+bool
+SallyRouting::IsAodvMode (void) const
+{
+  return m_useAodv;
+}
+
+Time
+SallyRouting::GetModeDwellTime (void) const
+{
+  return m_modeDwell;
+}
+
+uint32_t
+SallyRouting::GetModeTransitions (void) const
+{
+  return m_modeTransitions;
+}
+
+Time
+SallyRouting::GetLastModeTransition (void) const
+{
+  return m_lastModeTransition;
+}
+
+void
+SallyRouting::SetRouteCacheSize (uint32_t size)
+{
+  m_routeCache.Resize (size);
+}
+
+uint32_t
+SallyRouting::GetRouteCacheSize (void) const
+{
+  return m_routeCache.GetCapacity ();
+}
+
+uint32_t
+SallyRouting::GetRouteCacheHits (void) const
+{
+  return m_routeCache.GetHits ();
+}
+
+uint32_t
+SallyRouting::GetRouteCacheMisses (void) const
+{
+  return m_routeCache.GetMisses ();
+}
+
+const SallyNeighborSensing &
+SallyRouting::GetNeighborSensing (void) const
+{
+  return m_neighborSensing;
+}
+
+void
+SallyRouting::SetDeferralQueueSize (uint32_t size)
+{
+  m_deferral.SetCapacity (size);
+}
+
+uint32_t
+SallyRouting::GetDeferralQueueSize (void) const
+{
+  return m_deferral.GetCapacity ();
+}
+
+void
+SallyRouting::SetDeferralPerDestination (uint32_t limit)
+{
+  m_deferral.SetPerDestinationLimit (limit);
+}
+
+uint32_t
+SallyRouting::GetDeferralPerDestination (void) const
+{
+  return m_deferral.GetPerDestinationLimit ();
+}
+
+void
+SallyRouting::SetDeferralTimeout (Time timeout)
+{
+  m_deferral.SetTimeout (timeout);
+}
+
+Time
+SallyRouting::GetDeferralTimeout (void) const
+{
+  return m_deferral.GetTimeout ();
+}
+
+const SallyDeferralQueue &
+SallyRouting::GetDeferralQueue (void) const
+{
+  return m_deferral;
+}
+
+uint32_t
+SallyRouting::GetDeferredPackets (void) const
+{
+  return m_deferral.GetEnqueued ();
+}
+
+uint32_t
+SallyRouting::GetDeferredReleased (void) const
+{
+  return m_deferral.GetReleased ();
+}
+
+uint32_t
+SallyRouting::GetDeferralDrops (void) const
+{
+  return m_deferral.GetDropsFull () + m_deferral.GetDropsLimit () + m_deferral.GetDropsTimeout ();
+}
+
+uint32_t
+SallyRouting::GetDiscoveryBatches (void) const
+{
+  return m_discoveryBatches;
+}
+
+uint32_t
+SallyRouting::GetRreqsCoalesced (void) const
+{
+  return m_rreqsCoalesced;
+}
+
+uint32_t
+SallyRouting::GetDiscoveryRetries (void) const
+{
+  return m_discoveryRetries;
+}
+
+void
+SallyRouting::SetNegativeCacheBackoff (Time backoff)
+{
+  m_negativeCache.SetBackoff (backoff, m_negativeCache.GetMaxBackoff ());
+}
+
+Time
+SallyRouting::GetNegativeCacheBackoff (void) const
+{
+  return m_negativeCache.GetInitialBackoff ();
+}
+
+void
+SallyRouting::SetNegativeCacheMaxBackoff (Time backoff)
+{
+  m_negativeCache.SetBackoff (m_negativeCache.GetInitialBackoff (), backoff);
+}
+
+Time
+SallyRouting::GetNegativeCacheMaxBackoff (void) const
+{
+  return m_negativeCache.GetMaxBackoff ();
+}
+
+const SallyNegativeCache &
+SallyRouting::GetNegativeCache (void) const
+{
+  return m_negativeCache;
+}
+
+uint32_t
+SallyRouting::GetRreqsSuppressed (void) const
+{
+  return m_rreqsSuppressed;
+}
+
+uint32_t
+SallyRouting::GetLateRoutes (void) const
+{
+  return m_lateRoutes;
+}
+
+void
+SallyRouting::SetControlAggregationWindow (Time window)
+{
+  m_aggregator.SetWindow (window);
+  ConnectAggregator ();
+}
+
+Time
+SallyRouting::GetControlAggregationWindow (void) const
+{
+  return m_aggregator.GetWindow ();
+}
+
+uint32_t
+SallyRouting::GetControlContainers (void) const
+{
+  return m_aggregator.GetContainersSent ();
+}
+
+uint32_t
+SallyRouting::GetControlMessagesAggregated (void) const
+{
+  return m_aggregator.GetMessagesAggregated ();
+}
+
+bool
+SallyRouting::CanDefer (const Ipv4Header &header) const
+{
+  if (m_deferral.GetCapacity () == 0)
+    {
+      return false;
+    }
+  Ipv4Address dst = header.GetDestination ();
+  return !dst.IsBroadcast () && !dst.IsMulticast ();
+}
+
+Ptr<Ipv4Route>
+SallyRouting::LoopbackRoute (const Ipv4Header &header, Ptr<NetDevice> oif) const
+{
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (header.GetDestination ());
+  // Use the address of the requested interface, or else of the first
+  // non-loopback one, as source.
+  for (uint32_t i = 1; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      if (m_ipv4->GetNAddresses (i) > 0 && (oif == 0 || m_ipv4->GetNetDevice (i) == oif))
+        {
+          route->SetSource (m_ipv4->GetAddress (i, 0).GetLocal ());
+          break;
+        }
+    }
+  route->SetGateway (Ipv4Address ("127.0.0.1"));
+  route->SetOutputDevice (m_ipv4->GetNetDevice (0));
+  return route;
+}
+
+Ptr<Ipv4Route>
+SallyRouting::FindDeferredRoute (Ipv4Address dst)
+{
+  Ipv4Header header;
+  header.SetDestination (dst);
+  if (m_solsr != 0)
+    {
+      Socket::SocketErrno sockerr;
+      Ptr<Ipv4Route> route = m_solsr->RouteOutput (0, header, 0, sockerr);
+      if (route)
+        {
+          return route;
+        }
+    }
+  return FindAodvRoute (dst);
+}
+
+Ptr<Ipv4Route>
+SallyRouting::FindAodvRoute (Ipv4Address dst)
+{
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv == 0)
+    {
+      return 0;
+    }
+  return saodv->LookupValidRoute (dst);
+}
+
+bool
+SallyRouting::Defer (Ptr<const Packet> p, const Ipv4Header &header, UnicastForwardCallback ucb, ErrorCallback ecb)
+{
+  Ipv4Address dst = header.GetDestination ();
+  Ptr<Ipv4Route> route = FindDeferredRoute (dst);
+  if (route)
+    {
+      if (m_negativeCache.Remove (dst))
+        {
+          m_lateRoutes++;
+        }
+      ucb (route, p, header);
+      return true;
+    }
+  bool waiting = m_deferral.GetSize (dst) > 0;
+  // A refused packet is reported as unroutable by Ipv4L3Protocol.
+  if (!m_deferral.Enqueue (p, header, ucb, ecb))
+    {
+      return false;
+    }
+  NS_LOG_LOGIC ("Deferred packet to " << dst << ", " << m_deferral.GetSize (dst) << " waiting");
+  if (m_negativeCache.IsSuppressed (dst, Simulator::Now ()))
+    {
+      // Flooding again for a destination that just proved unreachable is
+      // wasted; the packet only leaves if a route shows up on its own.
+      if (!waiting)
+        {
+          NS_LOG_LOGIC ("Discovery for " << dst << " failed recently, not starting another");
+          m_rreqsSuppressed++;
+        }
+    }
+  // Packets to the same destination share one discovery.
+  else if (waiting)
+    {
+      m_rreqsCoalesced++;
+    }
+  else
+    {
+      RequestDiscovery (dst);
+    }
+  ScheduleDeferralTimer ();
+  return true;
+}
+
+void
+SallyRouting::RequestDiscovery (Ipv4Address dst)
+{
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv == 0)
+    {
+      return;
+    }
+  if (m_discoveryBatchWindow.IsZero ())
+    {
+      saodv->RequestRoute (dst);
+      return;
+    }
+  if (std::find (m_discoveryBatch.begin (), m_discoveryBatch.end (), dst) == m_discoveryBatch.end ())
+    {
+      m_discoveryBatch.push_back (dst);
+    }
+  if (!m_discoveryBatchEvent.IsRunning ())
+    {
+      m_discoveryBatchEvent = Simulator::Schedule (m_discoveryBatchWindow, &SallyRouting::FlushDiscoveries, this);
+    }
+}
+
+void
+SallyRouting::FlushDiscoveries (void)
+{
+  std::vector<Ipv4Address> batch;
+  batch.swap (m_discoveryBatch);
+  Ptr<sally::SAodvRoutingProtocol> saodv = DynamicCast<sally::SAodvRoutingProtocol> (m_aodv);
+  if (saodv == 0)
+    {
+      return;
+    }
+  // Skip the destinations a route showed up for during the window.
+  std::vector<Ipv4Address> dsts;
+  for (std::vector<Ipv4Address>::const_iterator i = batch.begin (); i != batch.end (); i++)
+    {
+      if (m_deferral.GetSize (*i) > 0)
+        {
+          dsts.push_back (*i);
+        }
+    }
+  if (dsts.size () > 1)
+    {
+      NS_LOG_LOGIC ("One RREQ for " << dsts.size () << " destinations");
+      m_discoveryBatches++;
+    }
+  if (!dsts.empty ())
+    {
+      saodv->RequestRoutes (dsts);
+    }
+}
+
+void
+SallyRouting::RetryDiscovery (Ipv4Address dst)
+{
+  // Whatever was queued before or during the suppression still has no
+  // route, or it would have been released.
+  if (m_deferral.GetSize (dst) == 0 || m_negativeCache.IsSuppressed (dst, Simulator::Now ()))
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Looking again for " << dst << ", " << m_deferral.GetSize (dst) << " packets waiting");
+  m_discoveryRetries++;
+  RequestDiscovery (dst);
+}
+
+void
+SallyRouting::ScheduleRelease (void)
+{
+  if ((!m_deferral.IsEmpty () || !m_negativeCache.IsEmpty ()) && !m_releaseEvent.IsRunning ())
+    {
+      m_releaseEvent = Simulator::ScheduleNow (&SallyRouting::ReleaseDeferred, this);
+    }
+}
+
+void
+SallyRouting::ReleaseDeferred (void)
+{
+  std::vector<Ipv4Address> destinations = m_deferral.GetDestinations ();
+  for (std::vector<Ipv4Address>::const_iterator i = destinations.begin (); i != destinations.end (); i++)
+    {
+      Ptr<Ipv4Route> route = FindDeferredRoute (*i);
+      if (route)
+        {
+          m_deferral.Release (*i, route);
+        }
+    }
+  ReviewNegativeCache ();
+  ScheduleDeferralTimer ();
+}
+
+void
+SallyRouting::ReviewNegativeCache (void)
+{
+  m_negativeCache.Purge (Simulator::Now ());
+  std::vector<Ipv4Address> destinations = m_negativeCache.GetDestinations ();
+  for (std::vector<Ipv4Address>::const_iterator i = destinations.begin (); i != destinations.end (); i++)
+    {
+      if (FindDeferredRoute (*i))
+        {
+          NS_LOG_LOGIC ("Route to " << *i << " appeared after its discovery failed");
+          m_negativeCache.Remove (*i);
+          m_lateRoutes++;
+        }
+    }
+}
+
+void
+SallyRouting::ScheduleDeferralTimer (void)
+{
+  if (m_deferral.IsEmpty ())
+    {
+      m_deferralTimer.Cancel ();
+    }
+  else if (!m_deferralTimer.IsRunning ())
+    {
+      m_deferralTimer.Schedule (m_deferral.GetNextExpiry () - Simulator::Now ());
+    }
+}
+
+void
+SallyRouting::DeferralTimerExpire (void)
+{
+  Time now = Simulator::Now ();
+  if (DynamicCast<sally::SAodvRoutingProtocol> (m_aodv) == 0)
+    {
+      m_deferral.DropExpired (now);
+      ScheduleDeferralTimer ();
+      return;
+    }
+  // A packet that timed out waited a full timeout without a route: the
+  // discovery for its destination failed, and AODV gave up on it.
+  std::vector<Ipv4Address> destinations = m_deferral.GetDestinations ();
+  std::vector<uint32_t> sizes;
+  sizes.reserve (destinations.size ());
+  for (std::vector<Ipv4Address>::const_iterator i = destinations.begin (); i != destinations.end (); i++)
+    {
+      sizes.push_back (m_deferral.GetSize (*i));
+    }
+  m_deferral.DropExpired (now);
+  for (uint32_t i = 0; i < destinations.size (); i++)
+    {
+      // Packets queued while the destination was suppressed saw no discovery.
+      if (m_deferral.GetSize (destinations[i]) == sizes[i]
+          || m_negativeCache.IsSuppressed (destinations[i], now))
+        {
+          continue;
+        }
+      // The packets left, and those deferred during the back-off, need
+      // a discovery of their own once it is over.
+      Time backoff = m_negativeCache.DiscoveryFailed (destinations[i], now);
+      if (backoff.IsZero ())
+        {
+          RetryDiscovery (destinations[i]);
+        }
+      else
+        {
+          Simulator::Schedule (backoff, &SallyRouting::RetryDiscovery, this, destinations[i]);
+        }
+    }
+  ScheduleDeferralTimer ();
+}
+
+void
+SallyRouting::NotifyInterfaceUp (uint32_t interface)
+{
+  Ipv4ListRouting::NotifyInterfaceUp (interface);
+  m_aggregator.NotifyInterfaceUp (interface);
+  m_routeCache.Invalidate ();
+}
+
+void
+SallyRouting::NotifyInterfaceDown (uint32_t interface)
+{
+  Ipv4ListRouting::NotifyInterfaceDown (interface);
+  m_aggregator.NotifyInterfaceDown (interface);
+  m_routeCache.Invalidate ();
+}
+
+void
+SallyRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  Ipv4ListRouting::SetIpv4 (ipv4);
+  m_aggregator.SetIpv4 (ipv4);
+  // Opens the sockets of the interfaces that are already up.
+  m_aggregator.SetWindow (m_aggregator.GetWindow ());
+}
+
+void
+SallyRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  Ipv4ListRouting::NotifyAddAddress (interface, address);
+  m_routeCache.Invalidate ();
+}
+
+void
+SallyRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  Ipv4ListRouting::NotifyRemoveAddress (interface, address);
+  m_routeCache.Invalidate ();
+}
+
 Ptr<Ipv4Route>
 SallyRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, enum Socket::SocketErrno &sockerr)
 {
   NS_LOG_FUNCTION (this << p << header.GetDestination () << header.GetSource () << oif << sockerr);
   Ptr<Ipv4Route> route;
+  Ipv4Address dst = header.GetDestination ();
+  bool probed = false;
 
-  bool useAodv = false;
-
-  for (Ipv4RoutingProtocolList::const_iterator i = m_routingProtocols.begin ();
-       i != m_routingProtocols.end (); i++)
+  for (ProtocolTable::const_iterator i = m_protocolTable.begin ();
+       i != m_protocolTable.end (); i++)
     {
-	  if ((*i).second->GetInstanceTypeId ().GetName() == "ns3::sally::SOlsrRoutingProtocol") {
-		  Ptr<sally::SOlsrRoutingProtocol> olsr_prot = DynamicCast<sally::SOlsrRoutingProtocol> ((*i).second);
-		  useAodv = olsr_prot->m_state.GetMprSelectors ().size () > 0;
-	  }
-	  if ((*i).second->GetInstanceTypeId ().GetName() == "ns3::aodv::RoutingProtocol" && !useAodv) {
-		  continue;
-	  }
-      NS_LOG_LOGIC ("Checking protocol " << (*i).second->GetInstanceTypeId () << " with priority " << (*i).first);
-      NS_LOG_LOGIC ("Requesting source address for destination " << header.GetDestination ());
-      route = (*i).second->RouteOutput (p, header, oif, sockerr);
+      if (i->kind == AODV && !m_useAodv)
+        {
+          continue;
+        }
+      // The cache answers for SOLSR and AODV together, in place of the
+      // first of them.  A cached AODV route means SOLSR had none; it is
+      // refreshed as AODV's own RouteOutput would, or a flow using it
+      // would see it expire.
+      if (!probed && (i->kind == SOLSR || i->kind == AODV))
+        {
+          probed = true;
+          uint8_t owner;
+          route = m_routeCache.Lookup (dst, oif, owner);
+          if (route && (owner != AODV || m_saodv->RefreshRoute (dst, route->GetGateway ())))
+            {
+              NS_LOG_LOGIC ("Found cached route " << route);
+              sockerr = Socket::ERROR_NOTERROR;
+              return route;
+            }
+        }
+      NS_LOG_LOGIC ("Checking protocol " << i->protocol->GetInstanceTypeId () << " with priority " << i->priority);
+      NS_LOG_LOGIC ("Requesting source address for destination " << dst);
+      if (i->kind == AODV && CanDefer (header))
+        {
+          // Without a valid AODV route the packet waits in our own queue,
+          // where discoveries are coalesced, rather than in AODV's.
+          route = 0;
+          if (m_saodv != 0)
+            {
+              route = m_saodv->UseValidRoute (dst, oif);
+            }
+        }
+      else
+        {
+          route = i->protocol->RouteOutput (p, header, oif, sockerr);
+        }
       if (route)
         {
           NS_LOG_LOGIC ("Found route " << route);
+          // Only SAODV reports its route changes, and AODV answers with a
+          // loopback route while it looks for one.
+          if (i->kind == SOLSR
+              || (i->kind == AODV && m_saodv != 0 && route->GetOutputDevice () != m_ipv4->GetNetDevice (0)))
+            {
+              m_routeCache.Insert (dst, oif, route, i->kind);
+            }
           sockerr = Socket::ERROR_NOTERROR;
           return route;
         }
     }
   NS_LOG_LOGIC ("Done checking " << GetTypeId ());
   NS_LOG_LOGIC ("");
+  if (CanDefer (header))
+    {
+      // Like AODV, send the packet to ourselves; RouteInput queues it.
+      if (p != 0)
+        {
+          SallyDeferredTag tag;
+          if (!p->PeekPacketTag (tag))
+            {
+              p->AddPacketTag (tag);
+            }
+        }
+      sockerr = Socket::ERROR_NOTERROR;
+      return LoopbackRoute (header, oif);
+    }
   sockerr = Socket::ERROR_NOROUTETOHOST;
   return 0;
 }
@@ -90,6 +1187,14 @@ SallyRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<con
   NS_ASSERT (m_ipv4->GetInterfaceForDevice (idev) >= 0);
   uint32_t iif = m_ipv4->GetInterfaceForDevice (idev);
 
+  SallyDeferredTag tag;
+  if (idev == m_ipv4->GetNetDevice (0) && p->PeekPacketTag (tag))
+    {
+      Ptr<Packet> packet = p->Copy ();
+      packet->RemovePacketTag (tag);
+      return Defer (packet, header, ucb, ecb);
+    }
+
   retVal = m_ipv4->IsDestinationAddress (header.GetDestination (), iif);
   if (retVal == true)
     {
@@ -122,27 +1227,60 @@ SallyRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<con
     {
       downstreamLcb = MakeNullCallback<void, Ptr<const Packet>, const Ipv4Header &, uint32_t > ();
     }
-  bool useAodv = false;
-  for (Ipv4RoutingProtocolList::const_iterator rprotoIter =
-         m_routingProtocols.begin ();
-       rprotoIter != m_routingProtocols.end ();
+  for (ProtocolTable::const_iterator rprotoIter = m_protocolTable.begin ();
+       rprotoIter != m_protocolTable.end ();
        rprotoIter++)
     {
-	  if ((*rprotoIter).second->GetInstanceTypeId ().GetName() == "ns3::sally::SOlsrRoutingProtocol") {
-		  Ptr<sally::SOlsrRoutingProtocol> olsr_prot = DynamicCast<sally::SOlsrRoutingProtocol> ((*rprotoIter).second);
-		  useAodv = olsr_prot->m_state.GetMprSelectors ().size () > 0;
-	  }
-	  if ((*rprotoIter).second->GetInstanceTypeId ().GetName() == "ns3::aodv::RoutingProtocol" && !useAodv) {
-		  continue;
-	  }
+      if (rprotoIter->kind == AODV && !m_useAodv)
+        {
+          continue;
+        }
+      // Shortcut for SOLSR's RouteInput: a forwarded packet takes the
+      // cached route, or else the route SOLSR gives a local sender, which
+      // has the same next hop SOLSR's RouteInput would pick.  SOLSR's
+      // RouteInput itself only runs when SOLSR has no route, so input
+      // handling added there does not apply to the packets forwarded
+      // here.  SOLSR consumes packets we originated ourselves, so those
+      // are left to it.
+      if (rprotoIter->kind == SOLSR && m_ipv4->GetInterfaceForAddress (header.GetSource ()) < 0)
+        {
+          uint8_t owner = SOLSR;
+          Ptr<Ipv4Route> route = m_routeCache.Lookup (header.GetDestination (), 0, owner);
+          if (route != 0 && owner != SOLSR)
+            {
+              // SOLSR had no route when AODV's was cached; AODV forwards
+              // the packet itself so that its route stays alive.
+              continue;
+            }
+          if (route == 0)
+            {
+              Socket::SocketErrno sockerr;
+              route = rprotoIter->protocol->RouteOutput (0, header, 0, sockerr);
+              if (route)
+                {
+                  m_routeCache.Insert (header.GetDestination (), 0, route, SOLSR);
+                }
+            }
+          if (route)
+            {
+              NS_LOG_LOGIC ("Forwarding packet along cached route " << route);
+              ucb (route, p, header);
+              return true;
+            }
+        }
 
-      if ((*rprotoIter).second->RouteInput (p, header, idev, ucb, mcb, downstreamLcb, ecb))
+      if (rprotoIter->protocol->RouteInput (p, header, idev, ucb, mcb, downstreamLcb, ecb))
         {
-          NS_LOG_LOGIC ("Route found to forward packet in protocol " << (*rprotoIter).second->GetInstanceTypeId ().GetName ());
+          NS_LOG_LOGIC ("Route found to forward packet in protocol " << rprotoIter->protocol->GetInstanceTypeId ().GetName ());
           return true;
         }
     }
   // No routing protocol has found a route.
+  // In AODV mode AODV has already answered with an RERR.
+  if (!retVal && (!m_useAodv || m_aodv == 0) && CanDefer (header))
+    {
+      return Defer (p, header, ucb, ecb);
+    }
   return retVal;
 }
 
@@ -20,11 +20,29 @@
 #define SALLY_ROUTING_H
 
 #include <list>
+#include <vector>
 #include "ns3/ipv4-list-routing.h"
 #include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "ns3/timer.h"
+#include "ns3/event-id.h"
+#include "sally-route-cache.h"
+#include "sally-neighbor-sensing.h"
+#include "sally-deferral-queue.h"
+#include "sally-negative-cache.h"
+#include "sally-control-aggregator.h"
 
 namespace ns3 {
 
+namespace sally {
+class SOlsrRoutingProtocol;
+class SAodvRoutingProtocol;
+}
+namespace aodv {
+class RoutingProtocol;
+}
+
 /**
  * \ingroup internet
  * \defgroup ipv4ListRouting Ipv4 List Routing
@@ -46,6 +64,83 @@ class SallyRouting : public Ipv4ListRouting
 {
 public:
   static TypeId GetTypeId (void);
+  SallyRouting ();
+
+  /// Kind of a registered routing protocol, resolved once when it is added.
+  enum ProtocolKind
+  {
+    SOLSR,
+    AODV,
+    STATIC,
+    OTHER
+  };
+
+  /**
+   * \brief Register a new routing protocol and classify it.
+   *
+   * The protocol is handed to Ipv4ListRouting as usual; the priority-ordered
+   * dispatch table used on the forwarding path is then rebuilt so that
+   * RouteOutput and RouteInput never have to inspect TypeIds per packet.
+   */
+  virtual void AddRoutingProtocol (Ptr<Ipv4RoutingProtocol> routingProtocol, int16_t priority);
+
+  /// \returns true if AODV is currently consulted on this node
+  bool IsAodvMode (void) const;
+  /// \returns the number of OLSR/AODV mode transitions so far
+  uint32_t GetModeTransitions (void) const;
+  /// \returns the time of the last mode transition
+  Time GetLastModeTransition (void) const;
+  /// \returns the dwell time currently enforced after a transition
+  Time GetModeDwellTime (void) const;
+
+  void SetRouteCacheSize (uint32_t size);
+  uint32_t GetRouteCacheSize (void) const;
+  /// \returns the number of lookups answered by the forwarding cache
+  uint32_t GetRouteCacheHits (void) const;
+  /// \returns the number of lookups that missed the forwarding cache
+  uint32_t GetRouteCacheMisses (void) const;
+
+  /// \returns the neighbor table shared by SOLSR and AODV
+  const SallyNeighborSensing & GetNeighborSensing (void) const;
+
+  void SetDeferralQueueSize (uint32_t size);
+  uint32_t GetDeferralQueueSize (void) const;
+  void SetDeferralPerDestination (uint32_t limit);
+  uint32_t GetDeferralPerDestination (void) const;
+  void SetDeferralTimeout (Time timeout);
+  Time GetDeferralTimeout (void) const;
+  /// \returns the queue of packets waiting for a route
+  const SallyDeferralQueue & GetDeferralQueue (void) const;
+  /// \returns the number of packets that had to wait for a route
+  uint32_t GetDeferredPackets (void) const;
+  /// \returns the number of deferred packets sent once a route appeared
+  uint32_t GetDeferredReleased (void) const;
+  /// \returns the number of packets the deferral queue refused or timed out
+  uint32_t GetDeferralDrops (void) const;
+  /// \returns the number of deferred packets that joined a discovery already under way
+  uint32_t GetRreqsCoalesced (void) const;
+  /// \returns the number of RREQs that looked for several destinations
+  uint32_t GetDiscoveryBatches (void) const;
+  /// \returns the number of discoveries started again after one failed
+  uint32_t GetDiscoveryRetries (void) const;
+
+  void SetNegativeCacheBackoff (Time backoff);
+  Time GetNegativeCacheBackoff (void) const;
+  void SetNegativeCacheMaxBackoff (Time backoff);
+  Time GetNegativeCacheMaxBackoff (void) const;
+  /// \returns the destinations whose discovery recently failed
+  const SallyNegativeCache & GetNegativeCache (void) const;
+  /// \returns the number of discoveries not started for recently unreachable destinations
+  uint32_t GetRreqsSuppressed (void) const;
+  /// \returns the number of routes that appeared to destinations after their discovery failed
+  uint32_t GetLateRoutes (void) const;
+
+  void SetControlAggregationWindow (Time window);
+  Time GetControlAggregationWindow (void) const;
+  /// \returns the number of datagrams that carried aggregated control messages
+  uint32_t GetControlContainers (void) const;
+  /// \returns the number of control messages sent inside those datagrams
+  uint32_t GetControlMessagesAggregated (void) const;
 
   // Below are from Ipv4RoutingProtocol
   virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
@@ -53,6 +148,143 @@ public:
   virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
                            UnicastForwardCallback ucb, MulticastForwardCallback mcb,
                            LocalDeliverCallback lcb, ErrorCallback ecb);
+  virtual void NotifyInterfaceUp (uint32_t interface);
+  virtual void NotifyInterfaceDown (uint32_t interface);
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+  virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+
+protected:
+  void DoDispose (void);
+  void DoInitialize (void);
+
+private:
+  /// One slot of the flat dispatch table.
+  struct ProtocolSlot
+  {
+    Ptr<Ipv4RoutingProtocol> protocol;
+    int16_t priority;
+    ProtocolKind kind;
+  };
+  typedef std::vector<ProtocolSlot> ProtocolTable;
+
+  static ProtocolKind Classify (Ptr<Ipv4RoutingProtocol> protocol);
+  void RebuildProtocolTable (void);
+  void AttachSolsr (Ptr<sally::SOlsrRoutingProtocol> solsr);
+  void AttachAodv (Ptr<aodv::RoutingProtocol> aodv);
+  /// Attached to the SOLSR MprSelectorsChanged trace source.
+  void MprSelectorsChanged (uint32_t count);
+  /// Attached to the SOLSR RoutingTableChanged trace source.
+  void SolsrRoutingTableChanged (uint32_t size);
+  /// Called by SAODV whenever one of its routes changes.
+  void AodvRoutingTableChanged (void);
+  /// Attached to the AODV RreqTx trace source.
+  void AodvRreqSent (Ipv4Address dst);
+  /// Attached to the SOLSR NeighborChanged trace source.
+  void SolsrNeighborChanged (Ipv4Address neighbor, Ipv4Address local, bool up);
+  /// Attached to the SOLSR LinkBreakDetected trace source.
+  void SolsrLinkBroken (Ipv4Address neighbor, Ipv4Address local, Time latency);
+  /// Hands SOLSR neighbor state to the AODV instance, if both are present.
+  void ConnectAodvToSolsr (void);
+  /// Routes the broadcasts of SOLSR and AODV through the aggregator while it is enabled.
+  void ConnectAggregator (void);
+  /// Mirrors the SOLSR routing table into the AODV routing table.
+  void SeedAodvRoutes (void);
+  /// Attached to the AODV Rx trace source.
+  void AodvControlReceived (uint32_t size);
+
+  ///\name Deferred routing
+  //\{
+  /// \returns true if a packet to this destination that has no route may wait for one
+  bool CanDefer (const Ipv4Header &header) const;
+  /// Route a local packet back to ourselves so it can be queued in RouteInput.
+  Ptr<Ipv4Route> LoopbackRoute (const Ipv4Header &header, Ptr<NetDevice> oif) const;
+  /// Forward \p p now if a route appeared, else queue it and start a
+  /// discovery unless its destination is in the negative cache.
+  bool Defer (Ptr<const Packet> p, const Ipv4Header &header, UnicastForwardCallback ucb, ErrorCallback ecb);
+  /// \returns a route to \p dst from SOLSR or AODV, or 0
+  Ptr<Ipv4Route> FindDeferredRoute (Ipv4Address dst);
+  /// \returns the valid AODV route to \p dst, or 0
+  Ptr<Ipv4Route> FindAodvRoute (Ipv4Address dst);
+  /// Start an AODV route discovery for \p dst, together with the others
+  /// needed within the batch window.
+  void RequestDiscovery (Ipv4Address dst);
+  /// Start one discovery for the destinations batched that still have packets queued.
+  void FlushDiscoveries (void);
+  /// Start a discovery for \p dst again if packets to it are still queued.
+  void RetryDiscovery (Ipv4Address dst);
+  /// Look for routes to the queued destinations once the current event is done.
+  void ScheduleRelease (void);
+  void ReleaseDeferred (void);
+  void ScheduleDeferralTimer (void);
+  void DeferralTimerExpire (void);
+  /// Forget the failed destinations a route appeared to.
+  void ReviewNegativeCache (void);
+  //\}
+  /// Apply the switching policy to the last reported selector count.
+  void EvaluateMode (void);
+  void SwitchMode (bool useAodv);
+
+  ProtocolTable m_protocolTable;
+  Ptr<sally::SOlsrRoutingProtocol> m_solsr;
+  Ptr<aodv::RoutingProtocol> m_aodv;
+  /// m_aodv if it is the AODV half of SALLY, whose routes may be cached.
+  Ptr<sally::SAodvRoutingProtocol> m_saodv;
+  /// Cached mode bit: AODV is consulted only while we have MPR selectors,
+  /// or always on nodes without SOLSR.
+  bool m_useAodv;
+  uint32_t m_mprSelectorCount;
+  uint32_t m_modeTransitions;
+  Time m_lastModeTransition;
+  /// Reports every mode transition with the new value of the mode bit.
+  TracedCallback<bool> m_modeChangeTrace;
+
+  ///\name Mode switching policy
+  //\{
+  /// Selector count at or above which AODV mode is entered.
+  uint32_t m_modeEnterThreshold;
+  /// Selector count at or below which AODV mode is left.
+  uint32_t m_modeExitThreshold;
+  Time m_modeMinDwell;
+  Time m_modeMaxDwell;
+  /// Transitions closer together than this double the dwell time.
+  Time m_modeBackoffWindow;
+  /// Dwell time enforced after the last transition.
+  Time m_modeDwell;
+  Timer m_modeDwellTimer;
+  /// RREQs originated since the last transition.
+  uint32_t m_rreqsSinceTransition;
+  /// Reports, for the mode being left, the RREQs it cost and how long it lasted.
+  TracedCallback<bool, uint32_t, Time> m_modeTransitionCostTrace;
+  //\}
+  /// Routes resolved by SOLSR or SAODV, tagged with their ProtocolKind and
+  /// valid until either routing table changes or the mode switches.
+  SallyRouteCache m_routeCache;
+  /// AODV takes its neighbors from the SOLSR link set instead of HELLOs.
+  bool m_sharedNeighborSensing;
+  SallyNeighborSensing m_neighborSensing;
+  /// Seed AODV with the SOLSR routes whenever AODV mode is entered.
+  bool m_seedAodvRoutes;
+  /// Repair broken AODV routes from the SOLSR state before sending RERRs.
+  bool m_localRepair;
+  /// Packets without a route wait here instead of being dropped.
+  SallyDeferralQueue m_deferral;
+  /// Drops the deferred packets whose timeout expired.
+  Timer m_deferralTimer;
+  EventId m_releaseEvent;
+  /// Destinations waiting for the batch window to close.
+  std::vector<Ipv4Address> m_discoveryBatch;
+  Time m_discoveryBatchWindow;
+  EventId m_discoveryBatchEvent;
+  uint32_t m_discoveryBatches;
+  uint32_t m_rreqsCoalesced;
+  uint32_t m_discoveryRetries;
+  /// Destinations not worth another discovery for now.
+  SallyNegativeCache m_negativeCache;
+  uint32_t m_rreqsSuppressed;
+  uint32_t m_lateRoutes;
+  /// Packs SOLSR and AODV broadcasts into shared datagrams.
+  SallyControlAggregator m_aggregator;
 };
 
 } // namespace ns3
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/assert.h"
+#include "sally-timing-wheel.h"
+#include <algorithm>
+
+namespace ns3 {
+
+SallyTimingWheel::SallyTimingWheel ()
+  : m_nextSlot (0),
+    m_size (0)
+{
+  SetSpan (Seconds (30), Seconds (1));
+}
+
+void
+SallyTimingWheel::SetSpan (Time span, Time resolution)
+{
+  NS_ASSERT (resolution.IsStrictlyPositive ());
+  m_resolution = resolution;
+  m_slots.assign (span.GetInteger () / resolution.GetInteger () + 2, std::vector<Key> ());
+  Clear ();
+}
+
+Time
+SallyTimingWheel::GetResolution (void) const
+{
+  return m_resolution;
+}
+
+int64_t
+SallyTimingWheel::SlotOf (Time t) const
+{
+  return t.GetInteger () / m_resolution.GetInteger ();
+}
+
+void
+SallyTimingWheel::Schedule (const Key &key, Time deadline)
+{
+  int64_t last = m_nextSlot + m_slots.size () - 1;
+  int64_t slot = std::min (std::max (SlotOf (deadline), m_nextSlot), last);
+  m_slots[slot % m_slots.size ()].push_back (key);
+  m_size++;
+}
+
+void
+SallyTimingWheel::Advance (Time now, std::vector<Key> &due)
+{
+  int64_t current = SlotOf (now);
+  if (current - m_nextSlot > (int64_t) m_slots.size ())
+    {
+      // Idle for a whole turn: every slot is due once.
+      m_nextSlot = current - m_slots.size ();
+    }
+  for (; m_nextSlot < current; m_nextSlot++)
+    {
+      std::vector<Key> &slot = m_slots[m_nextSlot % m_slots.size ()];
+      due.insert (due.end (), slot.begin (), slot.end ());
+      m_size -= slot.size ();
+      slot.clear ();
+    }
+}
+
+bool
+SallyTimingWheel::GetNextSlotEnd (Time &end) const
+{
+  if (m_size == 0)
+    {
+      return false;
+    }
+  for (int64_t slot = m_nextSlot; slot < m_nextSlot + (int64_t) m_slots.size (); slot++)
+    {
+      if (!m_slots[slot % m_slots.size ()].empty ())
+        {
+          end = TimeStep ((slot + 1) * m_resolution.GetInteger ());
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+SallyTimingWheel::Clear (void)
+{
+  for (std::vector<std::vector<Key> >::iterator i = m_slots.begin (); i != m_slots.end (); ++i)
+    {
+      i->clear ();
+    }
+  m_nextSlot = 0;
+  m_size = 0;
+}
+
+} // namespace ns3
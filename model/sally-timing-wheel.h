@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef SALLY_TIMING_WHEEL_H
+#define SALLY_TIMING_WHEEL_H
+
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup sally
+ *
+ * \brief Files deadlines in slots of a fixed width instead of one
+ * simulator event each.
+ *
+ * The wheel covers a span of time ahead of the current slot.  Its owner
+ * advances it to the current time and gets back the keys of every slot
+ * that ended.  A key may be filed several times; the owner keeps the
+ * real deadline of each key and checks it when the key comes out.
+ * Deadlines beyond the span go to the last slot, so the key comes out
+ * early and is filed again.
+ */
+class SallyTimingWheel
+{
+public:
+  /// What the owner files: an address and, for messages, a sequence number.
+  struct Key
+  {
+    Ipv4Address address;
+    uint16_t sequenceNumber;
+  };
+
+  /// Covers 30 s in 1 s slots.
+  SallyTimingWheel ();
+
+  /// Covers deadlines up to \p span ahead in slots of \p resolution; empties the wheel.
+  void SetSpan (Time span, Time resolution);
+  Time GetResolution (void) const;
+
+  /// Files \p key in the slot of \p deadline.
+  void Schedule (const Key &key, Time deadline);
+  /// Appends to \p due the keys of every slot that ended by \p now.
+  void Advance (Time now, std::vector<Key> &due);
+  /**
+   * \param end set to the end of the earliest slot holding keys
+   * \returns false if no key is filed
+   */
+  bool GetNextSlotEnd (Time &end) const;
+  void Clear (void);
+
+private:
+  int64_t SlotOf (Time t) const;
+
+  Time m_resolution;
+  std::vector<std::vector<Key> > m_slots;
+  /// First slot not yet advanced over.
+  int64_t m_nextSlot;
+  /// Keys filed and not yet handed back.
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* SALLY_TIMING_WHEEL_H */
@@ -0,0 +1,1113 @@
+///
+/// \brief Implementation of the AODV half of a SALLY node.
+///
+
+#include "ns3/log.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/udp-header.h"
+#include "ns3/aodv-packet.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "saodv-routing-protocol.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("SAodvRouting");
+#define AODV_PORT 654
+
+namespace ns3 {
+namespace sally {
+
+NS_OBJECT_ENSURE_REGISTERED (SAodvExtension);
+
+SAodvExtension::SAodvExtension ()
+  : m_pathCost (0)
+{
+}
+
+void
+SAodvExtension::AddDestination (Ipv4Address dst, uint32_t seqNo, bool unknownSeqNo)
+{
+  NS_ASSERT (m_destinations.size () < MAX_DESTINATIONS);
+  Destination d;
+  d.dst = dst;
+  d.seqNo = unknownSeqNo ? 0 : seqNo;
+  d.unknownSeqNo = unknownSeqNo;
+  m_destinations.push_back (d);
+}
+
+void
+SAodvExtension::RemoveDestination (uint32_t i)
+{
+  m_destinations.erase (m_destinations.begin () + i);
+}
+
+uint32_t
+SAodvExtension::GetNDestinations (void) const
+{
+  return m_destinations.size ();
+}
+
+Ipv4Address
+SAodvExtension::GetDestination (uint32_t i) const
+{
+  return m_destinations[i].dst;
+}
+
+uint32_t
+SAodvExtension::GetDstSeqno (uint32_t i) const
+{
+  return m_destinations[i].seqNo;
+}
+
+bool
+SAodvExtension::GetUnknownSeqno (uint32_t i) const
+{
+  return m_destinations[i].unknownSeqNo;
+}
+
+void
+SAodvExtension::SetDstSeqno (uint32_t i, uint32_t seqNo)
+{
+  m_destinations[i].seqNo = seqNo;
+  m_destinations[i].unknownSeqNo = false;
+}
+
+void
+SAodvExtension::SetPathCost (double cost)
+{
+  m_pathCost = cost;
+}
+
+double
+SAodvExtension::GetPathCost (void) const
+{
+  return m_pathCost;
+}
+
+TypeId
+SAodvExtension::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::sally::SAodvExtension")
+    .SetParent<Trailer> ()
+    .AddConstructor<SAodvExtension> ()
+  ;
+  return tid;
+}
+
+TypeId
+SAodvExtension::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+SAodvExtension::Print (std::ostream &os) const
+{
+  for (std::vector<Destination>::const_iterator i = m_destinations.begin (); i != m_destinations.end (); ++i)
+    {
+      os << i->dst;
+      if (!i->unknownSeqNo)
+        {
+          os << " seqno " << i->seqNo;
+        }
+      os << " ";
+    }
+  os << "cost " << m_pathCost;
+}
+
+uint32_t
+SAodvExtension::GetSerializedSize (void) const
+{
+  // Every destination, its sequence number and flags, then the path
+  // cost and the count.
+  return 9 * m_destinations.size () + 5;
+}
+
+void
+SAodvExtension::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.Prev (GetSerializedSize ());
+  for (std::vector<Destination>::const_iterator j = m_destinations.begin (); j != m_destinations.end (); ++j)
+    {
+      i.WriteHtonU32 (j->dst.Get ());
+      i.WriteHtonU32 (j->seqNo);
+      i.WriteU8 (j->unknownSeqNo ? 1 : 0);
+    }
+  // In 1/256ths of a perfect link.
+  i.WriteHtonU32 (uint32_t (m_pathCost * 256 + 0.5));
+  i.WriteU8 (m_destinations.size ());
+}
+
+uint32_t
+SAodvExtension::Deserialize (Buffer::Iterator end)
+{
+  Buffer::Iterator i = end;
+  i.Prev (1);
+  uint8_t count = i.ReadU8 ();
+  i = end;
+  i.Prev (9 * count + 5);
+  m_destinations.clear ();
+  for (uint8_t j = 0; j < count; j++)
+    {
+      Destination d;
+      d.dst.Set (i.ReadNtohU32 ());
+      d.seqNo = i.ReadNtohU32 ();
+      d.unknownSeqNo = i.ReadU8 () != 0;
+      m_destinations.push_back (d);
+    }
+  m_pathCost = i.ReadNtohU32 () / 256.0;
+  return GetSerializedSize ();
+}
+
+NS_OBJECT_ENSURE_REGISTERED (SAodvRoutingProtocol);
+
+TypeId SAodvRoutingProtocol::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::sally::SAodvRoutingProtocol")
+    .SetParent<ns3::aodv::RoutingProtocol> ()
+    .AddConstructor<SAodvRoutingProtocol> ()
+    .AddAttribute ("MprRelay", "Only rebroadcast RREQs received from neighbors that selected this node as MPR.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SAodvRoutingProtocol::m_mprRelay),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RreqRelays", "Number of RREQs this node rebroadcast.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetRreqRelays),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RreqRelaysSuppressed", "Number of RREQ rebroadcasts suppressed by MprRelay.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetRreqRelaysSuppressed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HellosAvoided", "Number of HELLOs not sent because neighbors come from SOLSR.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetHellosAvoided),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RoutesSeeded", "Number of routes installed from another protocol.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetRoutesSeeded),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LocalRepairs", "Number of routes repaired around a broken link without an RERR.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetLocalRepairs),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ExtensionReplies", "Number of RREPs sent for destinations carried in RREQ extensions.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SAodvRoutingProtocol::GetExtensionReplies),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ("RouteDiscovered", "The first packet to a destination left after a route discovery.",
+                     MakeTraceSourceAccessor (&SAodvRoutingProtocol::m_routeDiscoveredTrace))
+  ;
+  return tid;
+}
+
+SAodvRoutingProtocol::SAodvRoutingProtocol ()
+  : m_mprRelay (false),
+    m_rreqRelays (0),
+    m_rreqRelaysSuppressed (0),
+    m_relayCurrentRequest (true),
+    m_sharedNeighborSensing (false),
+    m_hellosAvoided (0),
+    m_avoidedHelloTimer (Timer::CANCEL_ON_DESTROY),
+    m_routesSeeded (0),
+    m_discoveries (0),
+    m_discoveryLatency (Seconds (0)),
+    m_localRepairs (0),
+    m_localRepairFailures (0),
+    m_handlingMessage (false),
+    m_extensionReplies (0)
+{
+  m_avoidedHelloTimer.SetFunction (&SAodvRoutingProtocol::AvoidedHelloTimerExpire, this);
+  // Both HELLO loss and link layer failures end up here.
+  m_nb.SetCallback (MakeCallback (&SAodvRoutingProtocol::NeighborFailed, this));
+}
+
+void
+SAodvRoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  RoutingProtocol::SetIpv4 (ipv4);
+  // RREQ rebroadcasts are not reported by the AODV Tx trace, so they are
+  // picked up on their way out of the node.
+  Ptr<Ipv4L3Protocol> l3 = ipv4->GetObject<Ipv4L3Protocol> ();
+  if (l3 != 0)
+    {
+      l3->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&SAodvRoutingProtocol::SendOutgoing, this));
+      l3->TraceConnectWithoutContext ("Tx", MakeCallback (&SAodvRoutingProtocol::PacketSent, this));
+    }
+  TraceConnectWithoutContext ("RreqTx", MakeCallback (&SAodvRoutingProtocol::RequestSent, this));
+  if (m_sharedNeighborSensing && !m_avoidedHelloTimer.IsRunning ())
+    {
+      m_avoidedHelloTimer.Schedule (HelloInterval);
+    }
+}
+
+void
+SAodvRoutingProtocol::SetSharedNeighborSensing (bool enable)
+{
+  m_sharedNeighborSensing = enable;
+  if (enable)
+    {
+      EnableHello = false;
+      if (m_ipv4 != 0 && !m_avoidedHelloTimer.IsRunning ())
+        {
+          m_avoidedHelloTimer.Schedule (HelloInterval);
+        }
+    }
+  else
+    {
+      m_avoidedHelloTimer.Cancel ();
+      m_sharedNeighbors.clear ();
+    }
+}
+
+void
+SAodvRoutingProtocol::NeighborUp (Ipv4Address neighbor, Ipv4Address local)
+{
+  int32_t interface = m_ipv4->GetInterfaceForAddress (local);
+  if (interface < 0)
+    {
+      return;
+    }
+  Ptr<NetDevice> dev = m_ipv4->GetNetDevice (interface);
+  Ipv4InterfaceAddress iface = m_ipv4->GetAddress (interface, 0);
+  // Valid until SOLSR reports the link down: nothing refreshes it.
+  Time lifetime = Simulator::GetMaximumSimulationTime () - Simulator::Now ();
+  aodv::RoutingTableEntry toNeighbor;
+  if (!m_routingTable.LookupRoute (neighbor, toNeighbor))
+    {
+      aodv::RoutingTableEntry newEntry (dev, neighbor, false, 0, iface, 1, neighbor, lifetime);
+      m_routingTable.AddRoute (newEntry);
+    }
+  else
+    {
+      toNeighbor.SetFlag (aodv::VALID);
+      toNeighbor.SetOutputDevice (dev);
+      toNeighbor.SetInterface (iface);
+      toNeighbor.SetHop (1);
+      toNeighbor.SetNextHop (neighbor);
+      toNeighbor.SetLifeTime (lifetime);
+      m_routingTable.Update (toNeighbor);
+    }
+  // Lets the link layer feedback of AODV close the link, which it only
+  // does for the neighbors it knows.
+  m_sharedNeighbors.insert (neighbor);
+  m_nb.Update (neighbor, lifetime);
+}
+
+void
+SAodvRoutingProtocol::NeighborDown (Ipv4Address neighbor, Ipv4Address local)
+{
+  NS_LOG_DEBUG ("SOLSR lost neighbor " << neighbor);
+  m_sharedNeighbors.erase (neighbor);
+  LinkBroken (neighbor);
+}
+
+void
+SAodvRoutingProtocol::NeighborFailed (Ipv4Address neighbor)
+{
+  // m_nb cannot forget a neighbor, so the ones SOLSR already reported
+  // down are still closed here.
+  if (m_sharedNeighborSensing && m_sharedNeighbors.erase (neighbor) == 0)
+    {
+      return;
+    }
+  LinkBroken (neighbor);
+}
+
+void
+SAodvRoutingProtocol::SetRepairCallback (RepairCallback repair)
+{
+  m_repair = repair;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetLocalRepairs (void) const
+{
+  return m_localRepairs;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetLocalRepairFailures (void) const
+{
+  return m_localRepairFailures;
+}
+
+void
+SAodvRoutingProtocol::LinkBroken (Ipv4Address nextHop)
+{
+  if (m_repair.IsNull ())
+    {
+      SendRerrWhenBreaksLinkToNextHop (nextHop);
+      return;
+    }
+
+  std::map<Ipv4Address, uint32_t> broken;
+  m_routingTable.GetListOfDestinationWithNextHop (nextHop, broken);
+  aodv::RoutingTableEntry toNextHop;
+  if (m_routingTable.LookupRoute (nextHop, toNextHop))
+    {
+      broken.insert (std::make_pair (nextHop, toNextHop.GetSeqNo ()));
+    }
+
+  std::set<Ipv4Address> dsts;
+  for (std::map<Ipv4Address, uint32_t>::const_iterator i = broken.begin (); i != broken.end (); ++i)
+    {
+      dsts.insert (i->first);
+    }
+  std::map<Ipv4Address, Ptr<Ipv4Route> > repaired = m_repair (dsts, nextHop);
+  bool complete = !broken.empty () && repaired.size () == broken.size ();
+
+  for (std::map<Ipv4Address, Ptr<Ipv4Route> >::const_iterator i = repaired.begin (); i != repaired.end (); ++i)
+    {
+      // The RERR below invalidates the route to the broken hop itself.
+      if (!complete && i->first == nextHop)
+        {
+          continue;
+        }
+      aodv::RoutingTableEntry rt;
+      m_routingTable.LookupRoute (i->first, rt);
+      int32_t interface = m_ipv4->GetInterfaceForDevice (i->second->GetOutputDevice ());
+      rt.SetFlag (aodv::VALID);
+      rt.SetNextHop (i->second->GetGateway ());
+      rt.SetOutputDevice (i->second->GetOutputDevice ());
+      rt.SetInterface (m_ipv4->GetAddress (interface, 0));
+      // The detour is at least one hop longer than the broken path.
+      rt.SetHop (rt.GetHop () + 1);
+      rt.SetLifeTime (ActiveRouteTimeout);
+      m_routingTable.Update (rt);
+      m_localRepairs++;
+      NS_LOG_DEBUG ("Route to " << i->first << " repaired via " << i->second->GetGateway ());
+    }
+
+  if (!complete)
+    {
+      m_localRepairFailures++;
+      SendRerrWhenBreaksLinkToNextHop (nextHop);
+    }
+}
+
+void
+SAodvRoutingProtocol::RequestRoute (Ipv4Address dst)
+{
+  RequestRoutes (std::vector<Ipv4Address> (1, dst));
+}
+
+void
+SAodvRoutingProtocol::RequestRoutes (const std::vector<Ipv4Address> &dsts)
+{
+  std::vector<Ipv4Address> wanted;
+  for (std::vector<Ipv4Address>::const_iterator i = dsts.begin (); i != dsts.end (); ++i)
+    {
+      aodv::RoutingTableEntry rt;
+      if ((m_routingTable.LookupRoute (*i, rt) && rt.GetFlag () == aodv::IN_SEARCH)
+          || std::find (wanted.begin (), wanted.end (), *i) != wanted.end ())
+        {
+          continue;
+        }
+      wanted.push_back (*i);
+    }
+  if (wanted.empty ())
+    {
+      return;
+    }
+
+  Time now = Simulator::Now ();
+  for (std::map<Ipv4Address, std::pair<Time, SAodvExtension> >::iterator i = m_ownExtensions.begin ();
+       i != m_ownExtensions.end ();)
+    {
+      if (i->second.first < now)
+        {
+          m_ownExtensions.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  SAodvExtension extension;
+  uint32_t n = 1;
+  for (; n < wanted.size () && extension.GetNDestinations () < SAodvExtension::MAX_DESTINATIONS; n++)
+    {
+      aodv::RoutingTableEntry rt;
+      bool known = m_routingTable.LookupRoute (wanted[n], rt) && rt.GetValidSeqNo ();
+      extension.AddDestination (wanted[n], known ? rt.GetSeqNo () : 0, !known);
+      // No RreqTx reports these.
+      RequestSent (wanted[n]);
+    }
+  if (extension.GetNDestinations () > 0)
+    {
+      m_ownExtensions[wanted.front ()] = std::make_pair (now + MaxDiscoveryTime (), extension);
+    }
+  else
+    {
+      m_ownExtensions.erase (wanted.front ());
+    }
+  NS_LOG_DEBUG ("Route discovery for " << wanted.front () << " and " << extension.GetNDestinations ()
+                << " more destinations requested");
+  SendRequest (wanted.front ());
+  if (n < wanted.size ())
+    {
+      RequestRoutes (std::vector<Ipv4Address> (wanted.begin () + n, wanted.end ()));
+    }
+}
+
+uint32_t
+SAodvRoutingProtocol::GetExtensionReplies (void) const
+{
+  return m_extensionReplies;
+}
+
+Ptr<Ipv4Route>
+SAodvRoutingProtocol::LookupValidRoute (Ipv4Address dst)
+{
+  aodv::RoutingTableEntry rt;
+  if (!m_routingTable.LookupValidRoute (dst, rt))
+    {
+      return 0;
+    }
+  return rt.GetRoute ();
+}
+
+Ptr<Ipv4Route>
+SAodvRoutingProtocol::UseValidRoute (Ipv4Address dst, Ptr<NetDevice> oif)
+{
+  aodv::RoutingTableEntry rt;
+  if (!m_routingTable.LookupValidRoute (dst, rt))
+    {
+      return 0;
+    }
+  Ptr<Ipv4Route> route = rt.GetRoute ();
+  if (oif != 0 && route->GetOutputDevice () != oif)
+    {
+      return 0;
+    }
+  UpdateRouteLifeTime (dst, ActiveRouteTimeout);
+  UpdateRouteLifeTime (route->GetGateway (), ActiveRouteTimeout);
+  return route;
+}
+
+bool
+SAodvRoutingProtocol::RefreshRoute (Ipv4Address dst, Ipv4Address nextHop)
+{
+  if (!UpdateRouteLifeTime (dst, ActiveRouteTimeout))
+    {
+      return false;
+    }
+  UpdateRouteLifeTime (nextHop, ActiveRouteTimeout);
+  return true;
+}
+
+void
+SAodvRoutingProtocol::SetRouteChangeCallback (Callback<void> changed)
+{
+  m_routingTable.SetRouteChangeCallback (changed);
+}
+
+void
+SAodvRoutingProtocol::SeedRoute (Ipv4Address dst, Ipv4Address nextHop, uint32_t interface, uint32_t hops)
+{
+  aodv::RoutingTableEntry rt;
+  bool known = m_routingTable.LookupRoute (dst, rt);
+  if (known && rt.GetFlag () == aodv::VALID)
+    {
+      return;
+    }
+  Ptr<NetDevice> dev = m_ipv4->GetNetDevice (interface);
+  Ipv4InterfaceAddress iface = m_ipv4->GetAddress (interface, 0);
+  if (!known)
+    {
+      // No sequence number is known: a seeded route may answer RREQs with
+      // the unknown-sequence-number flag only, and any route AODV learns
+      // with a real sequence number replaces it.
+      aodv::RoutingTableEntry newEntry (dev, dst, true, 0, iface, hops, nextHop, ActiveRouteTimeout);
+      m_routingTable.AddRoute (newEntry);
+    }
+  else
+    {
+      // Keep the last sequence number AODV saw for the destination.
+      rt.SetFlag (aodv::VALID);
+      rt.SetOutputDevice (dev);
+      rt.SetInterface (iface);
+      rt.SetHop (hops);
+      rt.SetNextHop (nextHop);
+      rt.SetLifeTime (ActiveRouteTimeout);
+      m_routingTable.Update (rt);
+    }
+  NS_LOG_DEBUG ("Seeded route to " << dst << " via " << nextHop << ", " << hops << " hops");
+  m_routesSeeded++;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetRoutesSeeded (void) const
+{
+  return m_routesSeeded;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetDiscoveries (void) const
+{
+  return m_discoveries;
+}
+
+Time
+SAodvRoutingProtocol::GetDiscoveryLatency (void) const
+{
+  return m_discoveryLatency;
+}
+
+void
+SAodvRoutingProtocol::RequestSent (Ipv4Address dst)
+{
+  // Retries keep the time of the first RREQ, unless that discovery
+  // must have given up by now.
+  std::map<Ipv4Address, Time>::iterator i = m_discoveryStart.find (dst);
+  if (i == m_discoveryStart.end () || Simulator::Now () - i->second > MaxDiscoveryTime ())
+    {
+      m_discoveryStart[dst] = Simulator::Now ();
+    }
+}
+
+Time
+SAodvRoutingProtocol::MaxDiscoveryTime (void) const
+{
+  return Seconds ((RreqRetries + 1) * NetTraversalTime.GetSeconds ());
+}
+
+void
+SAodvRoutingProtocol::PacketSent (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  if (m_discoveryStart.empty ())
+    {
+      return;
+    }
+  Ipv4Header header;
+  packet->PeekHeader (header);
+  std::map<Ipv4Address, Time>::iterator i = m_discoveryStart.find (header.GetDestination ());
+  if (i == m_discoveryStart.end ())
+    {
+      return;
+    }
+  Time latency = Simulator::Now () - i->second;
+  if (latency > MaxDiscoveryTime ())
+    {
+      // The discovery failed; the route came from elsewhere.
+      m_discoveryStart.erase (i);
+      return;
+    }
+  NS_LOG_DEBUG ("Route to " << i->first << " discovered in " << latency.GetSeconds () << "s");
+  m_discoveries++;
+  m_discoveryLatency += latency;
+  m_routeDiscoveredTrace (i->first, latency);
+  m_discoveryStart.erase (i);
+}
+
+uint32_t
+SAodvRoutingProtocol::GetHellosAvoided (void) const
+{
+  return m_hellosAvoided;
+}
+
+void
+SAodvRoutingProtocol::AvoidedHelloTimerExpire ()
+{
+  // AODV only sends a HELLO if it broadcast nothing else in the interval.
+  if (Simulator::Now () - m_lastBcastTime >= HelloInterval)
+    {
+      m_hellosAvoided++;
+    }
+  // m_nb only resolves the MAC address of a neighbor, which link layer
+  // feedback is matched on, when it is updated after the ARP reply.
+  for (std::set<Ipv4Address>::const_iterator i = m_sharedNeighbors.begin (); i != m_sharedNeighbors.end (); ++i)
+    {
+      m_nb.Update (*i, Time (0));
+    }
+  m_avoidedHelloTimer.Schedule (HelloInterval);
+}
+
+void
+SAodvRoutingProtocol::SetRelayFilter (Callback<bool, Ipv4Address> filter)
+{
+  m_relayFilter = filter;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetRreqRelays (void) const
+{
+  return m_rreqRelays;
+}
+
+uint32_t
+SAodvRoutingProtocol::GetRreqRelaysSuppressed (void) const
+{
+  return m_rreqRelaysSuppressed;
+}
+
+bool
+SAodvRoutingProtocol::RelayRequest (Ipv4Address sender)
+{
+  m_relayCurrentRequest = !m_mprRelay || m_relayFilter.IsNull () || m_relayFilter (sender);
+  if (m_relayCurrentRequest)
+    {
+      return true;
+    }
+  NS_LOG_DEBUG ("Not an MPR of " << sender << ", RREQ is not rebroadcast");
+  m_rreqRelaysSuppressed++;
+  return false;
+}
+
+void
+SAodvRoutingProtocol::TrackRequest (Ptr<Packet> packet, Ipv4Address sender)
+{
+  aodv::RreqHeader rreqHeader;
+  packet->PeekHeader (rreqHeader);
+  if (IsMyOwnAddress (rreqHeader.GetOrigin ()))
+    {
+      return;
+    }
+  PurgeRequestsSeen ();
+  RequestId id (rreqHeader.GetOrigin (), rreqHeader.GetId ());
+  std::map<RequestId, bool>::iterator seen = m_requestsSeen.find (id);
+  if (seen == m_requestsSeen.end ())
+    {
+      // AODV handles this copy in full, except that it cannot relay a
+      // suppressed one.
+      m_requestsSeen[id] = m_relayCurrentRequest;
+      m_requestsSeenExpiry.push_back (std::make_pair (Simulator::Now () + PathDiscoveryTime, id));
+      return;
+    }
+  if (seen->second || !m_relayCurrentRequest)
+    {
+      return;
+    }
+  // AODV drops this copy as a duplicate of the one it did not relay.
+  seen->second = true;
+  SocketIpTtlTag ttl;
+  packet->PeekPacketTag (ttl);
+  RelaySuppressedRequest (rreqHeader, sender, ttl.GetTtl ());
+}
+
+void
+SAodvRoutingProtocol::RelaySuppressedRequest (aodv::RreqHeader rreqHeader, Ipv4Address sender, uint8_t ttl)
+{
+  // AODV does not rebroadcast at the destination, nor where it could
+  // answer from its own route.
+  if (ttl < 2 || IsMyOwnAddress (rreqHeader.GetDst ()))
+    {
+      return;
+    }
+  aodv::RoutingTableEntry toDst;
+  if (m_routingTable.LookupRoute (rreqHeader.GetDst (), toDst))
+    {
+      if (toDst.GetNextHop () == sender)
+        {
+          return;
+        }
+      if ((rreqHeader.GetUnknownSeqno () || (int32_t (toDst.GetSeqNo ()) - int32_t (rreqHeader.GetDstSeqno ()) >= 0))
+          && toDst.GetValidSeqNo ())
+        {
+          if (!rreqHeader.GetDestinationOnly () && toDst.GetFlag () == aodv::VALID)
+            {
+              return;
+            }
+          rreqHeader.SetDstSeqno (toDst.GetSeqNo ());
+          rreqHeader.SetUnknownSeqno (false);
+        }
+    }
+  rreqHeader.SetHopCount (rreqHeader.GetHopCount () + 1);
+  NS_LOG_DEBUG ("RREQ " << rreqHeader.GetId () << " of " << rreqHeader.GetOrigin ()
+                << " received again from MPR selector " << sender << ", rebroadcasting");
+  for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin ();
+       j != m_socketAddresses.end (); ++j)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      SocketIpTtlTag tag;
+      tag.SetTtl (ttl - 1);
+      packet->AddPacketTag (tag);
+      packet->AddHeader (rreqHeader);
+      aodv::TypeHeader tHeader (aodv::AODVTYPE_RREQ);
+      packet->AddHeader (tHeader);
+      // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
+      Ipv4Address destination;
+      if (j->second.GetMask () == Ipv4Mask::GetOnes ())
+        {
+          destination = Ipv4Address ("255.255.255.255");
+        }
+      else
+        {
+          destination = j->second.GetBroadcast ();
+        }
+      m_lastBcastTime = Simulator::Now ();
+      Simulator::Schedule (Time (MilliSeconds (m_uniformRandomVariable->GetInteger (0, 10))),
+                           &aodv::RoutingProtocol::SendTo, this, j->first, packet, destination);
+    }
+}
+
+void
+SAodvRoutingProtocol::PurgeRequestsSeen ()
+{
+  Time now = Simulator::Now ();
+  while (!m_requestsSeenExpiry.empty () && m_requestsSeenExpiry.front ().first <= now)
+    {
+      m_requestsSeen.erase (m_requestsSeenExpiry.front ().second);
+      m_requestsSeenExpiry.pop_front ();
+    }
+}
+
+void
+SAodvRoutingProtocol::SetDivertCallback (DivertCallback divert)
+{
+  m_divert = divert;
+}
+
+bool
+SAodvRoutingProtocol::DivertPacket (Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination)
+{
+  // Every RREQ AODV originates or relays passes here.
+  AttachExtension (packet);
+  if (m_divert.IsNull ())
+    {
+      return false;
+    }
+  std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator i = m_socketAddresses.find (socket);
+  // Only broadcasts can share a datagram with other messages.
+  if (i == m_socketAddresses.end () || (!destination.IsBroadcast () && destination != i->second.GetBroadcast ()))
+    {
+      return false;
+    }
+  if (!m_divert (packet, i->second.GetLocal (), destination, AODV_PORT))
+    {
+      return false;
+    }
+  // The message no longer shows up as an AODV datagram in SendOutgoing.
+  CountRelay (packet->Copy ());
+  return true;
+}
+
+void
+SAodvRoutingProtocol::SetLinkCostCallback (LinkCostCallback cost)
+{
+  m_linkCost = cost;
+}
+
+void
+SAodvRoutingProtocol::ReceiveControl (Ptr<Packet> packet, aodv::MessageType type, Ipv4Address sender)
+{
+  if (type == aodv::AODVTYPE_RREQ && m_mprRelay && !m_relayFilter.IsNull ())
+    {
+      TrackRequest (packet, sender);
+    }
+  if (type == aodv::AODVTYPE_RREQ || type == aodv::AODVTYPE_RREP)
+    {
+      ReceiveExtension (packet, type, sender);
+    }
+}
+
+void
+SAodvRoutingProtocol::ReceiveExtension (Ptr<Packet> packet, aodv::MessageType type, Ipv4Address sender)
+{
+  aodv::RreqHeader rreqHeader;
+  aodv::RrepHeader rrepHeader;
+  // Without a link metric only RREQ extensions matter.
+  if (m_linkCost.IsNull ()
+      && (type != aodv::AODVTYPE_RREQ || packet->GetSize () <= rreqHeader.GetSerializedSize ()))
+    {
+      return;
+    }
+  Ptr<Packet> p = packet->Copy ();
+  Ipv4Address dst;
+  uint8_t hops;
+  if (type == aodv::AODVTYPE_RREQ)
+    {
+      p->RemoveHeader (rreqHeader);
+      if (IsMyOwnAddress (rreqHeader.GetOrigin ()))
+        {
+          return;
+        }
+      PurgeExtensions ();
+      // AODV only handles the first copy.
+      if (m_extensions.find (RequestId (rreqHeader.GetOrigin (), rreqHeader.GetId ())) != m_extensions.end ())
+        {
+          return;
+        }
+      dst = rreqHeader.GetOrigin ();
+      hops = rreqHeader.GetHopCount ();
+    }
+  else
+    {
+      p->RemoveHeader (rrepHeader);
+      // HELLOs only offer the link itself.
+      if (rrepHeader.GetDst () == rrepHeader.GetOrigin ())
+        {
+          return;
+        }
+      dst = rrepHeader.GetDst ();
+      hops = rrepHeader.GetHopCount ();
+    }
+  SAodvExtension extension;
+  bool extended = p->GetSize () > 0;
+  if (extended)
+    {
+      p->RemoveTrailer (extension);
+    }
+  // The route AODV is about to consider, as RecvRequest and RecvReply
+  // count it; a sender without SALLY only tells its hop count.
+  PathCost path;
+  path.nextHop = sender;
+  path.hops = uint8_t (hops + 1);
+  path.cost = path.hops;
+  if (!m_linkCost.IsNull ())
+    {
+      path.cost = (extended ? extension.GetPathCost () : hops) + m_linkCost (sender);
+      m_handlingMessage = true;
+      m_messageDst = dst;
+      m_messagePath = path;
+      Simulator::ScheduleNow (&SAodvRoutingProtocol::RecordPathCost, this, dst, path);
+    }
+  if (type != aodv::AODVTYPE_RREQ)
+    {
+      return;
+    }
+  // Relayed copies carry the cost up to this node.
+  extension.SetPathCost (path.cost);
+  RequestId id (rreqHeader.GetOrigin (), rreqHeader.GetId ());
+  m_extensions[id] = extension;
+  m_extensionsExpiry.push_back (std::make_pair (Simulator::Now () + PathDiscoveryTime, id));
+  if (extension.GetNDestinations () > 0)
+    {
+      // The replies follow the reverse route RecvRequest is about to install.
+      Simulator::ScheduleNow (&SAodvRoutingProtocol::AnswerExtension, this, rreqHeader, sender);
+    }
+}
+
+void
+SAodvRoutingProtocol::RecordPathCost (Ipv4Address dst, PathCost path)
+{
+  m_handlingMessage = false;
+  aodv::RoutingTableEntry rt;
+  if (m_routingTable.LookupRoute (dst, rt) && rt.GetNextHop () == path.nextHop && rt.GetHop () == path.hops)
+    {
+      m_pathCosts[dst] = path;
+    }
+}
+
+double
+SAodvRoutingProtocol::GetPathCost (aodv::RoutingTableEntry const &rt)
+{
+  std::map<Ipv4Address, PathCost>::const_iterator i = m_pathCosts.find (rt.GetDestination ());
+  if (i != m_pathCosts.end () && i->second.nextHop == rt.GetNextHop () && i->second.hops == rt.GetHop ())
+    {
+      return i->second.cost;
+    }
+  // Seeded, repaired or learned without a cost: the other hops count as perfect links.
+  return m_linkCost (rt.GetNextHop ()) + rt.GetHop () - 1;
+}
+
+bool
+SAodvRoutingProtocol::PreferRoute (aodv::RoutingTableEntry const &current, uint8_t hops)
+{
+  if (m_linkCost.IsNull () || !m_handlingMessage || current.GetDestination () != m_messageDst)
+    {
+      return aodv::RoutingProtocol::PreferRoute (current, hops);
+    }
+  return m_messagePath.cost < GetPathCost (current);
+}
+
+void
+SAodvRoutingProtocol::SendingReply (Ptr<Packet> packet)
+{
+  if (m_linkCost.IsNull ())
+    {
+      return;
+    }
+  Ptr<Packet> p = packet->Copy ();
+  aodv::TypeHeader tHeader;
+  p->RemoveHeader (tHeader);
+  aodv::RrepHeader rrepHeader;
+  p->RemoveHeader (rrepHeader);
+  SAodvExtension extension;
+  aodv::RoutingTableEntry toDst;
+  if (IsMyOwnAddress (rrepHeader.GetDst ()))
+    {
+      extension.SetPathCost (0);
+    }
+  else if (m_handlingMessage && rrepHeader.GetDst () == m_messageDst)
+    {
+      // A forwarded RREP offers the path it came along.
+      extension.SetPathCost (m_messagePath.cost);
+    }
+  else if (m_routingTable.LookupRoute (rrepHeader.GetDst (), toDst))
+    {
+      extension.SetPathCost (GetPathCost (toDst));
+    }
+  else
+    {
+      extension.SetPathCost (rrepHeader.GetHopCount ());
+    }
+  packet->AddTrailer (extension);
+}
+
+void
+SAodvRoutingProtocol::AnswerExtension (aodv::RreqHeader rreqHeader, Ipv4Address sender)
+{
+  std::map<RequestId, SAodvExtension>::iterator i =
+    m_extensions.find (RequestId (rreqHeader.GetOrigin (), rreqHeader.GetId ()));
+  aodv::RoutingTableEntry toOrigin;
+  if (i == m_extensions.end () || !m_routingTable.LookupValidRoute (rreqHeader.GetOrigin (), toOrigin))
+    {
+      return;
+    }
+  SAodvExtension &extension = i->second;
+  // The same conditions as AODV applies to the first destination.
+  for (uint32_t j = 0; j < extension.GetNDestinations ();)
+    {
+      Ipv4Address dst = extension.GetDestination (j);
+      if (IsMyOwnAddress (dst))
+        {
+          aodv::RreqHeader request = rreqHeader;
+          request.SetDst (dst);
+          request.SetDstSeqno (extension.GetDstSeqno (j));
+          request.SetUnknownSeqno (extension.GetUnknownSeqno (j));
+          NS_LOG_DEBUG ("RREQ " << rreqHeader.GetId () << " of " << rreqHeader.GetOrigin () << " also looks for us");
+          SendReply (request, toOrigin);
+          m_extensionReplies++;
+          extension.RemoveDestination (j);
+          continue;
+        }
+      aodv::RoutingTableEntry toDst;
+      if (m_routingTable.LookupRoute (dst, toDst) && toDst.GetNextHop () != sender && toDst.GetValidSeqNo ()
+          && (extension.GetUnknownSeqno (j) || (int32_t (toDst.GetSeqNo ()) - int32_t (extension.GetDstSeqno (j)) >= 0)))
+        {
+          if (!rreqHeader.GetDestinationOnly () && toDst.GetFlag () == aodv::VALID)
+            {
+              NS_LOG_DEBUG ("Answering RREQ " << rreqHeader.GetId () << " of " << rreqHeader.GetOrigin ()
+                            << " for " << dst);
+              SendReplyByIntermediateNode (toDst, toOrigin, rreqHeader.GetGratiousRrep ());
+              m_extensionReplies++;
+              extension.RemoveDestination (j);
+              continue;
+            }
+          extension.SetDstSeqno (j, toDst.GetSeqNo ());
+        }
+      j++;
+    }
+}
+
+void
+SAodvRoutingProtocol::AttachExtension (Ptr<Packet> packet)
+{
+  if (m_ownExtensions.empty () && m_extensions.empty () && m_linkCost.IsNull ())
+    {
+      return;
+    }
+  Ptr<Packet> p = packet->Copy ();
+  aodv::TypeHeader tHeader;
+  p->RemoveHeader (tHeader);
+  aodv::RreqHeader rreqHeader;
+  if (!tHeader.IsValid () || tHeader.Get () != aodv::AODVTYPE_RREQ || p->GetSize () != rreqHeader.GetSerializedSize ())
+    {
+      return;
+    }
+  p->RemoveHeader (rreqHeader);
+  SAodvExtension extension;
+  if (IsMyOwnAddress (rreqHeader.GetOrigin ()))
+    {
+      std::map<Ipv4Address, std::pair<Time, SAodvExtension> >::iterator i = m_ownExtensions.find (rreqHeader.GetDst ());
+      if (i != m_ownExtensions.end ())
+        {
+          // Retries leave out the destinations found since.
+          SAodvExtension &own = i->second.second;
+          for (uint32_t j = 0; j < own.GetNDestinations ();)
+            {
+              if (LookupValidRoute (own.GetDestination (j)) != 0)
+                {
+                  own.RemoveDestination (j);
+                }
+              else
+                {
+                  j++;
+                }
+            }
+          extension = own;
+          if (i->second.first < Simulator::Now () || own.GetNDestinations () == 0)
+            {
+              m_ownExtensions.erase (i);
+            }
+        }
+      extension.SetPathCost (0);
+    }
+  else
+    {
+      PurgeExtensions ();
+      std::map<RequestId, SAodvExtension>::const_iterator i =
+        m_extensions.find (RequestId (rreqHeader.GetOrigin (), rreqHeader.GetId ()));
+      if (i == m_extensions.end ())
+        {
+          return;
+        }
+      extension = i->second;
+    }
+  if (extension.GetNDestinations () > 0 || !m_linkCost.IsNull ())
+    {
+      packet->AddTrailer (extension);
+    }
+}
+
+void
+SAodvRoutingProtocol::PurgeExtensions ()
+{
+  Time now = Simulator::Now ();
+  while (!m_extensionsExpiry.empty () && m_extensionsExpiry.front ().first <= now)
+    {
+      m_extensions.erase (m_extensionsExpiry.front ().second);
+      m_extensionsExpiry.pop_front ();
+    }
+}
+
+void
+SAodvRoutingProtocol::SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+{
+  if (header.GetProtocol () != UdpHeader::PROT_NUMBER)
+    {
+      return;
+    }
+  Ptr<Packet> p = packet->Copy ();
+  UdpHeader udpHeader;
+  p->RemoveHeader (udpHeader);
+  if (udpHeader.GetDestinationPort () != AODV_PORT)
+    {
+      return;
+    }
+  CountRelay (p);
+}
+
+void
+SAodvRoutingProtocol::CountRelay (Ptr<Packet> p)
+{
+  aodv::TypeHeader tHeader;
+  p->PeekHeader (tHeader);
+  if (!tHeader.IsValid () || tHeader.Get () != aodv::AODVTYPE_RREQ)
+    {
+      return;
+    }
+  uint32_t size = p->GetSize ();
+  p->RemoveHeader (tHeader);
+  aodv::RreqHeader rreqHeader;
+  p->RemoveHeader (rreqHeader);
+  if (m_ipv4->GetInterfaceForAddress (rreqHeader.GetOrigin ()) < 0)
+    {
+      m_rreqRelays++;
+      m_txPacketTrace (size);
+    }
+}
+
+}
+} // namespace ns3
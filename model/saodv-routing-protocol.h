@@ -0,0 +1,274 @@
+#ifndef SAODV_ROUTING_PROTOCOL_H
+#define SAODV_ROUTING_PROTOCOL_H
+
+#include "ns3/aodv-routing-protocol.h"
+#include "ns3/callback.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/timer.h"
+#include "ns3/traced-callback.h"
+#include "ns3/trailer.h"
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ns3 {
+namespace sally {
+
+///
+/// \ingroup sally
+///
+/// \brief SALLY fields trailing an RREQ or RREP
+///
+/// A SALLY node starts the discoveries it needs within a short window
+/// as one RREQ: the AODV header names the first destination and this
+/// trailer the others, each with the sequence number the originator
+/// knows for it.  The trailer also carries the link metric cost of the
+/// path the message travelled, so that the hop count stays a hop count.
+/// AODV only parses its own header, so a node without SALLY answers and
+/// relays the first destination alone, by hop count.
+///
+class SAodvExtension : public Trailer
+{
+        public:
+         /// The count of destinations takes one byte.
+         static const uint32_t MAX_DESTINATIONS = 255;
+
+         SAodvExtension ();
+         /// Adds \p dst; \p seqNo only counts if \p unknownSeqNo is false.
+         void AddDestination (Ipv4Address dst, uint32_t seqNo, bool unknownSeqNo);
+         void RemoveDestination (uint32_t i);
+         uint32_t GetNDestinations (void) const;
+         Ipv4Address GetDestination (uint32_t i) const;
+         uint32_t GetDstSeqno (uint32_t i) const;
+         bool GetUnknownSeqno (uint32_t i) const;
+         /// Sets a known sequence number for destination \p i.
+         void SetDstSeqno (uint32_t i, uint32_t seqNo);
+         /// Sets the cost of the path from the originator of an RREQ, or
+         /// from the destination of an RREP, to its sender.
+         void SetPathCost (double cost);
+         double GetPathCost (void) const;
+
+         static TypeId GetTypeId (void);
+         virtual TypeId GetInstanceTypeId (void) const;
+         virtual void Print (std::ostream &os) const;
+         virtual uint32_t GetSerializedSize (void) const;
+         virtual void Serialize (Buffer::Iterator start) const;
+         virtual uint32_t Deserialize (Buffer::Iterator end);
+
+        private:
+         struct Destination
+         {
+           Ipv4Address dst;
+           uint32_t seqNo;
+           bool unknownSeqNo;
+         };
+         std::vector<Destination> m_destinations;
+         double m_pathCost;
+};
+
+///
+/// \ingroup sally
+///
+/// \brief AODV half of a SALLY node
+///
+/// Can restrict RREQ rebroadcasts to the nodes chosen as MPR by the
+/// previous hop, using the neighbor state of the co-located SOLSR, and
+/// can take its neighbors from SOLSR instead of sending HELLOs, and
+/// can repair broken routes locally before falling back to RERR.
+///
+class SAodvRoutingProtocol: public ns3::aodv::RoutingProtocol
+{
+        public:
+         static TypeId GetTypeId (void);
+         SAodvRoutingProtocol ();
+         virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+
+         /// Asks whether an RREQ received from a neighbor may be rebroadcast.
+         void SetRelayFilter (Callback<bool, Ipv4Address> filter);
+         /// \returns the number of RREQs this node rebroadcast
+         uint32_t GetRreqRelays (void) const;
+         /// \returns the number of RREQ rebroadcasts the relay filter suppressed
+         uint32_t GetRreqRelaysSuppressed (void) const;
+
+         /// Stops AODV HELLOs; neighbors are then reported through
+         /// NeighborUp and NeighborDown, and only link layer feedback
+         /// still breaks links on its own.
+         void SetSharedNeighborSensing (bool enable);
+         /// A neighbor became reachable through \p local.
+         void NeighborUp (Ipv4Address neighbor, Ipv4Address local);
+         /// The link to \p neighbor broke.
+         void NeighborDown (Ipv4Address neighbor, Ipv4Address local);
+         /// \returns the number of HELLOs not sent thanks to shared neighbor sensing
+         uint32_t GetHellosAvoided (void) const;
+
+         /**
+          * Installs a route known by another protocol as a valid AODV
+          * route, unless AODV already has a valid one of its own.
+          *
+          * \param dst the destination
+          * \param nextHop the next hop towards \p dst
+          * \param interface the outgoing interface index
+          * \param hops the distance to \p dst
+          */
+         void SeedRoute (Ipv4Address dst, Ipv4Address nextHop, uint32_t interface, uint32_t hops);
+         /// \returns the number of routes installed by SeedRoute
+         uint32_t GetRoutesSeeded (void) const;
+         /// \returns the number of completed route discoveries
+         uint32_t GetDiscoveries (void) const;
+         /// \returns the summed latency of the completed route discoveries
+         Time GetDiscoveryLatency (void) const;
+
+         /// Asked once per link break for alternate routes to the
+         /// destinations (first argument) that avoid the broken next hop
+         /// (second argument); returns the route of each destination that
+         /// has one.
+         typedef Callback<std::map<Ipv4Address, Ptr<Ipv4Route> >,
+                          const std::set<Ipv4Address> &, Ipv4Address> RepairCallback;
+         void SetRepairCallback (RepairCallback repair);
+         /// \returns the number of routes repaired locally
+         uint32_t GetLocalRepairs (void) const;
+         /// \returns the number of link breaks that still needed an RERR
+         uint32_t GetLocalRepairFailures (void) const;
+
+         /// Offered every jittered AODV broadcast, with the local address,
+         /// destination and UDP port; returns false if the packet must
+         /// still be sent on its own.
+         typedef Callback<bool, Ptr<const Packet>, Ipv4Address, Ipv4Address, uint16_t> DivertCallback;
+         void SetDivertCallback (DivertCallback divert);
+         virtual bool DivertPacket (Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination);
+
+         /// Asked for the cost of the link from a neighbor, 1 for a perfect
+         /// link.  RREQs and RREPs then carry the cost of their path in a
+         /// SAodvExtension, and of two routes with the same sequence number
+         /// the cheaper one wins instead of the shorter one.
+         typedef Callback<double, Ipv4Address> LinkCostCallback;
+         void SetLinkCostCallback (LinkCostCallback cost);
+
+         /// Starts a route discovery for \p dst unless one is in progress.
+         void RequestRoute (Ipv4Address dst);
+         /// Starts one route discovery for the destinations of \p dsts not
+         /// already looked for: the RREQ, and its retries, name the first
+         /// and carry the others in a SAodvExtension.
+         void RequestRoutes (const std::vector<Ipv4Address> &dsts);
+         /// \returns the number of RREPs sent for destinations of RREQ extensions
+         uint32_t GetExtensionReplies (void) const;
+         /// \returns the valid AODV route to \p dst, or 0
+         Ptr<Ipv4Route> LookupValidRoute (Ipv4Address dst);
+         /// Does what the RouteOutput of AODV does for a destination with a
+         /// valid route, and nothing otherwise.
+         /// \returns the valid route to \p dst through \p oif (any device if 0), or 0
+         Ptr<Ipv4Route> UseValidRoute (Ipv4Address dst, Ptr<NetDevice> oif);
+         /// Extends the lifetime of the route to \p dst and of the route to
+         /// its next hop \p nextHop, as AODV does for every packet it routes.
+         /// \returns false if the route to \p dst is no longer valid
+         bool RefreshRoute (Ipv4Address dst, Ipv4Address nextHop);
+         /// Called whenever an AODV route is added, deleted, invalidated
+         /// or given a new next hop.
+         void SetRouteChangeCallback (Callback<void> changed);
+
+        private:
+         virtual bool RelayRequest (Ipv4Address sender);
+         virtual void ReceiveControl (Ptr<Packet> packet, aodv::MessageType type, Ipv4Address sender);
+         virtual bool PreferRoute (aodv::RoutingTableEntry const &current, uint8_t hops);
+         virtual void SendingReply (Ptr<Packet> packet);
+         /// Remembers whether an RREQ was relayed, so that a copy from an
+         /// MPR selector arriving after a suppressed one is still relayed.
+         void TrackRequest (Ptr<Packet> packet, Ipv4Address sender);
+         /// Rebroadcasts an RREQ that AODV already took as a duplicate.
+         void RelaySuppressedRequest (aodv::RreqHeader rreqHeader, Ipv4Address sender, uint8_t ttl);
+         /// Forgets the RREQs AODV no longer considers duplicates.
+         void PurgeRequestsSeen ();
+         /// Reads the path cost of an RREQ or RREP for PreferRoute, and
+         /// keeps the extension of the first copy of an RREQ, for AnswerExtension.
+         void ReceiveExtension (Ptr<Packet> packet, aodv::MessageType type, Ipv4Address sender);
+         struct PathCost
+         {
+           Ipv4Address nextHop;
+           uint16_t hops;
+           double cost;
+         };
+         /// Remembers the cost of the route to \p dst once AODV handled the
+         /// message, if AODV took the route \p path describes.
+         void RecordPathCost (Ipv4Address dst, PathCost path);
+         /// \returns the cost of the route \p rt, or an estimate from its
+         /// first link and hop count if it was not learned with one
+         double GetPathCost (aodv::RoutingTableEntry const &rt);
+         /// Answers, once AODV handled the RREQ, the destinations of its
+         /// extension this node knows a route to; the others are relayed.
+         void AnswerExtension (aodv::RreqHeader rreqHeader, Ipv4Address sender);
+         /// Trails an RREQ about to be sent with the destinations it still
+         /// carries and the cost of its path.
+         void AttachExtension (Ptr<Packet> packet);
+         void PurgeExtensions ();
+         /// Attached to the Ipv4L3Protocol SendOutgoing trace source.
+         void SendOutgoing (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface);
+         /// Counts \p packet, an AODV message without UDP header, if it is a relayed RREQ.
+         void CountRelay (Ptr<Packet> packet);
+         /// Replaces SendRerrWhenBreaksLinkToNextHop as link failure handler:
+         /// tries the repair callback for every destination behind
+         /// \p nextHop and only sends an RERR for what is left.
+         void LinkBroken (Ipv4Address nextHop);
+         /// Handles the link failures of m_nb: lost HELLOs, or link layer
+         /// feedback on a neighbor reported by NeighborUp.
+         void NeighborFailed (Ipv4Address neighbor);
+         /// Counts the HELLOs AODV would have sent in the last interval.
+         void AvoidedHelloTimerExpire ();
+         /// Attached to our own RreqTx trace source.
+         void RequestSent (Ipv4Address dst);
+         /// \returns the time after which a discovery has certainly given up
+         Time MaxDiscoveryTime (void) const;
+         /// Attached to the Ipv4L3Protocol Tx trace source.
+         void PacketSent (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+
+         /// Only rebroadcast RREQs received from MPR selectors.
+         bool m_mprRelay;
+         Callback<bool, Ipv4Address> m_relayFilter;
+         uint32_t m_rreqRelays;
+         uint32_t m_rreqRelaysSuppressed;
+         /// Verdict of RelayRequest on the RREQ being received.
+         bool m_relayCurrentRequest;
+         typedef std::pair<Ipv4Address, uint32_t> RequestId;
+         /// RREQs seen in the last PathDiscoveryTime, by originator and id,
+         /// and whether they were relayed: the retransmitted flag of the
+         /// RFC 3626 duplicate set.
+         std::map<RequestId, bool> m_requestsSeen;
+         std::deque<std::pair<Time, RequestId> > m_requestsSeenExpiry;
+         bool m_sharedNeighborSensing;
+         /// Neighbors reported up and not down since.
+         std::set<Ipv4Address> m_sharedNeighbors;
+         uint32_t m_hellosAvoided;
+         Timer m_avoidedHelloTimer;
+         uint32_t m_routesSeeded;
+         /// Start of the discoveries still in progress, per destination.
+         std::map<Ipv4Address, Time> m_discoveryStart;
+         uint32_t m_discoveries;
+         Time m_discoveryLatency;
+         /// Reports a destination whose first packet left after a discovery, and the latency.
+         TracedCallback<Ipv4Address, Time> m_routeDiscoveredTrace;
+         RepairCallback m_repair;
+         uint32_t m_localRepairs;
+         uint32_t m_localRepairFailures;
+         DivertCallback m_divert;
+         LinkCostCallback m_linkCost;
+         /// Set while AODV handles an RREQ or RREP that offers a route to
+         /// m_messageDst along m_messagePath.
+         bool m_handlingMessage;
+         Ipv4Address m_messageDst;
+         PathCost m_messagePath;
+         /// Cost of the routes learned from RREQs and RREPs, by destination.
+         std::map<Ipv4Address, PathCost> m_pathCosts;
+         /// Other destinations of the discoveries started by RequestRoutes,
+         /// by first destination, and when they are given up.
+         std::map<Ipv4Address, std::pair<Time, SAodvExtension> > m_ownExtensions;
+         /// What is left to relay of the extensions of the RREQs received.
+         std::map<RequestId, SAodvExtension> m_extensions;
+         std::deque<std::pair<Time, RequestId> > m_extensionsExpiry;
+         uint32_t m_extensionReplies;
+};
+
+}
+} // namespace ns3
+
+#endif /* SAODV_ROUTING_PROTOCOL_H */
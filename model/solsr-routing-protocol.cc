@@ -10,10 +10,30 @@
 #include "ns3/ipv4-route.h"
 #include "ns3/node.h"
 #include "ns3/ipv4-static-routing.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/arp-cache.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-remote-station-manager.h"
+#include "ns3/inet-socket-address.h"
 #include "solsr-routing-protocol.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <sstream>
 
 NS_LOG_COMPONENT_DEFINE ("SOlsrRouting");
 #define OLSR_MAX_SEQ_NUM        65535
+#define OLSR_PORT_NUMBER 698
+#define OLSR_WILL_NEVER 0
+#define OLSR_WILL_ALWAYS 7
 
 namespace ns3 {
 namespace sally {
@@ -25,10 +45,1586 @@ TypeId SOlsrRoutingProtocol::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::sally::SOlsrRoutingProtocol")
         .SetParent<ns3::olsr::RoutingProtocol> ()
     .AddConstructor<SOlsrRoutingProtocol> ()
+    .AddTraceSource ("MprSelectorsChanged", "The size of the MPR selector set changed.",
+                     MakeTraceSourceAccessor (&SOlsrRoutingProtocol::m_mprSelectorsChangedTrace))
+    .AddAttribute ("ScopedTc", "Send TC messages in TTL-scoped rings (fisheye). "
+                   "When false no TC messages are sent at all.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_scopedTc),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ScopedTcRadii", "Comma-separated TTL of each TC ring, innermost first.",
+                   StringValue ("2,4,8"),
+                   MakeStringAccessor (&SOlsrRoutingProtocol::m_scopedTcRadii),
+                   MakeStringChecker ())
+    .AddAttribute ("ScopedTcIntervals", "Comma-separated TC emission interval of each ring in seconds.",
+                   StringValue ("5,10,20"),
+                   MakeStringAccessor (&SOlsrRoutingProtocol::m_scopedTcIntervals),
+                   MakeStringChecker ())
+    .AddAttribute ("AdaptiveHello", "Adapt the HELLO interval to the rate of symmetric link changes.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_adaptiveHello),
+                   MakeBooleanChecker ())
+    .AddAttribute ("HelloMinInterval", "Lower bound of the adaptive HELLO interval.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&SOlsrRoutingProtocol::m_helloMinInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("HelloMaxInterval", "Upper bound of the adaptive HELLO interval.",
+                   TimeValue (Seconds (8)),
+                   MakeTimeAccessor (&SOlsrRoutingProtocol::m_helloMaxInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("HelloChurnWindow", "Number of HELLO periods the link change rate is averaged over.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&SOlsrRoutingProtocol::m_helloChurnWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("HelloChurnTarget", "Symmetric link changes tolerated per HELLO interval.",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&SOlsrRoutingProtocol::m_helloChurnTarget),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("CompactHello", "Send HELLOs as neighbor set deltas between full refreshes. "
+                   "Every node of the network must enable it.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_compactHello),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CompactHelloRefresh", "Every how many HELLOs the full neighbor set is sent.",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&SOlsrRoutingProtocol::m_compactHelloRefresh),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("EtxMetric", "Select MPRs and routes by the ETX of the links, measured from HELLO "
+                   "delivery ratios, instead of the hop count.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_etx),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EtxWindow", "Period HELLO delivery ratios are measured over.",
+                   TimeValue (Seconds (20)),
+                   MakeTimeAccessor (&SOlsrRoutingProtocol::m_etxWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("LinkFailureThreshold", "Unicast frames the MAC gives up on in a row before the link to "
+                   "the neighbor counts as broken (0 waits for the hold time).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SOlsrRoutingProtocol::m_linkFailureThreshold),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LinkFailureWindow", "Transmit failures further apart start a new run.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&SOlsrRoutingProtocol::m_linkFailureWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("IncrementalRoutes", "Keep an index of the topology graph and update only the routes "
+                   "a change affects instead of rebuilding the routing table.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_incrementalRoutes),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BitsetMpr", "Select MPRs with the stock heuristic on coverage bitsets "
+                   "instead of scanning the 2-hop neighbor set.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_bitsetMpr),
+                   MakeBooleanChecker ())
+    .AddAttribute ("IndexedDuplicates", "Keep the duplicate set hashed by (originator, sequence number) "
+                   "and expire it on a timing wheel instead of one event per tuple.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_indexedDuplicates),
+                   MakeBooleanChecker ())
+    .AddAttribute ("IndexedLinks", "Look link tuples up in a hash of their neighbor address and run the "
+                   "link timers from a timing wheel instead of one event per timer.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_indexedLinks),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CoalescedTimers", "Send HELLO, MID, HNA and scoped TC messages from one per-node timer "
+                   "that skips the duties with nothing to send.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&SOlsrRoutingProtocol::m_coalescedTimers),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("LinkBreakDetected", "A link (neighbor address, local address) broke on transmit failures; "
+                     "with the time since the first failed frame.",
+                     MakeTraceSourceAccessor (&SOlsrRoutingProtocol::m_linkBreakTrace))
+    .AddTraceSource ("CurrentHelloInterval", "The HELLO emission interval in use.",
+                     MakeTraceSourceAccessor (&SOlsrRoutingProtocol::m_currentHelloInterval))
+    .AddTraceSource ("NeighborChanged", "A symmetric link (neighbor address, local address) went up or down.",
+                     MakeTraceSourceAccessor (&SOlsrRoutingProtocol::m_neighborChangedTrace))
   ;
   return tid;
 }
 
+SOlsrRoutingProtocol::SOlsrRoutingProtocol ()
+  : m_mprSelectorCount (0),
+    m_scopedTc (false),
+    m_scopedTcTimer (Timer::CANCEL_ON_DESTROY),
+    m_adaptiveHello (false),
+    m_helloChurnWindow (8),
+    m_helloChurnTarget (0.5),
+    m_linkChanges (0),
+    m_linkChangesAtLastHello (0),
+    m_compactHello (false),
+    m_compactHelloRefresh (4),
+    m_etx (false),
+    m_etxWindow (Seconds (20)),
+    m_etxReroutes (0),
+    m_linkFailureThreshold (0),
+    m_linkFailureWindow (Seconds (1)),
+    m_holdTimeSaved (Seconds (0)),
+    m_incrementalRoutes (false),
+    m_routeIndexSynced (false),
+    m_routesVisited (0),
+    m_bitsetMpr (false),
+    m_indexedDuplicates (false),
+    m_indexedLinks (false),
+    m_linkWheel (Timer::CANCEL_ON_DESTROY),
+    m_linkWheelTicks (0),
+    m_coalescedTimers (false),
+    m_protocolTick (Timer::CANCEL_ON_DESTROY),
+    m_protocolTicks (0)
+{
+  m_scopedTcJitter = CreateObject<UniformRandomVariable> ();
+}
+
+int64_t
+SOlsrRoutingProtocol::AssignStreams (int64_t stream)
+{
+  int64_t used = RoutingProtocol::AssignStreams (stream);
+  // Drawn for the scoped TC and the indexed forwarding jitter.
+  m_scopedTcJitter->SetStream (stream + used);
+  return used + 1;
+}
+
+void
+SOlsrRoutingProtocol::DoInitialize ()
+{
+  RoutingProtocol::DoInitialize ();
+  m_currentHelloInterval = m_helloInterval;
+  m_helloCodec.SetRefreshInterval (m_compactHelloRefresh);
+  m_linkQuality.SetWindow (m_etxWindow);
+  m_linkBreaks.SetThreshold (m_linkFailureThreshold);
+  m_linkBreaks.SetWindow (m_linkFailureWindow);
+  if (m_indexedLinks)
+    {
+      // Slots of a quarter HELLO interval over the neighbor hold time.
+      m_linkIndex.SetTimerSpan (Seconds (3 * m_helloInterval.GetSeconds ()),
+                                Seconds (m_helloInterval.GetSeconds () / 4));
+      m_state.SetLinkLookup (MakeCallback (&SallyLinkIndex::Find, &m_linkIndex));
+      m_state.SetLinkSetChangedCallback (MakeCallback (&SallyLinkIndex::LinkSetChanged, &m_linkIndex));
+      m_linkWheel.SetFunction (&SOlsrRoutingProtocol::LinkWheelExpire, this);
+    }
+  if (m_linkBreaks.IsEnabled ())
+    {
+      for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+        {
+          Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (m_ipv4->GetNetDevice (i));
+          if (wifi != 0)
+            {
+              wifi->GetRemoteStationManager ()->TraceConnectWithoutContext ("MacTxFinalDataFailed",
+                                                                         MakeCallback (&SOlsrRoutingProtocol::TxFinalDataFailed, this));
+            }
+        }
+    }
+  if (m_scopedTc)
+    {
+      ConfigureScopedTc ();
+      m_ringDue.assign (m_ringRadius.size (), Simulator::Now ());
+      m_ringAdvertised.assign (m_ringRadius.size (), Simulator::Now ());
+      m_scopedTcTimer.SetFunction (&SOlsrRoutingProtocol::ScopedTcTimerExpire, this);
+    }
+  if (m_coalescedTimers && m_helloTimer.IsRunning ())
+    {
+      // OLSR sent its first messages and started a timer per message
+      // type; one tick takes over from here.
+      m_helloTimer.Cancel ();
+      m_tcTimer.Cancel ();
+      m_midTimer.Cancel ();
+      m_hnaTimer.Cancel ();
+      TimeValue interval;
+      GetAttribute ("MidInterval", interval);
+      m_midEmissionInterval = interval.Get ();
+      GetAttribute ("HnaInterval", interval);
+      m_hnaEmissionInterval = interval.Get ();
+      Time now = Simulator::Now ();
+      m_nextHello = now + m_helloInterval;
+      m_nextMid = now + m_midEmissionInterval;
+      m_nextHna = now + m_hnaEmissionInterval;
+      m_nextScopedTc = m_scopedTc ? SendScopedTc () : now;
+      m_protocolTick.SetFunction (&SOlsrRoutingProtocol::ProtocolTick, this);
+      ScheduleProtocolTick ();
+    }
+  else if (m_scopedTc)
+    {
+      ScopedTcTimerExpire ();
+    }
+}
+
+void
+SOlsrRoutingProtocol::ConfigureScopedTc ()
+{
+  m_ringRadius.clear ();
+  m_ringInterval.clear ();
+  std::istringstream radii (m_scopedTcRadii);
+  std::string item;
+  while (std::getline (radii, item, ','))
+    {
+      int radius = atoi (item.c_str ());
+      NS_ABORT_MSG_IF (radius < 1 || radius > 255, "Bad ScopedTcRadii entry \"" << item << "\"");
+      NS_ABORT_MSG_IF (!m_ringRadius.empty () && radius <= m_ringRadius.back (),
+                       "ScopedTcRadii must be increasing");
+      m_ringRadius.push_back (radius);
+    }
+  std::istringstream intervals (m_scopedTcIntervals);
+  while (std::getline (intervals, item, ','))
+    {
+      double interval = atof (item.c_str ());
+      NS_ABORT_MSG_IF (interval <= 0, "Bad ScopedTcIntervals entry \"" << item << "\"");
+      m_ringInterval.push_back (Seconds (interval));
+    }
+  NS_ABORT_MSG_IF (m_ringRadius.empty () || m_ringRadius.size () != m_ringInterval.size (),
+                   "ScopedTcRadii and ScopedTcIntervals need the same, non-zero number of entries");
+}
+
+void
+SOlsrRoutingProtocol::ScopedTcTimerExpire ()
+{
+  m_scopedTcTimer.Schedule (SendScopedTc () - Simulator::Now ());
+}
+
+Time
+SOlsrRoutingProtocol::SendScopedTc ()
+{
+  Time now = Simulator::Now ();
+
+  // A ring reaches every node of the rings inside it, so only the
+  // outermost due ring is sent and the inner ones count as refreshed.
+  int ring = m_ringDue.size () - 1;
+  while (ring >= 0 && m_ringDue[ring] > now)
+    {
+      ring--;
+    }
+  if (ring >= 0)
+    {
+      for (int i = 0; i <= ring; i++)
+        {
+          m_ringDue[i] = now + m_ringInterval[i];
+        }
+
+      // As in RFC 3626 section 9.3, a node whose selectors are gone keeps
+      // sending empty TCs for one validity time, so that its old edges
+      // are dropped instead of lingering for up to 3 outer intervals.
+      const olsr::MprSelectorSet &selectors = m_state.GetMprSelectors ();
+      Time vtime = Seconds (3 * m_ringInterval[ring].GetSeconds ());
+      if (!selectors.empty ())
+        {
+          for (int i = 0; i <= ring; i++)
+            {
+              m_ringAdvertised[i] = std::max (m_ringAdvertised[i], now + vtime);
+            }
+        }
+      if (!selectors.empty () || now < m_ringAdvertised[ring])
+        {
+          olsr::MessageHeader msg;
+          msg.SetVTime (vtime);
+          msg.SetOriginatorAddress (m_mainAddress);
+          msg.SetTimeToLive (m_ringRadius[ring]);
+          msg.SetHopCount (0);
+          m_messageSequenceNumber = (m_messageSequenceNumber + 1) % (OLSR_MAX_SEQ_NUM + 1);
+          msg.SetMessageSequenceNumber (m_messageSequenceNumber);
+          olsr::MessageHeader::Tc &tc = msg.GetTc ();
+          tc.ansn = m_ansn;
+          for (olsr::MprSelectorSet::const_iterator i = selectors.begin (); i != selectors.end (); i++)
+            {
+              tc.neighborAddresses.push_back (i->mainAddr);
+            }
+          NS_LOG_DEBUG ((selectors.empty () ? "Empty scoped TC" : "Scoped TC") << ", ring " << ring
+                        << ", TTL " << (uint32_t) m_ringRadius[ring]);
+          QueueMessage (msg, Seconds (m_scopedTcJitter->GetValue (0, m_ringInterval[0].GetSeconds () / 4)));
+        }
+    }
+
+  return *std::min_element (m_ringDue.begin (), m_ringDue.end ());
+}
+
+void
+SOlsrRoutingProtocol::AddMprSelectorTuple (const olsr::MprSelectorTuple &tuple)
+{
+  RoutingProtocol::AddMprSelectorTuple (tuple);
+  CheckMprSelectors ();
+}
+
+void
+SOlsrRoutingProtocol::RemoveMprSelectorTuple (const olsr::MprSelectorTuple &tuple)
+{
+  RoutingProtocol::RemoveMprSelectorTuple (tuple);
+  CheckMprSelectors ();
+}
+
+void
+SOlsrRoutingProtocol::AdaptiveHelloTimerExpire ()
+{
+  AdaptHelloInterval ();
+  HelloTimerExpire ();
+}
+
+void
+SOlsrRoutingProtocol::AdaptHelloInterval ()
+{
+  Time now = Simulator::Now ();
+  if (m_adaptiveHello)
+    {
+      UpdateSymLinks ();
+      uint32_t changes = m_linkChanges - m_linkChangesAtLastHello;
+      m_linkChangesAtLastHello = m_linkChanges;
+      if (!m_lastHello.IsZero ())
+        {
+          m_churnSamples.push_back (std::make_pair (changes, (now - m_lastHello).GetSeconds ()));
+          if (m_churnSamples.size () > m_helloChurnWindow)
+            {
+              m_churnSamples.pop_front ();
+            }
+        }
+      m_lastHello = now;
+
+      uint32_t totalChanges = 0;
+      double totalSeconds = 0;
+      for (std::deque<std::pair<uint32_t, double> >::const_iterator i = m_churnSamples.begin ();
+           i != m_churnSamples.end (); i++)
+        {
+          totalChanges += i->first;
+          totalSeconds += i->second;
+        }
+
+      Time interval = m_helloMaxInterval;
+      if (totalChanges > 0 && totalSeconds > 0)
+        {
+          interval = Seconds (m_helloChurnTarget * totalSeconds / totalChanges);
+        }
+      // Neighbors hold our links for three intervals of the previous
+      // HELLO, so never grow by more than twice per period.
+      interval = std::min (interval, m_helloInterval + m_helloInterval);
+      interval = std::max (m_helloMinInterval, std::min (m_helloMaxInterval, interval));
+      if (interval != m_helloInterval)
+        {
+          NS_LOG_DEBUG ("HELLO interval " << m_helloInterval.GetSeconds () << "s -> " << interval.GetSeconds ()
+                        << "s after " << totalChanges << " link changes in " << totalSeconds << "s");
+          m_helloInterval = interval;
+        }
+    }
+  m_currentHelloInterval = m_helloInterval;
+}
+
+void
+SOlsrRoutingProtocol::ProtocolTick ()
+{
+  Time now = Simulator::Now ();
+  m_protocolTicks++;
+  if (m_nextHello <= now)
+    {
+      AdaptHelloInterval ();
+      SendHello ();
+      m_nextHello = now + m_helloInterval;
+    }
+  // The duties with nothing to send keep their phase without waking us.
+  if (m_nextMid <= now)
+    {
+      if (HasMidAddresses ())
+        {
+          SendMid ();
+        }
+      m_nextMid = now + m_midEmissionInterval;
+    }
+  if (m_nextHna <= now)
+    {
+      if (!m_state.GetAssociations ().empty ())
+        {
+          SendHna ();
+        }
+      m_nextHna = now + m_hnaEmissionInterval;
+    }
+  if (m_scopedTc && m_nextScopedTc <= now)
+    {
+      m_nextScopedTc = SendScopedTc ();
+    }
+  ScheduleProtocolTick ();
+}
+
+void
+SOlsrRoutingProtocol::ScheduleProtocolTick ()
+{
+  // SendTc is empty, so plain TCs are never a duty.
+  Time next = m_nextHello;
+  if (HasMidAddresses ())
+    {
+      next = std::min (next, m_nextMid);
+    }
+  if (!m_state.GetAssociations ().empty ())
+    {
+      next = std::min (next, m_nextHna);
+    }
+  if (m_scopedTc)
+    {
+      next = std::min (next, m_nextScopedTc);
+    }
+  m_protocolTick.Schedule (std::max (next - Simulator::Now (), Seconds (0)));
+}
+
+bool
+SOlsrRoutingProtocol::HasMidAddresses ()
+{
+  Ipv4Address loopback ("127.0.0.1");
+  for (uint32_t i = 0; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      Ipv4Address address = m_ipv4->GetAddress (i, 0).GetLocal ();
+      if (address != m_mainAddress && address != loopback)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetProtocolTicks () const
+{
+  return m_protocolTicks;
+}
+
+void
+SOlsrRoutingProtocol::UpdateSymLinks ()
+{
+  Time now = Simulator::Now ();
+  std::map<Ipv4Address, Ipv4Address> symLinks;
+  const olsr::LinkSet &links = m_state.GetLinks ();
+  for (olsr::LinkSet::const_iterator i = links.begin (); i != links.end (); i++)
+    {
+      if (i->symTime >= now)
+        {
+          symLinks[i->neighborIfaceAddr] = i->localIfaceAddr;
+        }
+    }
+  for (std::map<Ipv4Address, Ipv4Address>::const_iterator i = symLinks.begin (); i != symLinks.end (); i++)
+    {
+      if (m_symLinks.find (i->first) == m_symLinks.end ())
+        {
+          m_linkChanges++;
+          m_neighborChangedTrace (i->first, i->second, true);
+          if (m_linkBreaks.IsEnabled ())
+            {
+              m_unmappedLinks.insert (i->first);
+            }
+        }
+    }
+  for (std::map<Ipv4Address, Ipv4Address>::const_iterator i = m_symLinks.begin (); i != m_symLinks.end (); i++)
+    {
+      if (symLinks.find (i->first) == symLinks.end ())
+        {
+          m_linkChanges++;
+          m_neighborChangedTrace (i->first, i->second, false);
+          if (m_unmappedLinks.erase (i->first) == 0)
+            {
+              for (std::map<Mac48Address, Ipv4Address>::iterator j = m_linkMacs.begin (); j != m_linkMacs.end (); j++)
+                {
+                  if (j->second == i->first)
+                    {
+                      m_linkMacs.erase (j);
+                      break;
+                    }
+                }
+            }
+        }
+    }
+  m_symLinks.swap (symLinks);
+}
+
+bool
+SOlsrRoutingProtocol::RelaysFor (Ipv4Address neighbor)
+{
+  Ipv4Address mainAddr = neighbor;
+  const olsr::IfaceAssocTuple *assoc = m_state.FindIfaceAssocTuple (neighbor);
+  if (assoc != NULL)
+    {
+      mainAddr = assoc->mainAddr;
+    }
+  // Neighbors OLSR does not know (yet) keep the plain AODV flooding.
+  if (m_state.FindSymNeighborTuple (mainAddr) == NULL)
+    {
+      return true;
+    }
+  return m_state.FindMprSelectorTuple (mainAddr) != NULL;
+}
+
+std::map<Ipv4Address, Ptr<Ipv4Route> >
+SOlsrRoutingProtocol::RepairRoutes (const std::set<Ipv4Address> &dsts, Ipv4Address brokenHop)
+{
+  Ipv4Address brokenMain = brokenHop;
+  const olsr::IfaceAssocTuple *assoc = m_state.FindIfaceAssocTuple (brokenHop);
+  if (assoc != NULL)
+    {
+      brokenMain = assoc->mainAddr;
+    }
+
+  // The routing table may still lead through the broken hop until the
+  // link times out in OLSR as well.  The same pass collects the routes
+  // to the neighbors the 2-hop detours go through.
+  std::map<Ipv4Address, olsr::RoutingTableEntry> found;
+  std::map<Ipv4Address, olsr::RoutingTableEntry> neighbors;
+  std::vector<olsr::RoutingTableEntry> entries = GetRoutingTableEntries ();
+  for (std::vector<olsr::RoutingTableEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      if (i->nextAddr == brokenHop)
+        {
+          continue;
+        }
+      if (i->distance == 1)
+        {
+          neighbors[i->destAddr] = *i;
+        }
+      if (i->destAddr != brokenMain && dsts.find (i->destAddr) != dsts.end ())
+        {
+          found[i->destAddr] = *i;
+        }
+    }
+
+  if (found.size () < dsts.size ())
+    {
+      const olsr::TwoHopNeighborSet &twoHops = m_state.GetTwoHopNeighbors ();
+      for (olsr::TwoHopNeighborSet::const_iterator t = twoHops.begin (); t != twoHops.end (); t++)
+        {
+          if (dsts.find (t->twoHopNeighborAddr) == dsts.end ()
+              || found.find (t->twoHopNeighborAddr) != found.end ()
+              || t->neighborMainAddr == brokenMain
+              || m_state.FindSymNeighborTuple (t->neighborMainAddr) == NULL)
+            {
+              continue;
+            }
+          std::map<Ipv4Address, olsr::RoutingTableEntry>::const_iterator neighbor = neighbors.find (t->neighborMainAddr);
+          if (neighbor != neighbors.end ())
+            {
+              found[t->twoHopNeighborAddr] = neighbor->second;
+            }
+        }
+    }
+
+  std::map<Ipv4Address, Ptr<Ipv4Route> > repaired;
+  for (std::map<Ipv4Address, olsr::RoutingTableEntry>::const_iterator i = found.begin (); i != found.end (); i++)
+    {
+      Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+      route->SetDestination (i->first);
+      route->SetGateway (i->second.nextAddr);
+      route->SetOutputDevice (m_ipv4->GetNetDevice (i->second.interface));
+      route->SetSource (m_ipv4->GetAddress (i->second.interface, 0).GetLocal ());
+      repaired[i->first] = route;
+      NS_LOG_DEBUG ("Repaired route to " << i->first << " around " << brokenHop << " via " << i->second.nextAddr);
+    }
+  return repaired;
+}
+
+void
+SOlsrRoutingProtocol::RoutingTableChanged (uint32_t size)
+{
+  UpdateSymLinks ();
+  CheckMprSelectors ();
+}
+
+void
+SOlsrRoutingProtocol::CheckMprSelectors ()
+{
+  uint32_t count = m_state.GetMprSelectors ().size ();
+  if (count != m_mprSelectorCount)
+    {
+      NS_LOG_DEBUG ("MPR selector set size " << m_mprSelectorCount << " -> " << count);
+      m_mprSelectorCount = count;
+      m_mprSelectorsChangedTrace (count);
+    }
+}
+
+Ipv4Address
+SOlsrRoutingProtocol::MainAddressOf (Ipv4Address iface)
+{
+  const olsr::IfaceAssocTuple *assoc = m_state.FindIfaceAssocTuple (iface);
+  return assoc != NULL ? assoc->mainAddr : iface;
+}
+
+double
+SOlsrRoutingProtocol::NeighborEtx (Ipv4Address neighborMain)
+{
+  Time now = Simulator::Now ();
+  double best = SallyLinkQuality::MAX_ETX;
+  const olsr::LinkSet &links = m_state.GetLinks ();
+  for (olsr::LinkSet::const_iterator i = links.begin (); i != links.end (); i++)
+    {
+      if (i->symTime >= now && MainAddressOf (i->neighborIfaceAddr) == neighborMain)
+        {
+          best = std::min (best, m_linkQuality.GetLinkEtx (i->localIfaceAddr, i->neighborIfaceAddr, neighborMain, now));
+        }
+    }
+  return best;
+}
+
+void
+SOlsrRoutingProtocol::EtxMprComputation ()
+{
+  olsr::MprSet mprSet;
+  std::map<Ipv4Address, double> neighborEtx;
+  const olsr::NeighborSet &neighbors = m_state.GetNeighbors ();
+  for (olsr::NeighborSet::const_iterator i = neighbors.begin (); i != neighbors.end (); i++)
+    {
+      if (i->status != olsr::NeighborTuple::STATUS_SYM || i->willingness == OLSR_WILL_NEVER)
+        {
+          continue;
+        }
+      neighborEtx[i->neighborMainAddr] = NeighborEtx (i->neighborMainAddr);
+      if (i->willingness == OLSR_WILL_ALWAYS)
+        {
+          mprSet.insert (i->neighborMainAddr);
+        }
+    }
+
+  // Strict 2-hop neighbor -> (ETX, neighbor) of its best path.
+  std::map<Ipv4Address, std::pair<double, Ipv4Address> > best;
+  const olsr::TwoHopNeighborSet &twoHops = m_state.GetTwoHopNeighbors ();
+  for (olsr::TwoHopNeighborSet::const_iterator t = twoHops.begin (); t != twoHops.end (); t++)
+    {
+      if (t->twoHopNeighborAddr == m_mainAddress || m_ipv4->GetInterfaceForAddress (t->twoHopNeighborAddr) >= 0
+          || m_state.FindSymNeighborTuple (t->twoHopNeighborAddr) != NULL)
+        {
+          continue;
+        }
+      std::map<Ipv4Address, double>::const_iterator via = neighborEtx.find (t->neighborMainAddr);
+      if (via == neighborEtx.end ())
+        {
+          continue;
+        }
+      double cost = via->second + m_linkQuality.GetTwoHopEtx (t->neighborMainAddr, t->twoHopNeighborAddr);
+      std::map<Ipv4Address, std::pair<double, Ipv4Address> >::iterator b = best.find (t->twoHopNeighborAddr);
+      if (b == best.end () || cost < b->second.first)
+        {
+          best[t->twoHopNeighborAddr] = std::make_pair (cost, t->neighborMainAddr);
+        }
+    }
+  for (std::map<Ipv4Address, std::pair<double, Ipv4Address> >::const_iterator b = best.begin (); b != best.end (); b++)
+    {
+      mprSet.insert (b->second.second);
+    }
+  m_state.SetMprSet (mprSet);
+}
+
+void
+SOlsrRoutingProtocol::FindEtxPaths (bool hopCount, std::map<Ipv4Address, EtxPath> &paths)
+{
+  Time now = Simulator::Now ();
+  std::set<std::pair<double, Ipv4Address> > pending;
+
+  // Our symmetric links start the paths.
+  const olsr::LinkSet &links = m_state.GetLinks ();
+  for (olsr::LinkSet::const_iterator i = links.begin (); i != links.end (); i++)
+    {
+      Ipv4Address neighborMain = MainAddressOf (i->neighborIfaceAddr);
+      if (i->symTime < now || m_state.FindSymNeighborTuple (neighborMain) == NULL)
+        {
+          continue;
+        }
+      EtxPath path;
+      path.cost = hopCount ? 1.0 : m_linkQuality.GetLinkEtx (i->localIfaceAddr, i->neighborIfaceAddr, neighborMain, now);
+      path.hops = 1;
+      path.nextAddr = i->neighborIfaceAddr;
+      path.interface = m_ipv4->GetInterfaceForAddress (i->localIfaceAddr);
+      Ipv4Address dests[2] = { i->neighborIfaceAddr, neighborMain };
+      for (int d = 0; d < 2; d++)
+        {
+          std::map<Ipv4Address, EtxPath>::iterator known = paths.find (dests[d]);
+          if (known == paths.end () || path.cost < known->second.cost)
+            {
+              if (known != paths.end ())
+                {
+                  pending.erase (std::make_pair (known->second.cost, dests[d]));
+                }
+              paths[dests[d]] = path;
+              pending.insert (std::make_pair (path.cost, dests[d]));
+            }
+        }
+    }
+
+  // Beyond them, the 2-hop links cost what the neighbors report and the
+  // topology links, which TCs advertise without a metric, one each.
+  std::map<Ipv4Address, std::vector<std::pair<Ipv4Address, double> > > adjacency;
+  const olsr::TwoHopNeighborSet &twoHops = m_state.GetTwoHopNeighbors ();
+  for (olsr::TwoHopNeighborSet::const_iterator t = twoHops.begin (); t != twoHops.end (); t++)
+    {
+      const olsr::NeighborTuple *neighbor = m_state.FindSymNeighborTuple (t->neighborMainAddr);
+      if (neighbor != NULL && neighbor->willingness != OLSR_WILL_NEVER)
+        {
+          double etx = hopCount ? 1.0 : m_linkQuality.GetTwoHopEtx (t->neighborMainAddr, t->twoHopNeighborAddr);
+          adjacency[t->neighborMainAddr].push_back (std::make_pair (t->twoHopNeighborAddr, etx));
+        }
+    }
+  const olsr::TopologySet &topology = m_state.GetTopologySet ();
+  for (olsr::TopologySet::const_iterator t = topology.begin (); t != topology.end (); t++)
+    {
+      adjacency[t->lastAddr].push_back (std::make_pair (t->destAddr, 1.0));
+    }
+
+  while (!pending.empty ())
+    {
+      Ipv4Address node = pending.begin ()->second;
+      pending.erase (pending.begin ());
+      const EtxPath from = paths[node];
+      std::map<Ipv4Address, std::vector<std::pair<Ipv4Address, double> > >::const_iterator edges = adjacency.find (node);
+      if (edges == adjacency.end ())
+        {
+          continue;
+        }
+      for (std::vector<std::pair<Ipv4Address, double> >::const_iterator e = edges->second.begin (); e != edges->second.end (); e++)
+        {
+          if (e->first == m_mainAddress || m_ipv4->GetInterfaceForAddress (e->first) >= 0)
+            {
+              continue;
+            }
+          double cost = from.cost + e->second;
+          std::map<Ipv4Address, EtxPath>::iterator known = paths.find (e->first);
+          if (known != paths.end ())
+            {
+              if (cost >= known->second.cost)
+                {
+                  continue;
+                }
+              pending.erase (std::make_pair (known->second.cost, e->first));
+            }
+          EtxPath path = from;
+          path.cost = cost;
+          path.hops = from.hops + 1;
+          paths[e->first] = path;
+          pending.insert (std::make_pair (cost, e->first));
+        }
+    }
+
+  // Other interfaces of the nodes reached share their path.
+  const olsr::IfaceAssocSet &assocs = m_state.GetIfaceAssocSet ();
+  for (olsr::IfaceAssocSet::const_iterator a = assocs.begin (); a != assocs.end (); a++)
+    {
+      std::map<Ipv4Address, EtxPath>::const_iterator owner = paths.find (a->mainAddr);
+      if (owner != paths.end () && paths.find (a->ifaceAddr) == paths.end ())
+        {
+          paths[a->ifaceAddr] = owner->second;
+        }
+    }
+}
+
+void
+SOlsrRoutingProtocol::EtxRoutingTableComputation ()
+{
+  std::map<Ipv4Address, EtxPath> paths;
+  FindEtxPaths (false, paths);
+  // The minimum-hop paths only tell how often the metric makes a difference.
+  std::map<Ipv4Address, EtxPath> shortest;
+  FindEtxPaths (true, shortest);
+  Clear ();
+  for (std::map<Ipv4Address, EtxPath>::const_iterator i = paths.begin (); i != paths.end (); i++)
+    {
+      std::map<Ipv4Address, EtxPath>::const_iterator hops = shortest.find (i->first);
+      if (hops != shortest.end () && hops->second.nextAddr != i->second.nextAddr)
+        {
+          m_etxReroutes++;
+        }
+      AddEntry (i->first, i->second.nextAddr, i->second.interface, i->second.hops);
+    }
+  HnaRoutingTableComputation ();
+  NS_LOG_DEBUG ("ETX routing table: " << paths.size () << " entries");
+}
+
+double
+SOlsrRoutingProtocol::GetLinkCost (Ipv4Address neighborIface)
+{
+  Time now = Simulator::Now ();
+  const olsr::LinkTuple *link = m_etx ? m_state.FindSymLinkTuple (neighborIface, now) : NULL;
+  if (link == NULL)
+    {
+      return 1;
+    }
+  return m_linkQuality.GetLinkEtx (link->localIfaceAddr, neighborIface, MainAddressOf (neighborIface), now);
+}
+
+bool
+SOlsrRoutingProtocol::IsEtxEnabled () const
+{
+  return m_etx;
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetEtxReroutes () const
+{
+  return m_etxReroutes;
+}
+
+void
+SOlsrRoutingProtocol::TxFinalDataFailed (Mac48Address address)
+{
+  std::map<Mac48Address, Ipv4Address>::const_iterator i = m_linkMacs.find (address);
+  if (i == m_linkMacs.end () && !m_unmappedLinks.empty ())
+    {
+      // The failed frame was a unicast, so ARP may have resolved a new neighbor.
+      MapLinkMacs ();
+      i = m_linkMacs.find (address);
+    }
+  if (i == m_linkMacs.end ())
+    {
+      return;
+    }
+  Time now = Simulator::Now ();
+  Ipv4Address neighborIface = i->second;
+  const olsr::LinkTuple *link = m_state.FindSymLinkTuple (neighborIface, now);
+  if (link == NULL)
+    {
+      return;
+    }
+  Ipv4Address localIface = link->localIfaceAddr;
+  Time latency = m_linkBreaks.GetLatency ();
+  if (m_linkBreaks.TxFailed (neighborIface, now))
+    {
+      BreakLink (neighborIface, localIface, m_linkBreaks.GetLatency () - latency);
+    }
+}
+
+void
+SOlsrRoutingProtocol::MapLinkMacs ()
+{
+  Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol> ();
+  for (std::set<Ipv4Address>::iterator i = m_unmappedLinks.begin (); i != m_unmappedLinks.end ();)
+    {
+      std::map<Ipv4Address, Ipv4Address>::const_iterator link = m_symLinks.find (*i);
+      int32_t interface = link != m_symLinks.end () ? m_ipv4->GetInterfaceForAddress (link->second) : -1;
+      if (interface < 0)
+        {
+          m_unmappedLinks.erase (i++);
+          continue;
+        }
+      Ptr<ArpCache> arp = l3->GetInterface (interface)->GetArpCache ();
+      ArpCache::Entry *entry = arp != 0 ? arp->Lookup (*i) : 0;
+      if (entry == 0 || !entry->IsAlive ())
+        {
+          i++;
+          continue;
+        }
+      m_linkMacs[Mac48Address::ConvertFrom (entry->GetMacAddress ())] = *i;
+      m_unmappedLinks.erase (i++);
+    }
+}
+
+void
+SOlsrRoutingProtocol::BreakLink (Ipv4Address neighborIface, Ipv4Address localIface, Time latency)
+{
+  Time now = Simulator::Now ();
+  olsr::LinkTuple *link = m_state.FindLinkTuple (neighborIface);
+  if (link == NULL)
+    {
+      return;
+    }
+  m_holdTimeSaved += link->symTime - now;
+  NS_LOG_DEBUG ("Link to " << neighborIface << " broken " << latency.GetSeconds () << "s after the first failure, "
+                << (link->symTime - now).GetSeconds () << "s before its hold time");
+  m_linkBreakTrace (neighborIface, localIface, latency);
+  // Lose the neighbor as the hold time would have: the neighbor loss
+  // recomputes MPRs and routes, and UpdateSymLinks reports the link down.
+  // The link tuple goes too, so its pending timer finds nothing to do;
+  // the next HELLO from the neighbor starts link sensing over.
+  link->symTime = now - NanoSeconds (1);
+  olsr::LinkTuple broken = *link;
+  NeighborLoss (broken);
+  RemoveLinkTuple (broken);
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetLinkBreaks () const
+{
+  return m_linkBreaks.GetBreaks ();
+}
+
+Time
+SOlsrRoutingProtocol::GetLinkBreakLatency () const
+{
+  return m_linkBreaks.GetLatency ();
+}
+
+Time
+SOlsrRoutingProtocol::GetHoldTimeSaved () const
+{
+  return m_holdTimeSaved;
+}
+
+void
+SOlsrRoutingProtocol::RoutingTableComputation ()
+{
+  if (!m_incrementalRoutes || m_etx)
+    {
+      m_routeIndex.Clear ();
+      m_aliasRoutes.clear ();
+      m_topologyEdges.clear ();
+      m_twoHopEdges.clear ();
+      m_twoHopSources.clear ();
+      m_routeIndexSynced = false;
+      if (!m_etx)
+        {
+          RoutingProtocol::RoutingTableComputation ();
+          return;
+        }
+      m_linkQuality.Purge (Simulator::Now ());
+      EtxRoutingTableComputation ();
+      m_routingTableChanged (GetSize ());
+      return;
+    }
+  if (!m_routeIndexSynced)
+    {
+      SyncRouteIndex ();
+    }
+
+  // The same graph the stock computation walks: one hop to every
+  // interface of a symmetric neighbor, then the 2-hop and topology links.
+  // The tuple handlers give the links to the index as they change; only
+  // the direct routes, which follow the link timers, are rebuilt.
+  Time now = Simulator::Now ();
+  std::map<Ipv4Address, SallyRouteIndex::Route> direct;
+  const olsr::LinkSet &links = m_state.GetLinks ();
+  for (olsr::LinkSet::const_iterator i = links.begin (); i != links.end (); i++)
+    {
+      Ipv4Address neighborMain = MainAddressOf (i->neighborIfaceAddr);
+      if (i->time < now || m_state.FindSymNeighborTuple (neighborMain) == NULL)
+        {
+          continue;
+        }
+      SallyRouteIndex::Route route;
+      route.nextAddr = i->neighborIfaceAddr;
+      route.interface = m_ipv4->GetInterfaceForAddress (i->localIfaceAddr);
+      route.distance = 1;
+      direct[i->neighborIfaceAddr] = route;
+      if (direct.find (neighborMain) == direct.end () || direct[neighborMain].nextAddr != neighborMain)
+        {
+          direct[neighborMain] = route;
+        }
+    }
+  UpdateTwoHopSources ();
+  m_routeIndex.Update (direct);
+  m_routesVisited += m_routeIndex.GetVisited ();
+
+  // Other interfaces of the nodes reached share their route.
+  std::map<Ipv4Address, SallyRouteIndex::Route> aliases;
+  const olsr::IfaceAssocSet &assocs = m_state.GetIfaceAssocSet ();
+  for (olsr::IfaceAssocSet::const_iterator a = assocs.begin (); a != assocs.end (); a++)
+    {
+      SallyRouteIndex::Route route;
+      if (!m_routeIndex.Lookup (a->ifaceAddr, route) && m_routeIndex.Lookup (a->mainAddr, route))
+        {
+          aliases[a->ifaceAddr] = route;
+        }
+    }
+
+  const std::vector<Ipv4Address> &changed = m_routeIndex.GetChanged ();
+  for (std::vector<Ipv4Address>::const_iterator i = changed.begin (); i != changed.end (); i++)
+    {
+      SallyRouteIndex::Route route;
+      if (m_routeIndex.Lookup (*i, route))
+        {
+          AddEntry (*i, route.nextAddr, route.interface, route.distance);
+        }
+      else if (aliases.find (*i) == aliases.end ())
+        {
+          RemoveEntry (*i);
+        }
+    }
+  for (std::map<Ipv4Address, SallyRouteIndex::Route>::const_iterator i = m_aliasRoutes.begin (); i != m_aliasRoutes.end (); i++)
+    {
+      SallyRouteIndex::Route route;
+      if (aliases.find (i->first) == aliases.end () && !m_routeIndex.Lookup (i->first, route))
+        {
+          RemoveEntry (i->first);
+        }
+    }
+  for (std::map<Ipv4Address, SallyRouteIndex::Route>::const_iterator i = aliases.begin (); i != aliases.end (); i++)
+    {
+      std::map<Ipv4Address, SallyRouteIndex::Route>::const_iterator old = m_aliasRoutes.find (i->first);
+      if (old == m_aliasRoutes.end () || old->second.nextAddr != i->second.nextAddr
+          || old->second.interface != i->second.interface || old->second.distance != i->second.distance)
+        {
+          AddEntry (i->first, i->second.nextAddr, i->second.interface, i->second.distance);
+        }
+    }
+  m_aliasRoutes.swap (aliases);
+
+  HnaRoutingTableComputation ();
+  NS_LOG_DEBUG ("Incremental routing table: " << changed.size () << " routes changed, "
+                << m_routeIndex.GetVisited () << " visited");
+  m_routingTableChanged (GetSize ());
+}
+
+bool
+SOlsrRoutingProtocol::IsLocalAddress (Ipv4Address address)
+{
+  return address == m_mainAddress || m_ipv4->GetInterfaceForAddress (address) >= 0;
+}
+
+void
+SOlsrRoutingProtocol::SyncRouteIndex ()
+{
+  Clear ();
+  m_routeIndex.Clear ();
+  m_aliasRoutes.clear ();
+  m_topologyEdges.clear ();
+  m_twoHopEdges.clear ();
+  m_twoHopSources.clear ();
+  m_routeIndexSynced = true;
+  const olsr::TwoHopNeighborSet &twoHops = m_state.GetTwoHopNeighbors ();
+  for (olsr::TwoHopNeighborSet::const_iterator t = twoHops.begin (); t != twoHops.end (); t++)
+    {
+      AddTwoHopEdge (t->neighborMainAddr, t->twoHopNeighborAddr);
+    }
+  const olsr::TopologySet &topology = m_state.GetTopologySet ();
+  for (olsr::TopologySet::const_iterator t = topology.begin (); t != topology.end (); t++)
+    {
+      AddTopologyEdge (t->lastAddr, t->destAddr);
+    }
+}
+
+void
+SOlsrRoutingProtocol::AddTopologyEdge (Ipv4Address last, Ipv4Address dest)
+{
+  if (m_routeIndexSynced && !IsLocalAddress (dest) && m_topologyEdges[last].insert (dest).second)
+    {
+      m_routeIndex.AddEdge (last, dest);
+    }
+}
+
+void
+SOlsrRoutingProtocol::RemoveTopologyEdge (Ipv4Address last, Ipv4Address dest)
+{
+  if (!m_routeIndexSynced)
+    {
+      return;
+    }
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator advertised = m_topologyEdges.find (last);
+  if (advertised == m_topologyEdges.end () || advertised->second.erase (dest) == 0)
+    {
+      return;
+    }
+  m_routeIndex.RemoveEdge (last, dest);
+  if (advertised->second.empty ())
+    {
+      m_topologyEdges.erase (advertised);
+    }
+}
+
+void
+SOlsrRoutingProtocol::AddTwoHopEdge (Ipv4Address neighborMain, Ipv4Address twoHop)
+{
+  if (m_routeIndexSynced && !IsLocalAddress (twoHop) && m_twoHopEdges[neighborMain].insert (twoHop).second
+      && m_twoHopSources.find (neighborMain) != m_twoHopSources.end ())
+    {
+      m_routeIndex.AddEdge (neighborMain, twoHop);
+    }
+}
+
+void
+SOlsrRoutingProtocol::RemoveTwoHopEdge (Ipv4Address neighborMain, Ipv4Address twoHop)
+{
+  if (!m_routeIndexSynced)
+    {
+      return;
+    }
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator reached = m_twoHopEdges.find (neighborMain);
+  if (reached == m_twoHopEdges.end () || reached->second.erase (twoHop) == 0)
+    {
+      return;
+    }
+  if (m_twoHopSources.find (neighborMain) != m_twoHopSources.end ())
+    {
+      m_routeIndex.RemoveEdge (neighborMain, twoHop);
+    }
+  if (reached->second.empty ())
+    {
+      m_twoHopEdges.erase (reached);
+    }
+}
+
+void
+SOlsrRoutingProtocol::ReconcileTwoHopEdges (Ipv4Address neighborMain)
+{
+  std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator reached = m_twoHopEdges.find (neighborMain);
+  if (!m_routeIndexSynced || reached == m_twoHopEdges.end ())
+    {
+      return;
+    }
+  std::vector<Ipv4Address> erased;
+  for (std::set<Ipv4Address>::const_iterator t = reached->second.begin (); t != reached->second.end (); t++)
+    {
+      if (m_state.FindTwoHopNeighborTuple (neighborMain, *t) == NULL)
+        {
+          erased.push_back (*t);
+        }
+    }
+  for (std::vector<Ipv4Address>::const_iterator t = erased.begin (); t != erased.end (); t++)
+    {
+      RemoveTwoHopEdge (neighborMain, *t);
+    }
+}
+
+void
+SOlsrRoutingProtocol::UpdateTwoHopSources ()
+{
+  std::set<Ipv4Address> sources;
+  const olsr::NeighborSet &neighbors = m_state.GetNeighbors ();
+  for (olsr::NeighborSet::const_iterator n = neighbors.begin (); n != neighbors.end (); n++)
+    {
+      if (n->status == olsr::NeighborTuple::STATUS_SYM && n->willingness != OLSR_WILL_NEVER)
+        {
+          sources.insert (n->neighborMainAddr);
+        }
+    }
+  for (std::set<Ipv4Address>::const_iterator n = m_twoHopSources.begin (); n != m_twoHopSources.end (); n++)
+    {
+      std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator reached = m_twoHopEdges.find (*n);
+      if (sources.find (*n) != sources.end () || reached == m_twoHopEdges.end ())
+        {
+          continue;
+        }
+      for (std::set<Ipv4Address>::const_iterator t = reached->second.begin (); t != reached->second.end (); t++)
+        {
+          m_routeIndex.RemoveEdge (*n, *t);
+        }
+    }
+  for (std::set<Ipv4Address>::const_iterator n = sources.begin (); n != sources.end (); n++)
+    {
+      std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator reached = m_twoHopEdges.find (*n);
+      if (m_twoHopSources.find (*n) != m_twoHopSources.end () || reached == m_twoHopEdges.end ())
+        {
+          continue;
+        }
+      for (std::set<Ipv4Address>::const_iterator t = reached->second.begin (); t != reached->second.end (); t++)
+        {
+          m_routeIndex.AddEdge (*n, *t);
+        }
+    }
+  m_twoHopSources.swap (sources);
+}
+
+void
+SOlsrRoutingProtocol::ProcessTc (const olsr::MessageHeader &msg,
+                                 const Ipv4Address &senderIface)
+{
+  RoutingProtocol::ProcessTc (msg, senderIface);
+  // A TC with a new ANSN erases the older tuples of its originator
+  // without going through RemoveTopologyTuple.
+  Ipv4Address last = msg.GetOriginatorAddress ();
+  std::map<Ipv4Address, std::set<Ipv4Address> >::const_iterator advertised = m_topologyEdges.find (last);
+  if (!m_routeIndexSynced || advertised == m_topologyEdges.end ())
+    {
+      return;
+    }
+  std::vector<Ipv4Address> erased;
+  for (std::set<Ipv4Address>::const_iterator d = advertised->second.begin (); d != advertised->second.end (); d++)
+    {
+      if (m_state.FindTopologyTuple (*d, last) == NULL)
+        {
+          erased.push_back (*d);
+        }
+    }
+  for (std::vector<Ipv4Address>::const_iterator d = erased.begin (); d != erased.end (); d++)
+    {
+      RemoveTopologyEdge (last, *d);
+    }
+}
+
+void
+SOlsrRoutingProtocol::NeighborLoss (const olsr::LinkTuple &tuple)
+{
+  // Erases the 2-hop tuples through the neighbor without going through
+  // RemoveTwoHopNeighborTuple, then computes the routes.
+  Ipv4Address neighborMain = MainAddressOf (tuple.neighborIfaceAddr);
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator reached = m_twoHopEdges.find (neighborMain);
+  if (reached != m_twoHopEdges.end ())
+    {
+      if (m_twoHopSources.find (neighborMain) != m_twoHopSources.end ())
+        {
+          for (std::set<Ipv4Address>::const_iterator t = reached->second.begin (); t != reached->second.end (); t++)
+            {
+              m_routeIndex.RemoveEdge (neighborMain, *t);
+            }
+        }
+      m_twoHopEdges.erase (reached);
+    }
+  RoutingProtocol::NeighborLoss (tuple);
+}
+
+void
+SOlsrRoutingProtocol::AddTwoHopNeighborTuple (const olsr::TwoHopNeighborTuple &tuple)
+{
+  RoutingProtocol::AddTwoHopNeighborTuple (tuple);
+  AddTwoHopEdge (tuple.neighborMainAddr, tuple.twoHopNeighborAddr);
+}
+
+void
+SOlsrRoutingProtocol::RemoveTwoHopNeighborTuple (const olsr::TwoHopNeighborTuple &tuple)
+{
+  // \p tuple may be the one erased.
+  olsr::TwoHopNeighborTuple removed = tuple;
+  RoutingProtocol::RemoveTwoHopNeighborTuple (tuple);
+  RemoveTwoHopEdge (removed.neighborMainAddr, removed.twoHopNeighborAddr);
+}
+
+void
+SOlsrRoutingProtocol::AddTopologyTuple (const olsr::TopologyTuple &tuple)
+{
+  RoutingProtocol::AddTopologyTuple (tuple);
+  AddTopologyEdge (tuple.lastAddr, tuple.destAddr);
+}
+
+void
+SOlsrRoutingProtocol::RemoveTopologyTuple (const olsr::TopologyTuple &tuple)
+{
+  olsr::TopologyTuple removed = tuple;
+  RoutingProtocol::RemoveTopologyTuple (tuple);
+  RemoveTopologyEdge (removed.lastAddr, removed.destAddr);
+}
+
+void
+SOlsrRoutingProtocol::HnaRoutingTableComputation ()
+{
+  while (m_hnaRoutingTable->GetNRoutes () > 0)
+    {
+      m_hnaRoutingTable->RemoveRoute (0);
+    }
+
+  std::map<Ipv4Address, olsr::RoutingTableEntry> routes;
+  std::vector<olsr::RoutingTableEntry> entries = GetRoutingTableEntries ();
+  for (std::vector<olsr::RoutingTableEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      routes[i->destAddr] = *i;
+    }
+
+  // (network, mask) -> route to its closest gateway, for every network
+  // not announced by this node itself.
+  std::map<std::pair<Ipv4Address, uint32_t>, olsr::RoutingTableEntry> best;
+  const olsr::Associations &local = m_state.GetAssociations ();
+  const olsr::AssociationSet &associations = m_state.GetAssociationSet ();
+  for (olsr::AssociationSet::const_iterator a = associations.begin (); a != associations.end (); a++)
+    {
+      bool announced = false;
+      for (olsr::Associations::const_iterator l = local.begin (); l != local.end () && !announced; l++)
+        {
+          announced = l->networkAddr == a->networkAddr && l->netmask == a->netmask;
+        }
+      std::map<Ipv4Address, olsr::RoutingTableEntry>::const_iterator gateway = routes.find (a->gatewayAddr);
+      if (announced || gateway == routes.end ())
+        {
+          continue;
+        }
+      std::pair<Ipv4Address, uint32_t> network (a->networkAddr, a->netmask.Get ());
+      std::map<std::pair<Ipv4Address, uint32_t>, olsr::RoutingTableEntry>::const_iterator known = best.find (network);
+      if (known == best.end () || gateway->second.distance < known->second.distance)
+        {
+          best[network] = gateway->second;
+        }
+    }
+  for (std::map<std::pair<Ipv4Address, uint32_t>, olsr::RoutingTableEntry>::const_iterator i = best.begin (); i != best.end (); i++)
+    {
+      m_hnaRoutingTable->AddNetworkRouteTo (i->first.first, Ipv4Mask (i->first.second), i->second.nextAddr,
+                                            i->second.interface, i->second.distance);
+    }
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetRoutesVisited () const
+{
+  return m_routesVisited;
+}
+
+void
+SOlsrRoutingProtocol::MprComputation ()
+{
+  if (m_etx)
+    {
+      m_linkQuality.Purge (Simulator::Now ());
+      EtxMprComputation ();
+      return;
+    }
+  if (!m_bitsetMpr)
+    {
+      RoutingProtocol::MprComputation ();
+      return;
+    }
+  olsr::MprSet mprSet = m_mprSelector.Compute (m_state.GetNeighbors (), m_state.GetTwoHopNeighbors (), m_mainAddress);
+  NS_LOG_DEBUG ("Bitset MPR computation: " << mprSet.size () << " MPRs for "
+                << m_mprSelector.GetTwoHopCount () << " 2-hop neighbors");
+  m_state.SetMprSet (mprSet);
+}
+
+void
+SOlsrRoutingProtocol::RecvOlsr (Ptr<Socket> socket)
+{
+  if (!m_indexedDuplicates)
+    {
+      RoutingProtocol::RecvOlsr (socket);
+      return;
+    }
+  Address sourceAddress;
+  Ptr<Packet> packet = socket->RecvFrom (sourceAddress);
+  uint32_t size = packet->GetSize ();
+  Ipv4Address senderIface = InetSocketAddress::ConvertFrom (sourceAddress).GetIpv4 ();
+  Ipv4Address receiverIface = m_socketAddresses[socket].GetLocal ();
+
+  olsr::PacketHeader packetHeader;
+  packet->RemoveHeader (packetHeader);
+  NS_ASSERT (packetHeader.GetPacketLength () >= packetHeader.GetSerializedSize ());
+  uint32_t sizeLeft = packetHeader.GetPacketLength () - packetHeader.GetSerializedSize ();
+  olsr::MessageList messages;
+  while (sizeLeft > 0)
+    {
+      olsr::MessageHeader message;
+      if (packet->RemoveHeader (message) == 0)
+        {
+          NS_LOG_WARN ("Truncated OLSR packet from " << senderIface);
+          break;
+        }
+      sizeLeft -= message.GetSerializedSize ();
+      messages.push_back (message);
+    }
+  m_rxPacketTrace (size, packetHeader, messages);
+
+  Time now = Simulator::Now ();
+  for (olsr::MessageList::const_iterator m = messages.begin (); m != messages.end (); m++)
+    {
+      if (m->GetTimeToLive () == 0 || m->GetOriginatorAddress () == m_mainAddress)
+        {
+          continue;
+        }
+      SallyDuplicateSet::Tuple *duplicated = m_duplicates.Find (m->GetOriginatorAddress (),
+                                                                m->GetMessageSequenceNumber (), now);
+      bool forward = true;
+      if (duplicated == 0)
+        {
+          switch (m->GetMessageType ())
+            {
+            case olsr::MessageHeader::HELLO_MESSAGE:
+              ProcessHello (*m, receiverIface, senderIface);
+              break;
+            case olsr::MessageHeader::TC_MESSAGE:
+              ProcessTc (*m, senderIface);
+              break;
+            case olsr::MessageHeader::MID_MESSAGE:
+              ProcessMid (*m, senderIface);
+              break;
+            case olsr::MessageHeader::HNA_MESSAGE:
+              ProcessHna (*m, senderIface);
+              break;
+            default:
+              NS_LOG_DEBUG ("OLSR message type " << int (m->GetMessageType ()) << " not implemented");
+            }
+        }
+      else
+        {
+          // Not forwarded again if already considered on this interface.
+          forward = std::find (duplicated->ifaceList.begin (), duplicated->ifaceList.end (), receiverIface)
+            == duplicated->ifaceList.end ();
+        }
+      // HELLOs are never forwarded.
+      if (forward && m->GetMessageType () != olsr::MessageHeader::HELLO_MESSAGE)
+        {
+          ForwardIndexed (*m, duplicated, receiverIface, senderIface);
+        }
+    }
+  RoutingTableComputation ();
+}
+
+void
+SOlsrRoutingProtocol::ForwardIndexed (olsr::MessageHeader message, SallyDuplicateSet::Tuple *duplicated,
+                                      Ipv4Address localIface, Ipv4Address senderIface)
+{
+  Time now = Simulator::Now ();
+  if (m_state.FindSymLinkTuple (senderIface, now) == NULL
+      || (duplicated != 0 && duplicated->retransmitted))
+    {
+      return;
+    }
+  bool retransmitted = false;
+  if (message.GetTimeToLive () > 1 && m_state.FindMprSelectorTuple (MainAddressOf (senderIface)) != NULL)
+    {
+      message.SetTimeToLive (message.GetTimeToLive () - 1);
+      message.SetHopCount (message.GetHopCount () + 1);
+      QueueMessage (message, Seconds (m_scopedTcJitter->GetValue (0, m_helloInterval.GetSeconds () / 4)));
+      retransmitted = true;
+    }
+  if (duplicated == 0)
+    {
+      duplicated = &m_duplicates.Insert (message.GetOriginatorAddress (), message.GetMessageSequenceNumber (), now);
+    }
+  else
+    {
+      m_duplicates.Refresh (*duplicated, now);
+    }
+  duplicated->retransmitted = retransmitted;
+  duplicated->ifaceList.push_back (localIface);
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetDuplicateTimersSaved () const
+{
+  return m_duplicates.GetInserted ();
+}
+
+void
+SOlsrRoutingProtocol::LinkTupleTimerExpire (Ipv4Address neighborIfaceAddr)
+{
+  if (!m_indexedLinks)
+    {
+      RoutingProtocol::LinkTupleTimerExpire (neighborIfaceAddr);
+      return;
+    }
+  // Link sensing schedules the first timer of a new link as an event.
+  RunLinkTimer (neighborIfaceAddr);
+}
+
+void
+SOlsrRoutingProtocol::RunLinkTimer (Ipv4Address neighborIfaceAddr)
+{
+  Time now = Simulator::Now ();
+  olsr::LinkTuple *tuple = m_state.FindLinkTuple (neighborIfaceAddr);
+  if (tuple == NULL)
+    {
+      return;
+    }
+  if (tuple->time < now)
+    {
+      RemoveLinkTuple (*tuple);
+    }
+  else if (tuple->symTime < now)
+    {
+      if (m_linkTupleTimerFirstTime)
+        {
+          m_linkTupleTimerFirstTime = false;
+        }
+      else
+        {
+          NeighborLoss (*tuple);
+        }
+      ScheduleLinkTimer (neighborIfaceAddr, tuple->time);
+    }
+  else
+    {
+      ScheduleLinkTimer (neighborIfaceAddr, std::min (tuple->time, tuple->symTime));
+    }
+}
+
+void
+SOlsrRoutingProtocol::ScheduleLinkTimer (Ipv4Address neighborIfaceAddr, Time deadline)
+{
+  m_linkIndex.ScheduleTimer (neighborIfaceAddr, deadline);
+  ArmLinkWheel ();
+}
+
+void
+SOlsrRoutingProtocol::LinkWheelExpire ()
+{
+  m_linkWheelTicks++;
+  std::vector<Ipv4Address> due;
+  m_linkIndex.ExpireTimers (Simulator::Now (), due);
+  for (std::vector<Ipv4Address>::const_iterator i = due.begin (); i != due.end (); i++)
+    {
+      RunLinkTimer (*i);
+    }
+  ArmLinkWheel ();
+}
+
+void
+SOlsrRoutingProtocol::ArmLinkWheel ()
+{
+  Time end;
+  if (!m_linkIndex.GetNextTimerSlot (end))
+    {
+      return;
+    }
+  Time delay = std::max (end - Simulator::Now (), Seconds (0));
+  if (m_linkWheel.IsRunning () && m_linkWheel.GetDelayLeft () <= delay)
+    {
+      return;
+    }
+  m_linkWheel.Cancel ();
+  m_linkWheel.Schedule (delay);
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetLinkTimersSaved () const
+{
+  uint32_t timers = m_linkIndex.GetTimersScheduled ();
+  return timers > m_linkWheelTicks ? timers - m_linkWheelTicks : 0;
+}
+
+void
+SOlsrRoutingProtocol::SetDivertCallback (DivertCallback divert)
+{
+  m_divert = divert;
+}
+
+bool
+SOlsrRoutingProtocol::DivertPacket (Ptr<Packet> packet, const Ipv4InterfaceAddress &iface, Ipv4Address destination)
+{
+  return !m_divert.IsNull () && m_divert (packet, iface.GetLocal (), destination, OLSR_PORT_NUMBER);
+}
+
+void
+SOlsrRoutingProtocol::QueueMessage (const olsr::MessageHeader &message, Time delay)
+{
+  if (message.GetMessageType () != olsr::MessageHeader::HELLO_MESSAGE
+      || message.GetOriginatorAddress () != m_mainAddress || (!m_compactHello && !m_etx))
+    {
+      RoutingProtocol::QueueMessage (message, delay);
+      return;
+    }
+  olsr::MessageHeader hello = m_compactHello ? m_helloCodec.Encode (message) : message;
+  if (m_etx)
+    {
+      SallyLinkQuality::WriteReport (hello, m_linkQuality.GetReverseRatios (Simulator::Now ()));
+    }
+  RoutingProtocol::QueueMessage (hello, delay);
+}
+
+void
+SOlsrRoutingProtocol::ProcessHello (const olsr::MessageHeader &msg,
+                                    const Ipv4Address &receiverIface,
+                                    const Ipv4Address &senderIface)
+{
+  m_linkBreaks.Heard (senderIface);
+  if (m_etx)
+    {
+      Time now = Simulator::Now ();
+      m_linkQuality.HelloReceived (senderIface, msg.GetHello ().GetHTime (), now);
+      std::map<Ipv4Address, double> ratios;
+      if (SallyLinkQuality::ReadReport (msg, ratios))
+        {
+          m_linkQuality.SetReport (msg.GetOriginatorAddress (), ratios, now);
+        }
+    }
+  olsr::MessageHeader expanded = msg;
+  switch (m_helloCodec.Decode (expanded))
+    {
+    case SallyHelloCodec::EXPANDED:
+      RoutingProtocol::ProcessHello (expanded, receiverIface, senderIface);
+      break;
+    case SallyHelloCodec::PLAIN:
+      RoutingProtocol::ProcessHello (msg, receiverIface, senderIface);
+      break;
+    case SallyHelloCodec::STALE:
+      return;
+    }
+  // The 2-hop neighbors the HELLO reports lost are erased without going
+  // through RemoveTwoHopNeighborTuple.
+  ReconcileTwoHopEdges (msg.GetOriginatorAddress ());
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetFullHellos () const
+{
+  return m_helloCodec.GetFullHellos ();
+}
+
+uint32_t
+SOlsrRoutingProtocol::GetDeltaHellos () const
+{
+  return m_helloCodec.GetDeltaHellos ();
+}
+
+int64_t
+SOlsrRoutingProtocol::GetHelloBytesSaved () const
+{
+  return m_helloCodec.GetBytesSaved ();
+}
+
 void
 SOlsrRoutingProtocol::SendTc()
 {
@@ -40,7 +1636,7 @@ SOlsrRoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
   NS_ASSERT (ipv4 != 0);
   NS_ASSERT (m_ipv4 == 0);
   NS_LOG_DEBUG ("Created olsr::RoutingProtocol");
-  m_helloTimer.SetFunction (&RoutingProtocol::HelloTimerExpire, this);
+  m_helloTimer.SetFunction (&SOlsrRoutingProtocol::AdaptiveHelloTimerExpire, this);
   m_tcTimer.SetFunction (&RoutingProtocol::TcTimerExpire, this);
   m_midTimer.SetFunction (&RoutingProtocol::MidTimerExpire, this);
   m_hnaTimer.SetFunction (&RoutingProtocol::HnaTimerExpire, this);
@@ -55,6 +1651,8 @@ SOlsrRoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
   m_ipv4 = ipv4;
 
   m_hnaRoutingTable->SetIpv4 (ipv4);
+
+  TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&SOlsrRoutingProtocol::RoutingTableChanged, this));
 }
 } // namespace olsr
 } // namespace ns3
@@ -2,6 +2,21 @@
 #define SALLY_AGENT_IMPL_H
 
 #include "ns3/olsr-routing-protocol.h"
+#include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
+#include "ns3/random-variable-stream.h"
+#include "sally-hello-codec.h"
+#include "sally-link-quality.h"
+#include "sally-link-break-detector.h"
+#include "sally-route-index.h"
+#include "sally-mpr-selector.h"
+#include "sally-duplicate-set.h"
+#include "sally-link-index.h"
+#include "ns3/mac48-address.h"
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace ns3 {
 namespace sally {
@@ -15,9 +30,300 @@ class SOlsrRoutingProtocol: public ns3::olsr::RoutingProtocol
 {
         public:
          static TypeId GetTypeId (void);
+         SOlsrRoutingProtocol ();
 	     virtual void SetIpv4 (Ptr<Ipv4> ipv4);
          virtual void SendTc ();
 
+         /**
+          * Assign a fixed random variable stream number to the random
+          * variables used by OLSR and by this model.
+          *
+          * \param stream first stream index to use
+          * \return the number of stream indices assigned by this model
+          */
+         int64_t AssignStreams (int64_t stream);
+
+         /// Overridden to report changes of the MPR selector set.
+         virtual void AddMprSelectorTuple (const olsr::MprSelectorTuple &tuple);
+         virtual void RemoveMprSelectorTuple (const olsr::MprSelectorTuple &tuple);
+
+         /// \returns false if \p neighbor is a symmetric neighbor that did
+         /// not select this node as MPR, i.e. if MPR flooding would not
+         /// relay a message received from it
+         bool RelaysFor (Ipv4Address neighbor);
+
+         /**
+          * Looks for paths to the destinations \p dsts that avoid
+          * \p brokenHop, either in the routing table or through another
+          * neighbor that has the destination as 2-hop neighbor.  One pass
+          * over the routing table serves every destination.
+          *
+          * \returns the route to use for each destination that has one
+          */
+         std::map<Ipv4Address, Ptr<Ipv4Route> > RepairRoutes (const std::set<Ipv4Address> &dsts,
+                                                              Ipv4Address brokenHop);
+
+         /// Offered every packet about to be broadcast, with the local
+         /// address, destination and UDP port; returns false if the
+         /// packet must still be sent on its own.
+         typedef Callback<bool, Ptr<const Packet>, Ipv4Address, Ipv4Address, uint16_t> DivertCallback;
+         void SetDivertCallback (DivertCallback divert);
+         virtual bool DivertPacket (Ptr<Packet> packet, const Ipv4InterfaceAddress &iface, Ipv4Address destination);
+
+         /// Overridden to send our HELLOs in compact form.
+         virtual void QueueMessage (const olsr::MessageHeader &message, Time delay);
+         /// Overridden to expand compact HELLOs before OLSR processes them.
+         virtual void ProcessHello (const olsr::MessageHeader &msg,
+                                    const Ipv4Address &receiverIface,
+                                    const Ipv4Address &senderIface);
+
+         /// \returns the number of HELLOs sent with the full neighbor set
+         uint32_t GetFullHellos () const;
+         /// \returns the number of HELLOs sent as neighbor set deltas
+         uint32_t GetDeltaHellos () const;
+         /// \returns the HELLO bytes the deltas saved
+         int64_t GetHelloBytesSaved () const;
+
+         /// \returns the ETX of the symmetric link to \p neighborIface,
+         /// or 1 without one or when the ETX metric is off
+         double GetLinkCost (Ipv4Address neighborIface);
+         /// \returns true if MPRs and routes minimize the ETX
+         bool IsEtxEnabled () const;
+         /// \returns how often the ETX metric picked another next hop than the hop count
+         uint32_t GetEtxReroutes () const;
+
+         /// \returns the number of links broken on transmit failures
+         uint32_t GetLinkBreaks () const;
+         /// \returns the summed time from the first failed frame to each break
+         Time GetLinkBreakLatency () const;
+         /// \returns the summed hold time left on the links broken early
+         Time GetHoldTimeSaved () const;
+
+         /// Overridden to update only the routes a topology change affects,
+         /// or to compute least-ETX routes.
+         virtual void RoutingTableComputation ();
+         /// Overridden to feed the edges of the 2-hop neighbor and topology
+         /// sets to the route index as they change.
+         virtual void ProcessTc (const olsr::MessageHeader &msg,
+                                 const Ipv4Address &senderIface);
+         virtual void NeighborLoss (const olsr::LinkTuple &tuple);
+         virtual void AddTwoHopNeighborTuple (const olsr::TwoHopNeighborTuple &tuple);
+         virtual void RemoveTwoHopNeighborTuple (const olsr::TwoHopNeighborTuple &tuple);
+         virtual void AddTopologyTuple (const olsr::TopologyTuple &tuple);
+         virtual void RemoveTopologyTuple (const olsr::TopologyTuple &tuple);
+         /// \returns the number of destinations the incremental computation revisited
+         uint32_t GetRoutesVisited () const;
+
+         /// Overridden to select the MPRs on coverage bitsets, or by ETX.
+         virtual void MprComputation ();
+
+         /// Overridden to look duplicates up in SallyDuplicateSet.
+         virtual void RecvOlsr (Ptr<Socket> socket);
+         /// \returns the duplicate tuples whose expiry took no simulator event
+         uint32_t GetDuplicateTimersSaved () const;
+
+         /// Overridden to run the timers of the links after their first
+         /// one from the wheel of SallyLinkIndex.
+         virtual void LinkTupleTimerExpire (Ipv4Address neighborIfaceAddr);
+         /// \returns the link timers set on the wheel, less the events that ran it
+         uint32_t GetLinkTimersSaved () const;
+
+         /// \returns the number of times the coalesced protocol tick ran
+         uint32_t GetProtocolTicks () const;
+
+        protected:
+         virtual void DoInitialize (void);
+
+        private:
+         /// Best path found by EtxRoutingTableComputation.
+         struct EtxPath
+         {
+           double cost;
+           uint32_t hops;
+           Ipv4Address nextAddr;
+           uint32_t interface;
+         };
+
+         /// Parses ScopedTcRadii / ScopedTcIntervals into the ring tables.
+         void ConfigureScopedTc ();
+         /// Sends one TC scoped to the outermost ring that is due and
+         /// reschedules m_scopedTcTimer for the next due ring.
+         void ScopedTcTimerExpire ();
+         /// Sends one TC scoped to the outermost ring that is due.
+         /// \returns the time the next ring is due
+         Time SendScopedTc ();
+         /// Adapts m_helloInterval to the link churn, then sends a HELLO.
+         void AdaptiveHelloTimerExpire ();
+         /// Adapts m_helloInterval to the link churn if AdaptiveHello is set.
+         void AdaptHelloInterval ();
+         /// Sends every periodic message that is due, then waits for the next one.
+         void ProtocolTick ();
+         /// Schedules m_protocolTick for the earliest duty that does any work.
+         void ScheduleProtocolTick ();
+         /// \returns true if MID messages have an interface address to declare
+         bool HasMidAddresses ();
+         /// Compares the symmetric links with the previous snapshot and
+         /// reports every link that appeared or disappeared.
+         void UpdateSymLinks ();
+         /// Catches selectors erased in bulk by NeighborLoss and link set
+         /// changes, which are always followed by a routing table computation.
+         void RoutingTableChanged (uint32_t size);
+         /// Fires m_mprSelectorsChangedTrace if the selector count changed.
+         void CheckMprSelectors ();
+         /// \returns the main address of the node owning \p iface
+         Ipv4Address MainAddressOf (Ipv4Address iface);
+         /// \returns the ETX of the best symmetric link to the neighbor \p neighborMain
+         double NeighborEtx (Ipv4Address neighborMain);
+         /// Replaces the MPR set with, for every strict 2-hop neighbor,
+         /// the neighbor on its path of least ETX.
+         void EtxMprComputation ();
+         /// Finds the least-ETX path to every node known, or the
+         /// minimum-hop one if \p hopCount is set.
+         void FindEtxPaths (bool hopCount, std::map<Ipv4Address, EtxPath> &paths);
+         /// Fills the routing table with the least-ETX paths, in place of
+         /// the minimum-hop computation.
+         void EtxRoutingTableComputation ();
+         /// Attached to the MacTxFinalDataFailed trace of every wifi interface.
+         void TxFinalDataFailed (Mac48Address address);
+         /// Moves the symmetric links whose neighbor ARP resolved since
+         /// from m_unmappedLinks to m_linkMacs.
+         void MapLinkMacs ();
+         /// Drops the link to \p neighborIface before its hold time expires.
+         void BreakLink (Ipv4Address neighborIface, Ipv4Address localIface, Time latency);
+         /// \returns true if \p address is one of ours, which needs no route
+         bool IsLocalAddress (Ipv4Address address);
+         /// Rebuilds m_routeIndex and the edges fed to it from the OLSR state.
+         void SyncRouteIndex ();
+         void AddTopologyEdge (Ipv4Address last, Ipv4Address dest);
+         void RemoveTopologyEdge (Ipv4Address last, Ipv4Address dest);
+         void AddTwoHopEdge (Ipv4Address neighborMain, Ipv4Address twoHop);
+         void RemoveTwoHopEdge (Ipv4Address neighborMain, Ipv4Address twoHop);
+         /// Drops the edges to the 2-hop neighbors of \p neighborMain the
+         /// OLSR state no longer has.
+         void ReconcileTwoHopEdges (Ipv4Address neighborMain);
+         /// Gives the index the 2-hop edges of the neighbors that became
+         /// usable as first hop, and takes those of the others back.
+         void UpdateTwoHopSources ();
+         /// Recomputes the HNA routes over the current routing table.
+         void HnaRoutingTableComputation ();
+         /// The default forwarding algorithm of OLSR on m_duplicates.
+         void ForwardIndexed (olsr::MessageHeader message, SallyDuplicateSet::Tuple *duplicated,
+                              Ipv4Address localIface, Ipv4Address senderIface);
+         /// The stock link timer, which sets the next one on the wheel.
+         void RunLinkTimer (Ipv4Address neighborIfaceAddr);
+         void ScheduleLinkTimer (Ipv4Address neighborIfaceAddr, Time deadline);
+         /// Runs the link timers of every wheel slot that ended.
+         void LinkWheelExpire ();
+         /// Schedules m_linkWheel for the end of the earliest slot holding a timer.
+         void ArmLinkWheel ();
+
+         uint32_t m_mprSelectorCount;
+         /// Reports the new size of the MPR selector set.
+         TracedCallback<uint32_t> m_mprSelectorsChangedTrace;
+
+         /// Whether TCs are sent in TTL-scoped rings instead of not at all.
+         bool m_scopedTc;
+         std::string m_scopedTcRadii;
+         std::string m_scopedTcIntervals;
+         /// TTL of each ring, innermost first.
+         std::vector<uint8_t> m_ringRadius;
+         /// Emission interval of each ring.
+         std::vector<Time> m_ringInterval;
+         /// Next time each ring is due.
+         std::vector<Time> m_ringDue;
+         /// Time until which nodes in each ring may still hold topology
+         /// edges we advertised; empty TCs are sent to them until then.
+         std::vector<Time> m_ringAdvertised;
+         Timer m_scopedTcTimer;
+         Ptr<UniformRandomVariable> m_scopedTcJitter;
+
+         /// Whether the HELLO interval follows the link churn.
+         bool m_adaptiveHello;
+         Time m_helloMinInterval;
+         Time m_helloMaxInterval;
+         /// Number of HELLO periods the churn rate is averaged over.
+         uint32_t m_helloChurnWindow;
+         /// Link changes tolerated per HELLO interval.
+         double m_helloChurnTarget;
+         /// (link changes, seconds) of the last m_helloChurnWindow periods.
+         std::deque<std::pair<uint32_t, double> > m_churnSamples;
+         /// Symmetric links seen at the previous update: neighbor
+         /// interface address -> local interface address.
+         std::map<Ipv4Address, Ipv4Address> m_symLinks;
+         /// Symmetric links that appeared or disappeared so far.
+         uint32_t m_linkChanges;
+         uint32_t m_linkChangesAtLastHello;
+         /// Reports a symmetric link (neighbor, local address) going up or down.
+         TracedCallback<Ipv4Address, Ipv4Address, bool> m_neighborChangedTrace;
+         Time m_lastHello;
+         TracedValue<Time> m_currentHelloInterval;
+         DivertCallback m_divert;
+
+         /// Whether HELLOs carry neighbor set deltas between full refreshes.
+         bool m_compactHello;
+         uint32_t m_compactHelloRefresh;
+         SallyHelloCodec m_helloCodec;
+
+         /// Whether MPRs and routes minimize the ETX instead of the hop count.
+         bool m_etx;
+         Time m_etxWindow;
+         SallyLinkQuality m_linkQuality;
+         uint32_t m_etxReroutes;
+
+         uint32_t m_linkFailureThreshold;
+         Time m_linkFailureWindow;
+         SallyLinkBreakDetector m_linkBreaks;
+         /// Neighbor interface address of the symmetric links, by MAC address.
+         std::map<Mac48Address, Ipv4Address> m_linkMacs;
+         /// Symmetric links whose neighbor ARP did not resolve yet.
+         std::set<Ipv4Address> m_unmappedLinks;
+         Time m_holdTimeSaved;
+         /// Reports a link (neighbor, local address) broken on transmit
+         /// failures, and the time since the first failed frame.
+         TracedCallback<Ipv4Address, Ipv4Address, Time> m_linkBreakTrace;
+
+         /// Whether routes are updated from an indexed graph instead of rebuilt.
+         bool m_incrementalRoutes;
+         SallyRouteIndex m_routeIndex;
+         /// Whether the routing table holds exactly what m_routeIndex and
+         /// m_aliasRoutes describe.
+         bool m_routeIndexSynced;
+         /// Routes to the other interfaces of the nodes reached.
+         std::map<Ipv4Address, SallyRouteIndex::Route> m_aliasRoutes;
+         /// Edges known to m_routeIndex: the destinations advertised by
+         /// each TC originator, and the 2-hop neighbors reached through
+         /// each neighbor, which only count while it is a symmetric and
+         /// willing neighbor in m_twoHopSources.
+         std::map<Ipv4Address, std::set<Ipv4Address> > m_topologyEdges;
+         std::map<Ipv4Address, std::set<Ipv4Address> > m_twoHopEdges;
+         std::set<Ipv4Address> m_twoHopSources;
+         uint32_t m_routesVisited;
+
+         /// Whether MPRs are selected by SallyMprSelector instead of the stock code.
+         bool m_bitsetMpr;
+         SallyMprSelector m_mprSelector;
+
+         /// Whether duplicates are kept in m_duplicates instead of the OLSR state.
+         bool m_indexedDuplicates;
+         SallyDuplicateSet m_duplicates;
+
+         /// Whether link lookups and link timers go through m_linkIndex.
+         bool m_indexedLinks;
+         SallyLinkIndex m_linkIndex;
+         Timer m_linkWheel;
+         uint32_t m_linkWheelTicks;
+
+         /// Whether one timer sends the HELLO, MID, HNA and scoped TC
+         /// messages instead of a timer each.
+         bool m_coalescedTimers;
+         Timer m_protocolTick;
+         Time m_nextHello;
+         Time m_nextMid;
+         Time m_nextHna;
+         Time m_nextScopedTc;
+         Time m_midEmissionInterval;
+         Time m_hnaEmissionInterval;
+         uint32_t m_protocolTicks;
 };
 
 }
@@ -1,10 +1,42 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
 // Include a header file from your module to test.
-#include "ns3/sally-routing-protocol.h"
+#include "ns3/sally-routing.h"
+#include "ns3/sally-route-cache.h"
+#include "ns3/sally-neighbor-sensing.h"
+#include "ns3/sally-deferral-queue.h"
+#include "ns3/sally-negative-cache.h"
+#include "ns3/sally-control-aggregator.h"
+#include "ns3/sally-hello-codec.h"
+#include "ns3/sally-link-quality.h"
+#include "ns3/sally-link-break-detector.h"
+#include "ns3/sally-route-index.h"
+#include "ns3/sally-mpr-selector.h"
+#include "ns3/sally-duplicate-set.h"
+#include "ns3/sally-link-index.h"
+#include "ns3/solsr-routing-protocol.h"
+#include "ns3/sally-helper.h"
+#include "ns3/saodv-helper.h"
+#include "ns3/saodv-routing-protocol.h"
+#include "ns3/aodv-packet.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/socket.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
@@ -46,6 +78,1229 @@ SallyTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Checks that the forwarding cache hands back stored routes and forgets
+// all of them when its generation is bumped.
+class SallyRouteCacheTestCase : public TestCase
+{
+public:
+  SallyRouteCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyRouteCacheTestCase::SallyRouteCacheTestCase ()
+  : TestCase ("Sally forwarding cache lookup and invalidation")
+{
+}
+
+void
+SallyRouteCacheTestCase::DoRun (void)
+{
+  SallyRouteCache cache;
+  cache.Resize (5);
+  NS_TEST_ASSERT_MSG_EQ (cache.GetCapacity (), 8, "capacity is not rounded up to a power of two");
+
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (Ipv4Address ("10.1.1.7"));
+  route->SetGateway (Ipv4Address ("10.1.1.2"));
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.1.7"), 0), 0, "empty cache returned a route");
+
+  cache.Insert (Ipv4Address ("10.1.1.7"), 0, route);
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.1.7"), 0), route, "stored route not found");
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.1.8"), 0), 0, "unexpected hit for another destination");
+
+  // Storing the route again replaces the entry along with its owner.
+  uint8_t owner = 0;
+  cache.Insert (Ipv4Address ("10.1.1.7"), 0, route, 3);
+  NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address ("10.1.1.7"), 0, owner), route, "replaced route not found");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) owner, 3, "owner tag not kept");
+
+  // Fill well beyond capacity; lookups must never return a wrong route.
+  for (uint32_t i = 1; i < 64; i++)
+    {
+      Ptr<Ipv4Route> other = Create<Ipv4Route> ();
+      other->SetDestination (Ipv4Address (0x0a020000 + i));
+      cache.Insert (Ipv4Address (0x0a020000 + i), 0, other);
+      Ptr<Ipv4Route> found = cache.Lookup (Ipv4Address (0x0a020000 + i), 0);
+      NS_TEST_ASSERT_MSG_EQ (found, other, "freshly inserted route not found");
+    }
+
+  cache.Invalidate ();
+  for (uint32_t i = 1; i < 64; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (cache.Lookup (Ipv4Address (0x0a020000 + i), 0), 0, "route survived invalidation");
+    }
+  NS_TEST_ASSERT_MSG_EQ (cache.GetHits (), 65, "wrong hit count");
+}
+
+// Checks which RREQ senders a SALLY node relays for under MPR flooding.
+class SallyMprRelayTestCase : public TestCase
+{
+public:
+  SallyMprRelayTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyMprRelayTestCase::SallyMprRelayTestCase ()
+  : TestCase ("Sally MPR-restricted RREQ relaying")
+{
+}
+
+void
+SallyMprRelayTestCase::DoRun (void)
+{
+  Ptr<sally::SOlsrRoutingProtocol> solsr = CreateObject<sally::SOlsrRoutingProtocol> ();
+
+  olsr::NeighborTuple selector;
+  selector.neighborMainAddr = Ipv4Address ("10.1.1.2");
+  selector.status = olsr::NeighborTuple::STATUS_SYM;
+  solsr->m_state.InsertNeighborTuple (selector);
+  olsr::MprSelectorTuple mprSelector;
+  mprSelector.mainAddr = selector.neighborMainAddr;
+  solsr->m_state.InsertMprSelectorTuple (mprSelector);
+
+  olsr::NeighborTuple other;
+  other.neighborMainAddr = Ipv4Address ("10.1.1.3");
+  other.status = olsr::NeighborTuple::STATUS_SYM;
+  solsr->m_state.InsertNeighborTuple (other);
+
+  NS_TEST_ASSERT_MSG_EQ (solsr->RelaysFor (Ipv4Address ("10.1.1.2")), true, "RREQ from an MPR selector not relayed");
+  NS_TEST_ASSERT_MSG_EQ (solsr->RelaysFor (Ipv4Address ("10.1.1.3")), false, "RREQ from a non-selector relayed");
+  NS_TEST_ASSERT_MSG_EQ (solsr->RelaysFor (Ipv4Address ("10.1.1.4")), true, "RREQ from an unknown neighbor not relayed");
+  solsr->Dispose ();
+}
+
+// Checks that the shared neighbor table tracks SOLSR link events and
+// ignores the loss of links it never saw.
+class SallyNeighborSensingTestCase : public TestCase
+{
+public:
+  SallyNeighborSensingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyNeighborSensingTestCase::SallyNeighborSensingTestCase ()
+  : TestCase ("Sally shared neighbor sensing")
+{
+}
+
+void
+SallyNeighborSensingTestCase::DoRun (void)
+{
+  SallyNeighborSensing sensing;
+  Ipv4Address local ("10.1.1.1");
+  sensing.NotifyNeighborUp (Ipv4Address ("10.1.1.2"), local);
+  sensing.NotifyNeighborUp (Ipv4Address ("10.1.1.3"), local);
+  NS_TEST_ASSERT_MSG_EQ (sensing.GetNNeighbors (), 2, "neighbors not recorded");
+  NS_TEST_ASSERT_MSG_EQ (sensing.IsNeighbor (Ipv4Address ("10.1.1.3")), true, "neighbor not found");
+
+  sensing.NotifyNeighborDown (Ipv4Address ("10.1.1.3"), local);
+  sensing.NotifyNeighborDown (Ipv4Address ("10.1.1.4"), local);
+  NS_TEST_ASSERT_MSG_EQ (sensing.IsNeighbor (Ipv4Address ("10.1.1.3")), false, "lost neighbor still recorded");
+  NS_TEST_ASSERT_MSG_EQ (sensing.GetNNeighbors (), 1, "wrong neighbor count");
+  NS_TEST_ASSERT_MSG_EQ (sensing.GetNEvents (), 3, "unknown neighbor loss was passed on");
+}
+
+// Checks the bounds of the deferral queue and that packets leave it
+// either along a route or through their error callback.
+class SallyDeferralQueueTestCase : public TestCase
+{
+public:
+  SallyDeferralQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header &header);
+  void Error (Ptr<const Packet> p, const Ipv4Header &header, Socket::SocketErrno err);
+
+  uint32_t m_forwarded;
+  uint32_t m_errors;
+};
+
+SallyDeferralQueueTestCase::SallyDeferralQueueTestCase ()
+  : TestCase ("Sally deferral queue limits, release and expiry"),
+    m_forwarded (0),
+    m_errors (0)
+{
+}
+
+void
+SallyDeferralQueueTestCase::Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header &header)
+{
+  NS_TEST_EXPECT_MSG_EQ (route->GetDestination (), header.GetDestination (), "packet released along the wrong route");
+  m_forwarded++;
+}
+
+void
+SallyDeferralQueueTestCase::Error (Ptr<const Packet> p, const Ipv4Header &header, Socket::SocketErrno err)
+{
+  m_errors++;
+}
+
+void
+SallyDeferralQueueTestCase::DoRun (void)
+{
+  SallyDeferralQueue queue;
+  queue.SetCapacity (4);
+  queue.SetPerDestinationLimit (3);
+  queue.SetTimeout (Seconds (1));
+  SallyDeferralQueue::UnicastForwardCallback ucb = MakeCallback (&SallyDeferralQueueTestCase::Forward, this);
+  SallyDeferralQueue::ErrorCallback ecb = MakeCallback (&SallyDeferralQueueTestCase::Error, this);
+
+  Ipv4Header toA;
+  toA.SetDestination (Ipv4Address ("10.1.1.7"));
+  Ipv4Header toB;
+  toB.SetDestination (Ipv4Address ("10.1.1.8"));
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), toA, ucb, ecb), true, "packet refused below the limit");
+    }
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), toA, ucb, ecb), false, "per-destination limit not enforced");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), toB, ucb, ecb), true, "packet refused with a free slot");
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), toB, ucb, ecb), false, "full pool not detected");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDropsLimit (), 1, "wrong per-destination drop count");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDropsFull (), 1, "wrong full drop count");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetSize (), 4, "wrong queue size");
+
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (toA.GetDestination ());
+  NS_TEST_ASSERT_MSG_EQ (queue.Release (toA.GetDestination (), route), 3, "not all packets released");
+  NS_TEST_ASSERT_MSG_EQ (m_forwarded, 3, "released packets not forwarded");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetSize (toA.GetDestination ()), 0, "released packets still queued");
+
+  // Freed slots are reused.
+  NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), toB, ucb, ecb), true, "freed slot not reused");
+  NS_TEST_ASSERT_MSG_EQ (queue.DropExpired (Seconds (2)), 2, "expired packets not dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_errors, 2, "error callback not called for expired packets");
+  NS_TEST_ASSERT_MSG_EQ (queue.IsEmpty (), true, "queue not empty after expiry");
+
+  // Every slot may belong to a different destination.
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      Ipv4Header h;
+      h.SetDestination (Ipv4Address (0x0a010110 + i));
+      NS_TEST_ASSERT_MSG_EQ (queue.Enqueue (Create<Packet> (), h, ucb, ecb), true, "packet to a new destination refused");
+    }
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDestinations ().size (), 4, "wrong number of destinations");
+  Ptr<Ipv4Route> routeToSecond = Create<Ipv4Route> ();
+  routeToSecond->SetDestination (Ipv4Address (0x0a010111));
+  NS_TEST_ASSERT_MSG_EQ (queue.Release (routeToSecond->GetDestination (), routeToSecond), 1, "packet not released");
+  NS_TEST_ASSERT_MSG_EQ (m_forwarded, 4, "released packet not forwarded");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetSize (Ipv4Address (0x0a010113)), 1, "destination lost when another left");
+}
+
+// Checks that the negative cache backs off exponentially and starts
+// again from the initial back-off once a destination stayed quiet.
+class SallyNegativeCacheTestCase : public TestCase
+{
+public:
+  SallyNegativeCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyNegativeCacheTestCase::SallyNegativeCacheTestCase ()
+  : TestCase ("Sally negative cache back-off")
+{
+}
+
+void
+SallyNegativeCacheTestCase::DoRun (void)
+{
+  SallyNegativeCache cache;
+  Ipv4Address dst ("10.1.1.7");
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (0)), Seconds (0), "disabled cache suppressed a destination");
+  NS_TEST_ASSERT_MSG_EQ (cache.IsEmpty (), true, "disabled cache recorded a destination");
+
+  cache.SetBackoff (Seconds (1), Seconds (4));
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (10)), Seconds (1), "wrong initial back-off");
+  NS_TEST_ASSERT_MSG_EQ (cache.IsSuppressed (dst, Seconds (10.5)), true, "destination not suppressed");
+  NS_TEST_ASSERT_MSG_EQ (cache.IsSuppressed (Ipv4Address ("10.1.1.8"), Seconds (10.5)), false, "other destination suppressed");
+  NS_TEST_ASSERT_MSG_EQ (cache.IsSuppressed (dst, Seconds (11)), false, "suppression outlived the back-off");
+
+  // Failing again right after the suppression doubles the back-off.
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (11.5)), Seconds (2), "back-off not doubled");
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (14)), Seconds (4), "back-off not doubled");
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (18)), Seconds (4), "back-off exceeds the maximum");
+
+  // Quiet for a whole back-off period: start over.
+  cache.Purge (Seconds (25));
+  NS_TEST_ASSERT_MSG_EQ (cache.GetSize (), 1, "recent destination purged");
+  NS_TEST_ASSERT_MSG_EQ (cache.DiscoveryFailed (dst, Seconds (40)), Seconds (1), "back-off not reset");
+  NS_TEST_ASSERT_MSG_EQ (cache.Remove (dst), true, "destination not removed");
+  cache.DiscoveryFailed (dst, Seconds (50));
+  cache.Purge (Seconds (60));
+  NS_TEST_ASSERT_MSG_EQ (cache.IsEmpty (), true, "stale destination not purged");
+}
+
+// Checks that control messages survive being packed into a container
+// and split again.
+class SallyContainerTestCase : public TestCase
+{
+public:
+  SallyContainerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyContainerTestCase::SallyContainerTestCase ()
+  : TestCase ("Sally control container entries")
+{
+}
+
+void
+SallyContainerTestCase::DoRun (void)
+{
+  Ptr<Packet> container = Create<Packet> ();
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      SallyContainerEntryHeader entry;
+      entry.SetDestination (Ipv4Address ("10.1.1.255"));
+      entry.SetPort (654 + i);
+      entry.SetTtl (i + 1);
+      entry.SetLength (10 * (i + 1));
+      Ptr<Packet> message = Create<Packet> (10 * (i + 1));
+      message->AddHeader (entry);
+      container->AddAtEnd (message);
+    }
+  NS_TEST_ASSERT_MSG_EQ (container->GetSize (), 3 * 9 + 60, "wrong container size");
+
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      SallyContainerEntryHeader entry;
+      container->RemoveHeader (entry);
+      NS_TEST_ASSERT_MSG_EQ (entry.GetDestination (), Ipv4Address ("10.1.1.255"), "wrong destination");
+      NS_TEST_ASSERT_MSG_EQ (entry.GetPort (), 654 + i, "wrong port");
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t) entry.GetTtl (), i + 1, "wrong TTL");
+      NS_TEST_ASSERT_MSG_EQ (entry.GetLength (), 10 * (i + 1), "wrong length");
+      container->RemoveAtStart (entry.GetLength ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (container->GetSize (), 0, "bytes left over");
+}
+
+// Checks that the extra destinations and the path cost of a batched RREQ
+// trail its header without getting in the way of AODV parsing it.
+class SallyRreqExtensionTestCase : public TestCase
+{
+public:
+  SallyRreqExtensionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyRreqExtensionTestCase::SallyRreqExtensionTestCase ()
+  : TestCase ("Sally RREQ extension")
+{
+}
+
+void
+SallyRreqExtensionTestCase::DoRun (void)
+{
+  sally::SAodvExtension extension;
+  extension.AddDestination (Ipv4Address ("10.0.0.7"), 12, false);
+  extension.AddDestination (Ipv4Address ("10.0.0.8"), 99, true);
+  extension.AddDestination (Ipv4Address ("10.0.0.9"), 0, true);
+  extension.RemoveDestination (2);
+  extension.SetPathCost (3.25);
+
+  aodv::RreqHeader rreqHeader;
+  rreqHeader.SetDst (Ipv4Address ("10.0.0.5"));
+  rreqHeader.SetId (3);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (rreqHeader);
+  packet->AddHeader (aodv::TypeHeader (aodv::AODVTYPE_RREQ));
+  packet->AddTrailer (extension);
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 1 + rreqHeader.GetSerializedSize () + 2 * 9 + 5, "wrong RREQ size");
+
+  aodv::TypeHeader tHeader;
+  packet->RemoveHeader (tHeader);
+  NS_TEST_ASSERT_MSG_EQ (tHeader.Get (), aodv::AODVTYPE_RREQ, "wrong type");
+  aodv::RreqHeader received;
+  packet->RemoveHeader (received);
+  NS_TEST_ASSERT_MSG_EQ (received.GetDst (), Ipv4Address ("10.0.0.5"), "wrong first destination");
+  NS_TEST_ASSERT_MSG_EQ (received.GetId (), 3, "wrong id");
+
+  sally::SAodvExtension trailer;
+  packet->RemoveTrailer (trailer);
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 0, "bytes left over");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetNDestinations (), 2, "wrong number of destinations");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetDestination (0), Ipv4Address ("10.0.0.7"), "wrong destination");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetDstSeqno (0), 12, "wrong sequence number");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetUnknownSeqno (0), false, "sequence number should be known");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetDestination (1), Ipv4Address ("10.0.0.8"), "wrong destination");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetDstSeqno (1), 0, "unknown sequence number should be 0");
+  NS_TEST_ASSERT_MSG_EQ (trailer.GetUnknownSeqno (1), true, "sequence number should be unknown");
+  NS_TEST_ASSERT_MSG_EQ_TOL (trailer.GetPathCost (), 3.25, 1.0 / 256, "wrong path cost");
+}
+
+// Checks that messages queued on one node reach the sockets of their own
+// ports on a neighbor after travelling in a single container.
+class SallyControlAggregatorTestCase : public TestCase
+{
+public:
+  SallyControlAggregatorTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Receive (Ptr<Socket> socket);
+
+  std::map<uint16_t, std::vector<uint32_t> > m_received;
+};
+
+SallyControlAggregatorTestCase::SallyControlAggregatorTestCase ()
+  : TestCase ("Sally control aggregator demultiplexing")
+{
+}
+
+void
+SallyControlAggregatorTestCase::Receive (Ptr<Socket> socket)
+{
+  Address local;
+  socket->GetSockName (local);
+  uint16_t port = InetSocketAddress::ConvertFrom (local).GetPort ();
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()) != 0)
+    {
+      m_received[port].push_back (packet->GetSize ());
+    }
+}
+
+void
+SallyControlAggregatorTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  NetDeviceContainer devices;
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetChannel (channel);
+      nodes.Get (n)->AddDevice (device);
+      devices.Add (device);
+    }
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  SallyControlAggregator aggregators[2];
+  for (uint32_t n = 0; n < 2; n++)
+    {
+      aggregators[n].SetIpv4 (nodes.Get (n)->GetObject<Ipv4> ());
+      aggregators[n].SetWindow (MilliSeconds (10));
+    }
+
+  TypeId udp = TypeId::LookupByName ("ns3::UdpSocketFactory");
+  const uint16_t ports[2] = { 654, 698 };
+  std::vector<Ptr<Socket> > sockets;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (1), udp);
+      socket->SetAllowBroadcast (true);
+      socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), ports[i]));
+      socket->SetRecvCallback (MakeCallback (&SallyControlAggregatorTestCase::Receive, this));
+      sockets.push_back (socket);
+    }
+
+  Ipv4Address local = interfaces.GetAddress (0);
+  Ipv4Address broadcast ("10.1.1.255");
+  Ptr<Packet> request = Create<Packet> (24);
+  SocketIpTtlTag ttl;
+  ttl.SetTtl (5);
+  request->AddPacketTag (ttl);
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].Queue (request, local, broadcast, ports[0]), true, "AODV message not queued");
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].Queue (Create<Packet> (40), local, broadcast, ports[1]), true,
+                         "OLSR message not queued");
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].Queue (Create<Packet> (12), local, broadcast, ports[0]), true,
+                         "second AODV message not queued");
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].Queue (Create<Packet> (1500), local, broadcast, ports[1]), false,
+                         "message larger than the container queued");
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].GetContainersSent (), 1, "messages not sent in one container");
+  NS_TEST_ASSERT_MSG_EQ (aggregators[0].GetMessagesAggregated (), 3, "wrong number of messages aggregated");
+  NS_TEST_ASSERT_MSG_EQ (m_received[ports[0]].size (), 2, "AODV messages not delivered to the AODV port");
+  NS_TEST_ASSERT_MSG_EQ (m_received[ports[0]][0], 24, "AODV messages reordered");
+  NS_TEST_ASSERT_MSG_EQ (m_received[ports[0]][1], 12, "AODV messages reordered");
+  NS_TEST_ASSERT_MSG_EQ (m_received[ports[1]].size (), 1, "OLSR message not delivered to the OLSR port");
+  NS_TEST_ASSERT_MSG_EQ (m_received[ports[1]][0], 40, "wrong OLSR message delivered");
+
+  for (uint32_t n = 0; n < 2; n++)
+    {
+      aggregators[n].Dispose ();
+    }
+  for (std::vector<Ptr<Socket> >::iterator i = sockets.begin (); i != sockets.end (); ++i)
+    {
+      (*i)->Close ();
+    }
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+}
+
+class SallyHelloCodecTestCase : public TestCase
+{
+public:
+  SallyHelloCodecTestCase ();
+
+private:
+  virtual void DoRun (void);
+  static olsr::MessageHeader MakeHello (const std::map<Ipv4Address, uint8_t> &links);
+  static std::map<Ipv4Address, uint8_t> GetLinks (const olsr::MessageHeader &hello);
+};
+
+SallyHelloCodecTestCase::SallyHelloCodecTestCase ()
+  : TestCase ("Sally compact HELLO encoding")
+{
+}
+
+olsr::MessageHeader
+SallyHelloCodecTestCase::MakeHello (const std::map<Ipv4Address, uint8_t> &links)
+{
+  olsr::MessageHeader hello;
+  hello.SetOriginatorAddress (Ipv4Address ("10.0.0.1"));
+  olsr::MessageHeader::Hello &body = hello.GetHello ();
+  for (std::map<Ipv4Address, uint8_t>::const_iterator i = links.begin (); i != links.end (); ++i)
+    {
+      olsr::MessageHeader::Hello::LinkMessage message;
+      message.linkCode = i->second;
+      message.neighborInterfaceAddresses.push_back (i->first);
+      body.linkMessages.push_back (message);
+    }
+  return hello;
+}
+
+std::map<Ipv4Address, uint8_t>
+SallyHelloCodecTestCase::GetLinks (const olsr::MessageHeader &hello)
+{
+  std::map<Ipv4Address, uint8_t> links;
+  const std::vector<olsr::MessageHeader::Hello::LinkMessage> &messages = hello.GetHello ().linkMessages;
+  for (std::vector<olsr::MessageHeader::Hello::LinkMessage>::const_iterator i = messages.begin (); i != messages.end (); ++i)
+    {
+      for (std::vector<Ipv4Address>::const_iterator a = i->neighborInterfaceAddresses.begin ();
+           a != i->neighborInterfaceAddresses.end (); ++a)
+        {
+          links[*a] = i->linkCode;
+        }
+    }
+  return links;
+}
+
+void
+SallyHelloCodecTestCase::DoRun (void)
+{
+  SallyHelloCodec sender;
+  SallyHelloCodec receiver;
+  sender.SetRefreshInterval (3);
+  const uint8_t sym = 0x06;
+  const uint8_t mpr = 0x0a;
+
+  std::map<Ipv4Address, uint8_t> links;
+  for (uint32_t i = 2; i < 12; i++)
+    {
+      links[Ipv4Address (0x0a000000 + i)] = sym;
+    }
+  olsr::MessageHeader sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (sender.GetFullHellos (), 1, "first HELLO must be full");
+  NS_TEST_ASSERT_MSG_EQ (receiver.Decode (sent), SallyHelloCodec::EXPANDED, "full HELLO not recognized");
+  NS_TEST_ASSERT_MSG_EQ ((GetLinks (sent) == links), true, "full HELLO expanded wrong");
+
+  // One neighbor becomes MPR, one disappears and one appears.
+  links[Ipv4Address ("10.0.0.2")] = mpr;
+  links.erase (Ipv4Address ("10.0.0.3"));
+  links[Ipv4Address ("10.0.0.20")] = sym;
+  olsr::MessageHeader full = MakeHello (links);
+  sent = sender.Encode (full);
+  NS_TEST_ASSERT_MSG_EQ (sender.GetDeltaHellos (), 1, "second HELLO must be a delta");
+  NS_TEST_ASSERT_MSG_LT (sent.GetSerializedSize (), full.GetSerializedSize (), "delta not smaller");
+  NS_TEST_ASSERT_MSG_EQ (receiver.Decode (sent), SallyHelloCodec::EXPANDED, "delta not recognized");
+  NS_TEST_ASSERT_MSG_EQ ((GetLinks (sent) == links), true, "delta expanded wrong");
+
+  // Deltas are relative to the last full HELLO, so losing one is harmless.
+  links.erase (Ipv4Address ("10.0.0.4"));
+  sender.Encode (MakeHello (links));
+  links[Ipv4Address ("10.0.0.5")] = mpr;
+  sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (sender.GetFullHellos (), 2, "refresh HELLO must be full");
+  NS_TEST_ASSERT_MSG_EQ (receiver.Decode (sent), SallyHelloCodec::EXPANDED, "refresh not recognized");
+  NS_TEST_ASSERT_MSG_EQ ((GetLinks (sent) == links), true, "refresh expanded wrong");
+  NS_TEST_ASSERT_MSG_EQ (receiver.GetVersionGaps (), 0, "unexpected version gap");
+
+  // A receiver that missed the full HELLO drops the deltas until the
+  // next one.
+  SallyHelloCodec late;
+  sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (late.Decode (sent), SallyHelloCodec::STALE, "delta without its full HELLO expanded");
+  NS_TEST_ASSERT_MSG_EQ (late.GetVersionGaps (), 1, "version gap not counted");
+
+  // So does a receiver holding an older full HELLO, until the next one.
+  sender.SetRefreshInterval (1);
+  sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (late.Decode (sent), SallyHelloCodec::EXPANDED, "full HELLO not recognized");
+  links[Ipv4Address ("10.0.0.6")] = mpr;
+  sender.Encode (MakeHello (links));
+  sender.SetRefreshInterval (3);
+  links[Ipv4Address ("10.0.0.7")] = mpr;
+  sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (late.Decode (sent), SallyHelloCodec::STALE, "delta against a missed full HELLO expanded");
+  NS_TEST_ASSERT_MSG_EQ (late.GetVersionGaps (), 2, "version gap not counted");
+  sender.Encode (MakeHello (links));
+  sent = sender.Encode (MakeHello (links));
+  NS_TEST_ASSERT_MSG_EQ (late.Decode (sent), SallyHelloCodec::EXPANDED, "refresh not recognized");
+  NS_TEST_ASSERT_MSG_EQ ((GetLinks (sent) == links), true, "refresh expanded wrong");
+
+  olsr::MessageHeader plain = MakeHello (links);
+  NS_TEST_ASSERT_MSG_EQ (receiver.Decode (plain), SallyHelloCodec::PLAIN, "plain HELLO taken as compact");
+}
+
+class SallyLinkQualityTestCase : public TestCase
+{
+public:
+  SallyLinkQualityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyLinkQualityTestCase::SallyLinkQualityTestCase ()
+  : TestCase ("Sally ETX from HELLO delivery ratios")
+{
+}
+
+void
+SallyLinkQualityTestCase::DoRun (void)
+{
+  SallyLinkQuality quality;
+  quality.SetWindow (Seconds (10));
+  Ipv4Address local ("10.0.0.1");
+  Ipv4Address good ("10.0.0.2");
+  Ipv4Address lossy ("10.0.0.3");
+  for (uint32_t t = 1; t <= 10; t++)
+    {
+      quality.HelloReceived (good, Seconds (1), Seconds (t));
+      if (t % 2 == 1)
+        {
+          quality.HelloReceived (lossy, Seconds (1), Seconds (t));
+        }
+    }
+  Time now = Seconds (10);
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetReverseRatio (good, now), 1, 1e-9, "all HELLOs arrived");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetReverseRatio (lossy, now), 0.5, 1e-9, "half the HELLOs arrived");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetLinkEtx (local, good, good, now), 1, 1e-9, "wrong ETX of a perfect link");
+  // Without a report from the neighbor the link counts as symmetric.
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetLinkEtx (local, lossy, lossy, now), 4, 1e-9, "wrong ETX of an unreported link");
+
+  // The lossy neighbor hears all our HELLOs and half of those of 10.0.0.9.
+  olsr::MessageHeader hello;
+  std::map<Ipv4Address, double> sent;
+  sent[local] = 1;
+  sent[Ipv4Address ("10.0.0.9")] = 0.5;
+  SallyLinkQuality::WriteReport (hello, sent);
+  std::map<Ipv4Address, double> received;
+  NS_TEST_ASSERT_MSG_EQ (SallyLinkQuality::ReadReport (hello, received), true, "report not found");
+  NS_TEST_ASSERT_MSG_EQ (received.size (), 2, "wrong number of ratios");
+  quality.SetReport (lossy, received, now);
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetLinkEtx (local, lossy, lossy, now), 2, 1e-3, "forward ratio not used");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetTwoHopEtx (lossy, Ipv4Address ("10.0.0.9")), 4, 1e-3, "wrong 2-hop ETX");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetTwoHopEtx (good, Ipv4Address ("10.0.0.9")), 1, 1e-9, "unknown 2-hop link not neutral");
+
+  quality.Purge (Seconds (25));
+  NS_TEST_ASSERT_MSG_EQ (quality.GetReverseRatios (Seconds (25)).empty (), true, "silent neighbors not purged");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quality.GetLinkEtx (local, good, good, Seconds (25)), SallyLinkQuality::MAX_ETX, 1e-9,
+                             "silent link not at the ETX ceiling");
+}
+
+class SallyLinkBreakDetectorTestCase : public TestCase
+{
+public:
+  SallyLinkBreakDetectorTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyLinkBreakDetectorTestCase::SallyLinkBreakDetectorTestCase ()
+  : TestCase ("Sally link breaks from transmit failures")
+{
+}
+
+void
+SallyLinkBreakDetectorTestCase::DoRun (void)
+{
+  SallyLinkBreakDetector detector;
+  Ipv4Address neighbor ("10.0.0.2");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (1)), false, "disabled detector broke a link");
+
+  detector.SetThreshold (3);
+  detector.SetWindow (Seconds (1));
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (1)), false, "link broken too early");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (1.2)), false, "link broken too early");
+  // Hearing from the neighbor ends the run.
+  detector.Heard (neighbor);
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (1.4)), false, "run not reset by a HELLO");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (1.6)), false, "link broken too early");
+  // So does a failure long after the previous one.
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (3)), false, "stale run not reset");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (3.1)), false, "link broken too early");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (Ipv4Address ("10.0.0.3"), Seconds (3.2)), false, "runs not per neighbor");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (3.3)), true, "link not broken");
+  NS_TEST_ASSERT_MSG_EQ (detector.GetBreaks (), 1, "wrong number of breaks");
+  NS_TEST_ASSERT_MSG_EQ (detector.GetLatency (), Seconds (0.3), "wrong detection latency");
+  NS_TEST_ASSERT_MSG_EQ (detector.TxFailed (neighbor, Seconds (3.4)), false, "run not restarted after the break");
+}
+
+class SallyRouteIndexTestCase : public TestCase
+{
+public:
+  SallyRouteIndexTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyRouteIndexTestCase::SallyRouteIndexTestCase ()
+  : TestCase ("Sally incremental routes against a full BFS")
+{
+}
+
+void
+SallyRouteIndexTestCase::DoRun (void)
+{
+  typedef std::map<Ipv4Address, SallyRouteIndex::Route> Routes;
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  const uint32_t nodes = 30;
+  SallyRouteIndex index;
+  // The same graph, fed one edge at a time.
+  SallyRouteIndex fed;
+  Routes direct;
+  std::set<SallyRouteIndex::Edge> edges;
+  // What a routing table fed only with GetChanged holds.
+  Routes table;
+
+  for (uint32_t step = 0; step < 200; step++)
+    {
+      for (uint32_t k = 0; k < 4; k++)
+        {
+          SallyRouteIndex::Edge edge (Ipv4Address (1 + random->GetInteger (0, nodes - 1)),
+                                      Ipv4Address (1 + random->GetInteger (0, nodes - 1)));
+          if (edges.erase (edge) > 0)
+            {
+              fed.RemoveEdge (edge.first, edge.second);
+            }
+          else if (edge.first != edge.second)
+            {
+              edges.insert (edge);
+              fed.AddEdge (edge.first, edge.second);
+            }
+        }
+      if (step % 4 == 0)
+        {
+          Ipv4Address neighbor (1 + random->GetInteger (0, nodes - 1));
+          if (direct.erase (neighbor) == 0)
+            {
+              SallyRouteIndex::Route route;
+              route.nextAddr = neighbor;
+              route.interface = random->GetInteger (1, 2);
+              route.distance = 1;
+              direct[neighbor] = route;
+            }
+        }
+      index.Update (direct, edges);
+      fed.Update (direct);
+      const std::vector<Ipv4Address> &changed = index.GetChanged ();
+      for (std::vector<Ipv4Address>::const_iterator i = changed.begin (); i != changed.end (); i++)
+        {
+          SallyRouteIndex::Route route;
+          if (index.Lookup (*i, route))
+            {
+              table[*i] = route;
+            }
+          else
+            {
+              table.erase (*i);
+            }
+        }
+
+      // Reference hop counts from scratch.
+      std::map<Ipv4Address, uint32_t> distance;
+      std::queue<Ipv4Address> pending;
+      for (Routes::const_iterator d = direct.begin (); d != direct.end (); d++)
+        {
+          distance[d->first] = 1;
+          pending.push (d->first);
+        }
+      while (!pending.empty ())
+        {
+          Ipv4Address node = pending.front ();
+          pending.pop ();
+          for (std::set<SallyRouteIndex::Edge>::const_iterator e = edges.begin (); e != edges.end (); e++)
+            {
+              if (e->first == node && distance.find (e->second) == distance.end ())
+                {
+                  distance[e->second] = distance[node] + 1;
+                  pending.push (e->second);
+                }
+            }
+        }
+
+      NS_TEST_ASSERT_MSG_EQ (table.size (), distance.size (), "wrong reachable set at step " << step);
+      NS_TEST_ASSERT_MSG_EQ (index.GetSize (), distance.size (), "wrong index size at step " << step);
+      for (std::map<Ipv4Address, uint32_t>::const_iterator d = distance.begin (); d != distance.end (); d++)
+        {
+          Routes::const_iterator route = table.find (d->first);
+          NS_TEST_ASSERT_MSG_EQ ((route != table.end ()), true, "lost route to " << d->first);
+          NS_TEST_ASSERT_MSG_EQ (route->second.distance, d->second, "wrong distance to " << d->first);
+          Routes::const_iterator first = direct.find (route->second.nextAddr);
+          NS_TEST_ASSERT_MSG_EQ ((first != direct.end ()), true, "next hop is no neighbor");
+          NS_TEST_ASSERT_MSG_EQ (route->second.interface, first->second.interface, "wrong interface");
+          SallyRouteIndex::Route fedRoute;
+          NS_TEST_ASSERT_MSG_EQ (fed.Lookup (d->first, fedRoute), true, "edge updates lost route to " << d->first);
+          NS_TEST_ASSERT_MSG_EQ (fedRoute.distance, d->second, "edge updates got a wrong distance to " << d->first);
+        }
+      NS_TEST_ASSERT_MSG_EQ (fed.GetSize (), distance.size (), "wrong size with edge updates at step " << step);
+    }
+
+  // An edge added by two sources stays until both removed it.
+  SallyRouteIndex counted;
+  Routes one;
+  SallyRouteIndex::Route toFirst;
+  toFirst.nextAddr = Ipv4Address (1);
+  toFirst.interface = 1;
+  toFirst.distance = 1;
+  one[toFirst.nextAddr] = toFirst;
+  counted.AddEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.AddEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.Update (one);
+  counted.RemoveEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.Update (one);
+  SallyRouteIndex::Route route;
+  NS_TEST_ASSERT_MSG_EQ (counted.Lookup (Ipv4Address (2), route), true, "edge gone while still referenced");
+  // Removed and added back between two updates: nothing changes.
+  counted.RemoveEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.AddEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.Update (one);
+  NS_TEST_ASSERT_MSG_EQ (counted.GetChanged ().size (), 0, "unchanged edge reported");
+  counted.RemoveEdge (Ipv4Address (1), Ipv4Address (2));
+  counted.Update (one);
+  NS_TEST_ASSERT_MSG_EQ (counted.Lookup (Ipv4Address (2), route), false, "edge kept without references");
+}
+
+class SallyMprSelectorTestCase : public TestCase
+{
+public:
+  SallyMprSelectorTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyMprSelectorTestCase::SallyMprSelectorTestCase ()
+  : TestCase ("Sally bitset MPR selection matches the stock heuristic")
+{
+}
+
+void
+SallyMprSelectorTestCase::DoRun (void)
+{
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  const uint8_t willingness[] = { 0, 1, 3, 3, 3, 3, 6, 7 };
+  for (uint32_t trial = 0; trial < 200; trial++)
+    {
+      Ptr<sally::SOlsrRoutingProtocol> stock = CreateObject<sally::SOlsrRoutingProtocol> ();
+      Ptr<sally::SOlsrRoutingProtocol> bitset = CreateObject<sally::SOlsrRoutingProtocol> ();
+      bitset->SetAttribute ("BitsetMpr", BooleanValue (true));
+      Ptr<sally::SOlsrRoutingProtocol> both[2] = { stock, bitset };
+      uint32_t nodes = random->GetInteger (3, 120);
+      uint32_t neighbors = random->GetInteger (1, 30);
+      uint32_t twoHops = random->GetInteger (0, 250);
+
+      std::vector<Ipv4Address> addresses;
+      for (uint32_t k = 0; k < neighbors; k++)
+        {
+          olsr::NeighborTuple neighbor;
+          neighbor.neighborMainAddr = Ipv4Address (random->GetInteger (2, nodes + 1));
+          if (std::find (addresses.begin (), addresses.end (), neighbor.neighborMainAddr) != addresses.end ())
+            {
+              continue;
+            }
+          addresses.push_back (neighbor.neighborMainAddr);
+          neighbor.status = random->GetInteger (0, 7) == 0 ? olsr::NeighborTuple::STATUS_NOT_SYM
+            : olsr::NeighborTuple::STATUS_SYM;
+          neighbor.willingness = willingness[random->GetInteger (0, 7)];
+          for (int p = 0; p < 2; p++)
+            {
+              both[p]->m_state.InsertNeighborTuple (neighbor);
+            }
+        }
+      std::set<std::pair<Ipv4Address, Ipv4Address> > links;
+      for (uint32_t k = 0; k < twoHops; k++)
+        {
+          olsr::TwoHopNeighborTuple twoHop;
+          twoHop.neighborMainAddr = random->GetInteger (0, 9) == 0 ? Ipv4Address (random->GetInteger (2, nodes + 1))
+            : addresses[random->GetInteger (0, addresses.size () - 1)];
+          twoHop.twoHopNeighborAddr = Ipv4Address (random->GetInteger (1, nodes + 1));
+          twoHop.expirationTime = Seconds (100);
+          if (!links.insert (std::make_pair (twoHop.neighborMainAddr, twoHop.twoHopNeighborAddr)).second)
+            {
+              continue;
+            }
+          for (int p = 0; p < 2; p++)
+            {
+              both[p]->m_state.InsertTwoHopNeighborTuple (twoHop);
+            }
+        }
+
+      for (int p = 0; p < 2; p++)
+        {
+          both[p]->m_mainAddress = Ipv4Address (1);
+          both[p]->MprComputation ();
+        }
+      olsr::MprSet expected = stock->m_state.GetMprSet ();
+      olsr::MprSet actual = bitset->m_state.GetMprSet ();
+      NS_TEST_ASSERT_MSG_EQ (actual.size (), expected.size (), "MPR set size differs in trial " << trial);
+      NS_TEST_ASSERT_MSG_EQ ((actual == expected), true, "MPR set differs in trial " << trial);
+    }
+}
+
+class SallyDuplicateSetTestCase : public TestCase
+{
+public:
+  SallyDuplicateSetTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyDuplicateSetTestCase::SallyDuplicateSetTestCase ()
+  : TestCase ("Sally hashed duplicate set with timing wheel expiry")
+{
+}
+
+void
+SallyDuplicateSetTestCase::DoRun (void)
+{
+  SallyDuplicateSet set;
+  set.SetHoldTime (Seconds (30), Seconds (1));
+  Ipv4Address originator ("10.0.0.7");
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, 1, Seconds (0)) == 0), true, "empty set found a tuple");
+
+  SallyDuplicateSet::Tuple &tuple = set.Insert (originator, 1, Seconds (0));
+  tuple.ifaceList.push_back (Ipv4Address ("10.0.0.1"));
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, 2, Seconds (1)) == 0), true, "wrong sequence number matched");
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (Ipv4Address ("10.0.0.8"), 1, Seconds (1)) == 0), true, "wrong originator matched");
+  SallyDuplicateSet::Tuple *found = set.Find (originator, 1, Seconds (29.5));
+  NS_TEST_ASSERT_MSG_EQ ((found != 0), true, "tuple lost before its hold time");
+  NS_TEST_ASSERT_MSG_EQ (found->ifaceList.size (), 1, "tuple fields not kept");
+
+  // Refreshed at 29.5 s, the tuple outlives its first slot.
+  set.Refresh (*found, Seconds (29.5));
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, 1, Seconds (45)) != 0), true, "refreshed tuple expired");
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, 1, Seconds (59.6)) == 0), true, "tuple outlived its hold time");
+
+  // Expired tuples are reclaimed as the wheel turns, with no event.
+  for (uint16_t sequence = 0; sequence < 1000; sequence++)
+    {
+      set.Insert (originator, sequence, Seconds (100) + MilliSeconds (sequence));
+    }
+  NS_TEST_ASSERT_MSG_EQ (set.GetSize (), 1000, "tuples lost after rehashing");
+  for (uint16_t sequence = 0; sequence < 1000; sequence += 97)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, sequence, Seconds (120)) != 0), true, "tuple lost after rehashing");
+    }
+  NS_TEST_ASSERT_MSG_EQ ((set.Find (originator, 0, Seconds (200)) == 0), true, "expired tuple found");
+  NS_TEST_ASSERT_MSG_EQ (set.GetSize (), 0, "expired tuples not reclaimed");
+  NS_TEST_ASSERT_MSG_EQ (set.GetInserted (), 1001, "wrong insertion count");
+}
+
+// Checks link lookups through the index as the link set changes, and link timers on the wheel.
+class SallyLinkIndexTestCase : public TestCase
+{
+public:
+  SallyLinkIndexTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+SallyLinkIndexTestCase::SallyLinkIndexTestCase ()
+  : TestCase ("Sally hashed link set with timing wheel timers")
+{
+}
+
+void
+SallyLinkIndexTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.2");
+  Ipv4Address b ("10.0.0.3");
+  Ipv4Address c ("10.0.0.4");
+  olsr::LinkSet links;
+  olsr::LinkTuple tuple;
+  tuple.localIfaceAddr = Ipv4Address ("10.0.0.1");
+  tuple.neighborIfaceAddr = a;
+  links.push_back (tuple);
+  tuple.neighborIfaceAddr = b;
+  links.push_back (tuple);
+  tuple.neighborIfaceAddr = c;
+  links.push_back (tuple);
+
+  SallyLinkIndex index;
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, b) == &links[1]), true, "link not found");
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, Ipv4Address ("10.0.0.9")) == 0), true, "unknown link found");
+
+  // Removals and insertions are reported as the OLSR state makes them.
+  links.erase (links.begin ());
+  index.LinkSetChanged (links, false);
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, c) == &links[1]), true, "link lost after a removal");
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, a) == 0), true, "removed link found");
+  tuple.neighborIfaceAddr = a;
+  links.push_back (tuple);
+  index.LinkSetChanged (links, true);
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, a) == &links[2]), true, "inserted link not found");
+
+  // A removal followed by an insertion leaves the size unchanged.
+  links.erase (links.begin ());
+  index.LinkSetChanged (links, false);
+  tuple.neighborIfaceAddr = b;
+  links.push_back (tuple);
+  index.LinkSetChanged (links, true);
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, b) == &links[2]), true, "link reinserted at the same size not found");
+  NS_TEST_ASSERT_MSG_EQ ((index.Find (links, a) == &links[1]), true, "link moved by a removal not found");
+
+  index.SetTimerSpan (Seconds (6), MilliSeconds (500));
+  Time end;
+  NS_TEST_ASSERT_MSG_EQ (index.GetNextTimerSlot (end), false, "timer set on an empty wheel");
+  index.ScheduleTimer (a, Seconds (1.2));
+  index.ScheduleTimer (b, Seconds (20));
+  NS_TEST_ASSERT_MSG_EQ (index.GetNextTimerSlot (end), true, "no timer set");
+  NS_TEST_ASSERT_MSG_EQ (end, Seconds (1.5), "wheel not run at the end of the first slot");
+  std::vector<Ipv4Address> due;
+  index.ExpireTimers (Seconds (1.5), due);
+  NS_TEST_ASSERT_MSG_EQ (due.size (), 1, "wrong timers fired");
+  NS_TEST_ASSERT_MSG_EQ (due[0], a, "wrong timer fired");
+
+  // Beyond the span of the wheel, the timer waits for its deadline.
+  due.clear ();
+  index.ExpireTimers (Seconds (7), due);
+  NS_TEST_ASSERT_MSG_EQ (due.empty (), true, "timer fired before its deadline");
+  index.ExpireTimers (Seconds (21), due);
+  NS_TEST_ASSERT_MSG_EQ (due.size (), 1, "far timer lost");
+  NS_TEST_ASSERT_MSG_EQ (due[0], b, "wrong far timer fired");
+
+  // A timer set again fires once, at its last deadline.
+  due.clear ();
+  index.ScheduleTimer (c, Seconds (22));
+  index.ScheduleTimer (c, Seconds (23));
+  index.ExpireTimers (Seconds (22.5), due);
+  NS_TEST_ASSERT_MSG_EQ (due.empty (), true, "timer fired at its earlier deadline");
+  index.ExpireTimers (Seconds (24), due);
+  NS_TEST_ASSERT_MSG_EQ (due.size (), 1, "timer set twice fired twice");
+  NS_TEST_ASSERT_MSG_EQ (index.GetNextTimerSlot (end), false, "timers left on the wheel");
+  NS_TEST_ASSERT_MSG_EQ (index.GetTimersScheduled (), 4, "wrong timer count");
+}
+
+// Sends packets across a three-node chain of AODV-only SALLY nodes; the
+// middle node has no SOLSR and must still forward with AODV.
+class SallyAodvOnlyTestCase : public TestCase
+{
+public:
+  SallyAodvOnlyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Send (Ptr<Socket> socket, Ipv4Address dst);
+  void Receive (Ptr<Socket> socket);
+
+  uint32_t m_received;
+};
+
+SallyAodvOnlyTestCase::SallyAodvOnlyTestCase ()
+  : TestCase ("Sally forwarding on AODV-only nodes"),
+    m_received (0)
+{
+}
+
+void
+SallyAodvOnlyTestCase::Send (Ptr<Socket> socket, Ipv4Address dst)
+{
+  socket->SendTo (Create<Packet> (100), 0, InetSocketAddress (dst, 9));
+}
+
+void
+SallyAodvOnlyTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      m_received++;
+    }
+}
+
+void
+SallyAodvOnlyTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (3);
+  SallyHelper sally;
+  sally.SetNumberHybridNodes (0);
+  sally.SetSingleProtocol (SallyHelper::AODV_ONLY);
+  Ipv4StaticRoutingHelper staticRouting;
+  sally.Add (staticRouting, 0);
+  sally.AssignRoles (nodes);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (sally);
+  internet.Install (nodes);
+
+  // 0 -- 1 -- 2: nodes 0 and 2 only hear each other through node 1.
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4Address sink;
+  for (uint32_t link = 0; link < 2; link++)
+    {
+      Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+      NetDeviceContainer devices;
+      for (uint32_t n = link; n < link + 2; n++)
+        {
+          Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+          device->SetAddress (Mac48Address::Allocate ());
+          device->SetChannel (channel);
+          nodes.Get (n)->AddDevice (device);
+          devices.Add (device);
+        }
+      sink = address.Assign (devices).GetAddress (1);
+      address.NewNetwork ();
+    }
+  Ptr<SallyRouting> middle = DynamicCast<SallyRouting> (nodes.Get (1)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+  NS_TEST_ASSERT_MSG_EQ ((middle != 0), true, "SALLY not installed");
+  NS_TEST_ASSERT_MSG_EQ (middle->IsAodvMode (), true, "node without SOLSR not in AODV mode");
+  NS_TEST_ASSERT_MSG_EQ (middle->GetNRoutingProtocols (), 2, "protocol given to Add () not installed");
+  // InternetStackHelper installs through a copy of the helper.
+  NS_TEST_ASSERT_MSG_EQ (sally.GetNumberCreated (), 3, "copies do not share the creation count");
+  NS_TEST_ASSERT_MSG_EQ (sally.GetNumberHybridCreated (), 0, "wrong hybrid count");
+
+  TypeId udp = TypeId::LookupByName ("ns3::UdpSocketFactory");
+  Ptr<Socket> receiver = Socket::CreateSocket (nodes.Get (2), udp);
+  receiver->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  receiver->SetRecvCallback (MakeCallback (&SallyAodvOnlyTestCase::Receive, this));
+  Ptr<Socket> sender = Socket::CreateSocket (nodes.Get (0), udp);
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Simulator::Schedule (Seconds (1 + i), &SallyAodvOnlyTestCase::Send, this, sender, sink);
+    }
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+
+  // The first packet may be lost while AODV looks for the route.
+  NS_TEST_ASSERT_MSG_GT (m_received, 3, "packets not forwarded by the AODV-only node");
+}
+
+// Checks that an RREQ first heard from a node that did not select us as
+// MPR is still relayed when an MPR selector sends it afterwards.
+class SallyMprRelayOrderTestCase : public TestCase
+{
+public:
+  SallyMprRelayOrderTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void SendRequest (Ptr<Socket> socket);
+  bool RelaysFor (Ipv4Address neighbor);
+
+  Ipv4Address m_selector;
+};
+
+SallyMprRelayOrderTestCase::SallyMprRelayOrderTestCase ()
+  : TestCase ("Sally RREQ relaying after a suppressed copy")
+{
+}
+
+void
+SallyMprRelayOrderTestCase::SendRequest (Ptr<Socket> socket)
+{
+  aodv::RreqHeader rreqHeader;
+  rreqHeader.SetOrigin (Ipv4Address ("10.1.1.9"));
+  rreqHeader.SetOriginSeqno (1);
+  rreqHeader.SetId (7);
+  rreqHeader.SetDst (Ipv4Address ("10.1.1.8"));
+  rreqHeader.SetUnknownSeqno (true);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (rreqHeader);
+  packet->AddHeader (aodv::TypeHeader (aodv::AODVTYPE_RREQ));
+  SocketIpTtlTag tag;
+  tag.SetTtl (5);
+  packet->AddPacketTag (tag);
+  socket->SendTo (packet, 0, InetSocketAddress (Ipv4Address ("10.1.1.255"), aodv::RoutingProtocol::AODV_PORT));
+}
+
+bool
+SallyMprRelayOrderTestCase::RelaysFor (Ipv4Address neighbor)
+{
+  return neighbor == m_selector;
+}
+
+void
+SallyMprRelayOrderTestCase::DoRun (void)
+{
+  // Node 0 is a plain neighbor, node 1 an MPR selector of the relay, node 2.
+  NodeContainer nodes;
+  nodes.Create (3);
+  InternetStackHelper internet;
+  internet.Install (NodeContainer (nodes.Get (0), nodes.Get (1)));
+  SAodvHelper saodv;
+  saodv.Set ("MprRelay", BooleanValue (true));
+  InternetStackHelper relayInternet;
+  relayInternet.SetRoutingHelper (saodv);
+  relayInternet.Install (nodes.Get (2));
+
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  NetDeviceContainer devices;
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      device->SetAddress (Mac48Address::Allocate ());
+      device->SetChannel (channel);
+      nodes.Get (n)->AddDevice (device);
+      devices.Add (device);
+    }
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  m_selector = interfaces.GetAddress (1);
+
+  Ptr<sally::SAodvRoutingProtocol> relay =
+    DynamicCast<sally::SAodvRoutingProtocol> (nodes.Get (2)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+  NS_TEST_ASSERT_MSG_EQ ((relay != 0), true, "SAODV not installed");
+  relay->SetRelayFilter (MakeCallback (&SallyMprRelayOrderTestCase::RelaysFor, this));
+
+  TypeId udp = TypeId::LookupByName ("ns3::UdpSocketFactory");
+  for (uint32_t n = 0; n < 2; n++)
+    {
+      Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (n), udp);
+      socket->SetAllowBroadcast (true);
+      socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), aodv::RoutingProtocol::AODV_PORT));
+      // The non-selector copy arrives first.
+      Simulator::Schedule (Seconds (1 + 0.1 * n), &SallyMprRelayOrderTestCase::SendRequest, this, socket);
+    }
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (relay->GetRreqRelaysSuppressed (), 1, "copy from the non-selector not suppressed");
+  NS_TEST_ASSERT_MSG_EQ (relay->GetRreqRelays (), 1, "copy from the MPR selector dropped as a duplicate");
+  Simulator::Destroy ();
+  Ipv4AddressGenerator::Reset ();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,6 +1316,23 @@ SallyTestSuite::SallyTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new SallyTestCase1, TestCase::QUICK);
+  AddTestCase (new SallyRouteCacheTestCase, TestCase::QUICK);
+  AddTestCase (new SallyMprRelayTestCase, TestCase::QUICK);
+  AddTestCase (new SallyNeighborSensingTestCase, TestCase::QUICK);
+  AddTestCase (new SallyDeferralQueueTestCase, TestCase::QUICK);
+  AddTestCase (new SallyNegativeCacheTestCase, TestCase::QUICK);
+  AddTestCase (new SallyContainerTestCase, TestCase::QUICK);
+  AddTestCase (new SallyRreqExtensionTestCase, TestCase::QUICK);
+  AddTestCase (new SallyControlAggregatorTestCase, TestCase::QUICK);
+  AddTestCase (new SallyHelloCodecTestCase, TestCase::QUICK);
+  AddTestCase (new SallyLinkQualityTestCase, TestCase::QUICK);
+  AddTestCase (new SallyLinkBreakDetectorTestCase, TestCase::QUICK);
+  AddTestCase (new SallyRouteIndexTestCase, TestCase::QUICK);
+  AddTestCase (new SallyMprSelectorTestCase, TestCase::QUICK);
+  AddTestCase (new SallyDuplicateSetTestCase, TestCase::QUICK);
+  AddTestCase (new SallyLinkIndexTestCase, TestCase::QUICK);
+  AddTestCase (new SallyAodvOnlyTestCase, TestCase::QUICK);
+  AddTestCase (new SallyMprRelayOrderTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite